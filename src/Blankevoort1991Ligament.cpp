@@ -24,9 +24,21 @@
 #include <OpenSim/Simulation/Model/Model.h>
 #include <OpenSim/Simulation/Model/PointForceDirection.h>
 #include "Blankevoort1991Ligament.h"
+#include "Blankevoort1991LigamentSet.h"
+#include "HelperFunctions.h"
+#include <sstream>
 
 using namespace OpenSim;
 
+// Damping is phased-out with a smooth step function as strain goes from
+// DAMPING_STEP_STRAIN to zero
+static const double DAMPING_STEP_STRAIN = 0.01;
+static const double INV_DAMPING_STEP_STRAIN = 1.0 / DAMPING_STEP_STRAIN;
+
+// Coordinate step for the central differences of the path length 
+// derivatives in the generalized force derivatives
+static const double PATH_DERIVATIVE_STEP = 1e-6;
+
 //=============================================================================
 // CONSTRUCTORS
 //=============================================================================
@@ -64,6 +76,9 @@ Blankevoort1991Ligament::Blankevoort1991Ligament(
 
 void Blankevoort1991Ligament::setNull()
 {
+    _toe_coefficient = 0.0;
+    _half_transition_strain = 0.0;
+
     setAuthors("Colin Smith");
     setReferences(
     "Blankevoort, L. and Huiskes, R., (1991)."
@@ -86,6 +101,10 @@ void Blankevoort1991Ligament::constructProperties() {
     constructProperty_transition_strain(0.06);
     constructProperty_damping_coefficient(0.003);
     constructProperty_slack_length(0.0);
+    constructProperty_use_path_surrogate(false);
+    constructProperty_path_surrogate_order(3);
+    constructProperty_path_surrogate_num_samples(0);
+    constructProperty_path_surrogate_directory("");
 }
 
 void Blankevoort1991Ligament::extendFinalizeFromProperties() {
@@ -108,15 +127,64 @@ void Blankevoort1991Ligament::extendFinalizeFromProperties() {
             getProperty_transition_strain().getName(),
             "Transistion Strain cannot be less than 0");
 
+    OPENSIM_THROW_IF_FRMOBJ(get_path_surrogate_order() < 1,
+            InvalidPropertyValue, getProperty_path_surrogate_order().getName(),
+            "Path Surrogate Order must be at least 1");
+
+    // Precompute the force-strain curve constants
+    _toe_coefficient = 0.5 * get_linear_stiffness() / get_transition_strain();
+    _half_transition_strain = get_transition_strain() / 2;
+
     // Set Default Ligament Color
     GeometryPath& path = upd_GeometryPath();
     path.setDefaultColor(SimTK::Vec3(0.1202, 0.7054, 0.1318));
 }
 
+void Blankevoort1991Ligament::extendConnectToModel(Model& model) {
+    Super::extendConnectToModel(model);
+
+    if (!get_use_path_surrogate()) {
+        return;
+    }
+
+    // The fit is valid as long as the path, the coordinate ranges and the
+    // fit settings are unchanged
+    SimTK::Xml::Document doc;
+    SimTK::Xml::Element root = doc.getRootElement();
+    get_GeometryPath().updateXMLNode(root);
+    SimTK::String path_xml;
+    doc.writeToString(path_xml, true);
+
+    std::stringstream signature;
+    signature << path_xml << get_path_surrogate_order() << " "
+        << get_path_surrogate_num_samples();
+    for (const Coordinate& coord : model.getComponentList<Coordinate>()) {
+        signature << coord.getAbsolutePathString() << " " << 
+            coord.getRangeMin() << " " << coord.getRangeMax();
+    }
+    _path_surrogate_signature = FNV_OFFSET_BASIS;
+    hash_string(_path_surrogate_signature, signature.str());
+
+    if (_path_surrogate.isFitted() &&
+        _path_surrogate.getSignature() == _path_surrogate_signature) {
+        _path_surrogate.connectToModel(model);
+    }
+    else {
+        _path_surrogate = PolynomialPathSurrogate();
+    }
+}
+
 void Blankevoort1991Ligament::extendAddToSystem(
         SimTK::MultibodySystem& system) const {
     Super::extendAddToSystem(system);
 
+    if (get_use_path_surrogate()) {
+        addCacheVariable<double>("surrogate_length", 0.0,
+            SimTK::Stage::Position);
+        addCacheVariable<SimTK::Vector>("surrogate_length_derivative",
+            SimTK::Vector(), SimTK::Stage::Position);
+    }
+
     addCacheVariable<double>("strain", 0.0, SimTK::Stage::Position);
     addCacheVariable<double>("strain_rate", 0.0, SimTK::Stage::Velocity);
     addCacheVariable<double>("force_spring", 0.0, SimTK::Stage::Position);
@@ -124,6 +192,24 @@ void Blankevoort1991Ligament::extendAddToSystem(
     addCacheVariable<double>("force_total", 0.0, SimTK::Stage::Velocity);
 }
 
+void Blankevoort1991Ligament::extendInitStateFromProperties(
+        SimTK::State& state) const {
+    Super::extendInitStateFromProperties(state);
+
+    if (!get_use_path_surrogate() || _path_surrogate.isFitted()) {
+        return;
+    }
+
+    // Fit at the default pose rather than in whichever state is realized
+    // first, so the fit does not depend on the coordinate values or locks
+    // of e.g. a settle simulation
+    SimTK::State default_state = state;
+    for (const Coordinate& coord : getModel().getComponentList<Coordinate>()) {
+        coord.setValue(default_state, coord.getDefaultValue(), false);
+    }
+    initializePathSurrogate(default_state);
+}
+
 //=============================================================================
 // SCALING
 //=============================================================================
@@ -149,15 +235,24 @@ void Blankevoort1991Ligament::extendPostScale(
 //=============================================================================
 
 double Blankevoort1991Ligament::getLength(const SimTK::State& state) const {
-    return get_GeometryPath().getLength(state);
+    if (!_ligament_set.empty()) {
+        return _ligament_set->getLength(state, _ligament_set_index);
+    }
+    return calcPathLength(state);
 }
 
 double Blankevoort1991Ligament::getLengtheningSpeed(
         const SimTK::State& state) const {
-    return get_GeometryPath().getLengtheningSpeed(state);
+    if (!_ligament_set.empty()) {
+        return _ligament_set->getLengtheningSpeed(state, _ligament_set_index);
+    }
+    return calcPathLengtheningSpeed(state);
 }
 
 double Blankevoort1991Ligament::getStrain(const SimTK::State& state) const {
+    if (!_ligament_set.empty()) {
+        return _ligament_set->getStrain(state, _ligament_set_index);
+    }
     if(!isCacheVariableValid(state,"strain")) {
         double length = getLength(state);
         double strain = length / get_slack_length() -1;
@@ -169,6 +264,9 @@ double Blankevoort1991Ligament::getStrain(const SimTK::State& state) const {
 
 double Blankevoort1991Ligament::getStrainRate(
         const SimTK::State& state) const {
+    if (!_ligament_set.empty()) {
+        return _ligament_set->getStrainRate(state, _ligament_set_index);
+    }
    if(!isCacheVariableValid(state,"strain_rate")) {
         double lengthening_speed = getLengtheningSpeed(state);
         double strain_rate = lengthening_speed / get_slack_length();
@@ -180,6 +278,9 @@ double Blankevoort1991Ligament::getStrainRate(
 
 double Blankevoort1991Ligament::getSpringForce(
         const SimTK::State& state) const {
+    if (!_ligament_set.empty()) {
+        return _ligament_set->getSpringForce(state, _ligament_set_index);
+    }
     if (!isCacheVariableValid(state, "force_spring")) {
         double force = calcSpringForce(state);
         setCacheVariableValue<double>(state, "force_spring", force);
@@ -189,6 +290,9 @@ double Blankevoort1991Ligament::getSpringForce(
 
 double Blankevoort1991Ligament::getDampingForce(
         const SimTK::State& state) const {
+    if (!_ligament_set.empty()) {
+        return _ligament_set->getDampingForce(state, _ligament_set_index);
+    }
     if (!isCacheVariableValid(state, "force_damping")) {
         double force = calcDampingForce(state);
         setCacheVariableValue<double>(state, "force_damping", force);
@@ -198,6 +302,9 @@ double Blankevoort1991Ligament::getDampingForce(
 
 double Blankevoort1991Ligament::getTotalForce(
         const SimTK::State& state) const {
+    if (!_ligament_set.empty()) {
+        return _ligament_set->getTotalForce(state, _ligament_set_index);
+    }
     if(!isCacheVariableValid(state,"force_total")) {
         double force = calcTotalForce(state);
         setCacheVariableValue<double>(state, "force_total", force);
@@ -278,44 +385,43 @@ double Blankevoort1991Ligament::calcSpringForce(
         const SimTK::State& state) const {
 
     double strain = getStrain(state);
-    double k = get_linear_stiffness();
-    double e_t = get_transition_strain();
 
-    double force_spring;
     // slack region
     if (strain <= 0) {
-        force_spring = 0.0;
+        return 0.0;
     }
     // toe region F = 1/2 * k / e_t * e^2
-    else if ((strain > 0) && (strain < e_t)) {        
-        force_spring = 0.5 * k / e_t * SimTK::square(strain);
+    else if (strain < get_transition_strain()) {
+        return _toe_coefficient * strain * strain;
     }
     // linear region F = k * (e-e_t/2)
     else {//strain >= e_t 
-        force_spring = k * (strain - e_t / 2); 
+        return get_linear_stiffness() * (strain - _half_transition_strain);
     }
-    return force_spring;
 }
 
 double Blankevoort1991Ligament::calcDampingForce(const SimTK::State& s) const {
     double strain = getStrain(s);
     double strain_rate = getStrainRate(s);
-    double force_damping = 0.0;
 
-    if (strain > 0 && strain_rate > 0) {
-        double damping_coeff = get_damping_coefficient();
-        force_damping = damping_coeff*strain_rate;
-    }
-    else {
+    if (strain <= 0 || strain_rate <= 0) {
         return 0.0;
     }
 
+    return get_damping_coefficient() * strain_rate * 
+        calcDampingPhaseOut(strain);
+}
+
+double Blankevoort1991Ligament::calcDampingPhaseOut(double strain) {
     //Phase-out damping as strain goes to zero with smooth-step function
-    SimTK::Function::Step step(0, 1, 0, 0.01);
-    SimTK::Vector in_vec(1, strain);
-    force_damping = force_damping * step.calcValue(in_vec);
-    
-    return force_damping;
+    //(closed form of SimTK::Function::Step(0, 1, 0, DAMPING_STEP_STRAIN))
+    if (strain <= 0) {
+        return 0.0;
+    }
+    if (strain >= DAMPING_STEP_STRAIN) {
+        return 1.0;
+    }
+    return SimTK::stepUp(strain * INV_DAMPING_STEP_STRAIN);
 }
 
 double Blankevoort1991Ligament::calcTotalForce(const SimTK::State& s) const {
@@ -332,14 +438,16 @@ double Blankevoort1991Ligament::calcTotalForce(const SimTK::State& s) const {
 void Blankevoort1991Ligament::computeForce(const SimTK::State& s,
                               SimTK::Vector_<SimTK::SpatialVec>& bodyForces,
                               SimTK::Vector& generalizedForces) const {
+    // The Blankevoort1991LigamentSet applies the force
+    if (!_ligament_set.empty() && _ligament_set->appliesForce(s)) {
+        return;
+    }
+
     if (get_appliesForce()) {
         // total force
         double force_total = getTotalForce(s);
 
-        const GeometryPath &path = get_GeometryPath();
-
-        path.addInEquivalentForces(
-                s, force_total, bodyForces, generalizedForces);
+        applyPathForce(s, force_total, bodyForces, generalizedForces);
     }
 }
 
@@ -368,9 +476,252 @@ double Blankevoort1991Ligament::computePotentialEnergy(
 
 double Blankevoort1991Ligament::computeMomentArm(
         const SimTK::State& s, Coordinate& aCoord) const {
+    if (get_use_path_surrogate()) {
+        const SimTK::Vector& dldq = getPathLengthDerivative(s);
+        int index = _path_surrogate.findCoordinateIndex(aCoord);
+        return index == -1 ? 0.0 : -dldq(index);
+    }
     return get_GeometryPath().computeMomentArm(s, aCoord);
 }
 
+//=============================================================================
+// FORCE DERIVATIVES
+//=============================================================================
+double Blankevoort1991Ligament::calcForceStrainDerivative(
+        const SimTK::State& state) const {
+    double strain = getStrain(state);
+    double strain_rate = getStrainRate(state);
+
+    if (strain <= 0) {
+        return 0.0;
+    }
+
+    // spring: toe region dF/de = k / e_t * e, linear region dF/de = k
+    double dfde = strain < get_transition_strain() ?
+        2.0 * _toe_coefficient * strain : get_linear_stiffness();
+
+    // damping: only the smooth-step phase-out depends on strain
+    if (strain_rate > 0 && strain < DAMPING_STEP_STRAIN) {
+        dfde += get_damping_coefficient() * strain_rate *
+            SimTK::dstepUp(strain * INV_DAMPING_STEP_STRAIN) *
+            INV_DAMPING_STEP_STRAIN;
+    }
+    return dfde;
+}
+
+double Blankevoort1991Ligament::calcForceStrainRateDerivative(
+        const SimTK::State& state) const {
+    double strain = getStrain(state);
+    double strain_rate = getStrainRate(state);
+
+    if (strain <= 0 || strain_rate <= 0) {
+        return 0.0;
+    }
+
+    return get_damping_coefficient() * calcDampingPhaseOut(strain);
+}
+
+void Blankevoort1991Ligament::computeGeneralizedForceDerivatives(
+        const SimTK::State& state,
+        const std::vector<SimTK::ReferencePtr<const Coordinate>>& coordinates,
+        SimTK::Matrix& dfdq, SimTK::Matrix& dfdu) const {
+    int nCoord = static_cast<int>(coordinates.size());
+
+    dfdq.resize(nCoord, nCoord);
+    dfdu.resize(nCoord, nCoord);
+    dfdq = 0;
+    dfdu = 0;
+
+    SimTK::Vector dldq(nCoord);
+    addInGeneralizedForceDerivatives(state, coordinates, dldq, dfdq, dfdu);
+}
+
+void Blankevoort1991Ligament::addInGeneralizedForceDerivatives(
+        const SimTK::State& state,
+        const std::vector<SimTK::ReferencePtr<const Coordinate>>& coordinates,
+        SimTK::Vector& dldq, SimTK::Matrix& dfdq, SimTK::Matrix& dfdu) const {
+    if (!get_appliesForce() || !appliesForce(state)) {
+        return;
+    }
+
+    double inv_l0 = 1.0 / get_slack_length();
+    double dfdl = calcForceStrainDerivative(state) * inv_l0;
+    double dfdl_dot = calcForceStrainRateDerivative(state) * inv_l0;
+
+    // Slack ligaments do not contribute
+    if (dfdl == 0.0 && dfdl_dot == 0.0) {
+        return;
+    }
+
+    int nCoord = static_cast<int>(coordinates.size());
+    calcPathLengthDerivatives(state, coordinates, dldq);
+
+    // Second derivatives of the path length (change in moment arm) and the
+    // lengthening speed derivatives by central differences over the 
+    // coordinates that the path spans
+    SimTK::Matrix d2ldq2(nCoord, nCoord, 0.0);
+    SimTK::Vector dldotdq(nCoord, 0.0);
+    SimTK::Vector dldq_plus(nCoord), dldq_minus(nCoord);
+
+    const SimTK::MultibodySystem& system = getModel().getMultibodySystem();
+    SimTK::State s = state;
+
+    for (int j = 0; j < nCoord; ++j) {
+        if (dldq(j) == 0.0) continue;
+
+        const Coordinate& coord = *coordinates[j];
+        double value = coord.getValue(state);
+
+        coord.setValue(s, value + PATH_DERIVATIVE_STEP, false);
+        system.realize(s, SimTK::Stage::Velocity);
+        calcPathLengthDerivatives(s, coordinates, dldq_plus);
+        double speed_plus = calcPathLengtheningSpeed(s);
+
+        coord.setValue(s, value - PATH_DERIVATIVE_STEP, false);
+        system.realize(s, SimTK::Stage::Velocity);
+        calcPathLengthDerivatives(s, coordinates, dldq_minus);
+        double speed_minus = calcPathLengtheningSpeed(s);
+
+        coord.setValue(s, value, false);
+
+        for (int i = 0; i < nCoord; ++i) {
+            d2ldq2(i, j) = (dldq_plus(i) - dldq_minus(i)) /
+                (2 * PATH_DERIVATIVE_STEP);
+        }
+        dldotdq(j) = (speed_plus - speed_minus) / (2 * PATH_DERIVATIVE_STEP);
+    }
+
+    // tau_i = -dL/dq_i * F(L, L_dot)
+    double force = getTotalForce(state);
+
+    for (int i = 0; i < nCoord; ++i) {
+        for (int j = 0; j < nCoord; ++j) {
+            if (dldq(j) == 0.0) continue;
+
+            dfdq(i, j) -= d2ldq2(i, j) * force + dldq(i) *
+                (dfdl * dldq(j) + dfdl_dot * dldotdq(j));
+            dfdu(i, j) -= dldq(i) * dfdl_dot * dldq(j);
+        }
+    }
+}
+
+void Blankevoort1991Ligament::calcPathLengthDerivatives(
+        const SimTK::State& state,
+        const std::vector<SimTK::ReferencePtr<const Coordinate>>& coordinates,
+        SimTK::Vector& dldq) const {
+    int nCoord = static_cast<int>(coordinates.size());
+
+    if (get_use_path_surrogate()) {
+        const SimTK::Vector& surrogate_dldq = getPathLengthDerivative(state);
+
+        for (int i = 0; i < nCoord; ++i) {
+            int index = _path_surrogate.findCoordinateIndex(*coordinates[i]);
+            dldq(i) = index == -1 ? 0.0 : surrogate_dldq(index);
+        }
+    }
+    else {
+        for (int i = 0; i < nCoord; ++i) {
+            dldq(i) = -get_GeometryPath().computeMomentArm(
+                state, *coordinates[i]);
+        }
+    }
+}
+
+//=============================================================================
+// PATH SURROGATE
+//=============================================================================
+void Blankevoort1991Ligament::initializePathSurrogate(
+        const SimTK::State& state) const {
+    if (!get_use_path_surrogate() || _path_surrogate.isFitted()) {
+        return;
+    }
+
+    std::string file;
+    if (!get_path_surrogate_directory().empty()) {
+        file = get_path_surrogate_directory() + "/" + getName() +
+            "_path_surrogate.txt";
+
+        if (_path_surrogate.read(file, _path_surrogate_signature)) {
+            _path_surrogate.connectToModel(getModel());
+            return;
+        }
+    }
+
+    _path_surrogate.fit(getModel(), get_GeometryPath(), state,
+        get_path_surrogate_order(), get_path_surrogate_num_samples(),
+        _path_surrogate_signature);
+
+    std::cout << "Blankevoort1991Ligament " << getName() << 
+        " path surrogate: " << _path_surrogate.getNumCoordinates() <<
+        " coordinates, " << _path_surrogate.getNumTerms() << " terms, " <<
+        "RMS error: " << _path_surrogate.getRMSError() << " m, " <<
+        "max error: " << _path_surrogate.getMaxError() << " m" << std::endl;
+
+    if (!file.empty()) {
+        _path_surrogate.write(file);
+    }
+}
+
+const SimTK::Vector& Blankevoort1991Ligament::getPathLengthDerivative(
+        const SimTK::State& state) const {
+    if (!isCacheVariableValid(state, "surrogate_length")) {
+        OPENSIM_THROW_IF_FRMOBJ(!_path_surrogate.isFitted(), Exception,
+            "The path surrogate is not fit, call initSystem() first.");
+
+        SimTK::Vector& dldq = updCacheVariableValue<SimTK::Vector>(
+            state, "surrogate_length_derivative");
+        dldq.resize(_path_surrogate.getNumCoordinates());
+
+        double length = _path_surrogate.calcLength(state, dldq);
+
+        markCacheVariableValid(state, "surrogate_length_derivative");
+        setCacheVariableValue<double>(state, "surrogate_length", length);
+    }
+    return getCacheVariableValue<SimTK::Vector>(
+        state, "surrogate_length_derivative");
+}
+
+double Blankevoort1991Ligament::calcPathLength(
+        const SimTK::State& state) const {
+    if (get_use_path_surrogate()) {
+        getPathLengthDerivative(state);
+        return getCacheVariableValue<double>(state, "surrogate_length");
+    }
+    return get_GeometryPath().getLength(state);
+}
+
+double Blankevoort1991Ligament::calcPathLengtheningSpeed(
+        const SimTK::State& state) const {
+    if (get_use_path_surrogate()) {
+        const SimTK::Vector& dldq = getPathLengthDerivative(state);
+
+        double speed = 0.0;
+        for (int i = 0; i < dldq.size(); ++i) {
+            speed += dldq(i) *
+                _path_surrogate.getCoordinate(i).getSpeedValue(state);
+        }
+        return speed;
+    }
+    return get_GeometryPath().getLengtheningSpeed(state);
+}
+
+void Blankevoort1991Ligament::applyPathForce(const SimTK::State& state,
+        double force, SimTK::Vector_<SimTK::SpatialVec>& bodyForces,
+        SimTK::Vector& generalizedForces) const {
+    if (get_use_path_surrogate()) {
+        // Tension acts to shorten the path: tau = -dL/dq * F
+        const SimTK::Vector& dldq = getPathLengthDerivative(state);
+
+        for (int i = 0; i < dldq.size(); ++i) {
+            applyGeneralizedForce(state, _path_surrogate.getCoordinate(i),
+                -dldq(i) * force, generalizedForces);
+        }
+        return;
+    }
+    get_GeometryPath().addInEquivalentForces(
+        state, force, bodyForces, generalizedForces);
+}
+
 //=============================================================================
 // Reporting
 //=============================================================================
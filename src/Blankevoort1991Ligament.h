@@ -25,9 +25,12 @@
 
 #include <OpenSim/Simulation/Model/Force.h>
 #include <OpenSim/Simulation/Model/GeometryPath.h>
+#include "PolynomialPathSurrogate.h"
 #include "osimPluginDLL.h"
 namespace OpenSim {
 
+class Blankevoort1991LigamentSet;
+
 //=============================================================================
 //                         Blankevoort1991Ligament
 //=============================================================================
@@ -114,6 +117,21 @@ to consider the order of scaling the model and setting the slack_length
 property for your specific application. The linear_stiffness property is not 
 affected by scaling the model. 
 
+Models with many ligament bundles can add a Blankevoort1991LigamentSet to
+evaluate the ligaments together in a single batched computation. The 
+outputs and get methods of each ligament are unchanged.
+
+For ligaments that wrap over surfaces, the GeometryPath computations can
+dominate the cost of the force evaluation. Setting use_path_surrogate 
+replaces the path with a PolynomialPathSurrogate: a polynomial fit of the 
+path length as a function of the spanned coordinates, which is fit when the
+model state is initialized (initSystem()) with the coordinates at their
+default values (and optionally cached in path_surrogate_directory). The length, lengthening speed and moment arms are
+computed from the polynomial and the force is applied as generalized forces 
+on the spanned coordinates. The fit error against the full path is printed 
+when the surrogate is fit. Note the visualized path is still the 
+GeometryPath.
+
 ### References
 
 [1] Blankevoort, L. and Huiskes, R., (1991).
@@ -191,6 +209,22 @@ public:
         " damping force. Units of N*s/strain. Default value of 0.003.")
     OpenSim_DECLARE_PROPERTY(slack_length, double,
         "The length at which ligament begins developing tension. Units of m.")
+    OpenSim_DECLARE_PROPERTY(use_path_surrogate, bool,
+        "Compute the length, lengthening speed and moment arms from a "
+        "polynomial fit of the GeometryPath length as a function of the "
+        "spanned coordinates instead of the full path (and wrapping) "
+        "computations. The force is applied as generalized forces. "
+        "Default value of false.")
+    OpenSim_DECLARE_PROPERTY(path_surrogate_order, int,
+        "Total degree of the path surrogate polynomial. Default value of 3.")
+    OpenSim_DECLARE_PROPERTY(path_surrogate_num_samples, int,
+        "Number of random poses used to fit the path surrogate. Set to 0 to "
+        "use three times the number of polynomial terms. Default value of 0.")
+    OpenSim_DECLARE_PROPERTY(path_surrogate_directory, std::string,
+        "Directory where the path surrogate fit is cached to disk "
+        "(<ligament name>_path_surrogate.txt). The cached fit is reused if "
+        "the path, coordinate ranges and fit settings are unchanged. "
+        "Set to empty to disable the cache. Default value is empty.")
 
     //=========================================================================
     // OUTPUTS
@@ -288,9 +322,48 @@ public:
     //-------------------------------------------------------------------------
     // COMPUTATIONS
     //-------------------------------------------------------------------------
+    /** Fit (or read from path_surrogate_directory) the path surrogate if
+    use_path_surrogate is true and it is not fit yet. state provides the
+    values of the coordinates that are not spanned by the path. This is 
+    called by initSystem() with the coordinates at their default values. */
+    void initializePathSurrogate(const SimTK::State& state) const;
+
+    const PolynomialPathSurrogate& getPathSurrogate() const {
+        return _path_surrogate;
+    }
+
     double computeMomentArm(
         const SimTK::State& s, Coordinate& aCoord) const;
 
+    /** Derivative of the total force with respect to strain (N/strain),
+    including the strain dependence of the damping force. */
+    double calcForceStrainDerivative(const SimTK::State& state) const;
+
+    /** Derivative of the total force with respect to strain rate
+    (N*s/strain). */
+    double calcForceStrainRateDerivative(const SimTK::State& state) const;
+
+    /** Compute the derivatives of the generalized forces applied by the
+    ligament to the input coordinates with respect to the values (dfdq) and
+    speeds (dfdu) of the same coordinates, using the closed form derivatives
+    of the force-strain curve and the path length derivatives (dL/dq =
+    -moment arm):
+
+    dfdq = -d2L/dq2 * F - dL/dq * (dF/de / l0 * dL/dq^T + 
+                                   dF/de_dot / l0 * dL_dot/dq^T)
+    dfdu = -dL/dq * (dF/de_dot / l0) * dL/dq^T
+
+    The change in moment arm with pose (d2L/dq2) and in lengthening speed 
+    with pose (dL_dot/dq) are computed by central differences of dL/dq and 
+    L_dot over the coordinates with a non-zero moment arm. The matrices are
+    resized to coordinates.size() x coordinates.size(), row i is the 
+    generalized force on coordinate i. With use_path_surrogate the path 
+    length derivatives are evaluated from the polynomial, otherwise
+    GeometryPath::computeMomentArm() is called for each coordinate. */
+    void computeGeneralizedForceDerivatives(const SimTK::State& state,
+        const std::vector<SimTK::ReferencePtr<const Coordinate>>& coordinates,
+        SimTK::Matrix& dfdq, SimTK::Matrix& dfdu) const;
+
     void computeForce(const SimTK::State& s, 
         SimTK::Vector_<SimTK::SpatialVec>& bodyForces,
         SimTK::Vector& generalizedForces) const override;
@@ -314,16 +387,56 @@ public:
 protected:
 
     void extendFinalizeFromProperties() override;
+    void extendConnectToModel(Model& model) override;
     void extendAddToSystem(SimTK::MultibodySystem& system) const override;
+    void extendInitStateFromProperties(SimTK::State& state) const override;
+
+    // Path length, speed and force application using the GeometryPath or
+    // the path surrogate (use_path_surrogate)
+    double calcPathLength(const SimTK::State& state) const;
+    double calcPathLengtheningSpeed(const SimTK::State& state) const;
+    void applyPathForce(const SimTK::State& state, double force,
+        SimTK::Vector_<SimTK::SpatialVec>& bodyForces,
+        SimTK::Vector& generalizedForces) const;
+    const SimTK::Vector& getPathLengthDerivative(
+        const SimTK::State& state) const;
+
+    // Add the generalized force derivatives to dfdq and dfdu, dldq is
+    // scratch storage sized coordinates.size()
+    void addInGeneralizedForceDerivatives(const SimTK::State& state,
+        const std::vector<SimTK::ReferencePtr<const Coordinate>>& coordinates,
+        SimTK::Vector& dldq, SimTK::Matrix& dfdq, SimTK::Matrix& dfdu) const;
+
+    // Path length derivative (-moment arm) for each coordinate
+    void calcPathLengthDerivatives(const SimTK::State& state,
+        const std::vector<SimTK::ReferencePtr<const Coordinate>>& coordinates,
+        SimTK::Vector& dldq) const;
 
     double calcSpringForce(const SimTK::State& state) const;
     double calcDampingForce(const SimTK::State& state) const;
     double calcTotalForce(const SimTK::State& state) const;
     double calcInverseForceStrainCurve(double force) const;
 
+    // Smooth-step factor (0 to 1) that phases out the damping force as the
+    // strain goes to zero, shared with the Blankevoort1991LigamentSet
+    static double calcDampingPhaseOut(double strain);
+
 private:
     void setNull();
     void constructProperties();
+
+    // The Blankevoort1991LigamentSet this ligament is evaluated by (if any)
+    friend class Blankevoort1991LigamentSet;
+    SimTK::ReferencePtr<const Blankevoort1991LigamentSet> _ligament_set;
+    int _ligament_set_index = -1;
+
+    // Constants of the force-strain curve, set in extendFinalizeFromProperties
+    double _toe_coefficient;
+    double _half_transition_strain;
+
+    // Fit in extendInitStateFromProperties, so mutable
+    mutable PolynomialPathSurrogate _path_surrogate;
+    std::uint64_t _path_surrogate_signature = 0;
 //=============================================================================
 }; // END of class Blankevoort1991Ligament
 //=============================================================================
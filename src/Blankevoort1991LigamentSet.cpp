@@ -0,0 +1,256 @@
+/* -------------------------------------------------------------------------- *
+ *                      Blankevoort1991LigamentSet.cpp                        *
+ * -------------------------------------------------------------------------- *
+ * Author(s): Colin Smith                                                     *
+ *                                                                            *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may    *
+ * not use this file except in compliance with the License. You may obtain a  *
+ * copy of the License at http://www.apache.org/licenses/LICENSE-2.0.         *
+ *                                                                            *
+ * Unless required by applicable law or agreed to in writing, software        *
+ * distributed under the License is distributed on an "AS IS" BASIS,          *
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.   *
+ * See the License for the specific language governing permissions and        *
+ * limitations under the License.                                             *
+ * -------------------------------------------------------------------------- */
+
+#include <OpenSim/Simulation/Model/Model.h>
+#include "Blankevoort1991LigamentSet.h"
+
+using namespace OpenSim;
+
+//=============================================================================
+// CONSTRUCTORS
+//=============================================================================
+
+Blankevoort1991LigamentSet::Blankevoort1991LigamentSet() : Force() {
+    constructProperties();
+    setNull();
+}
+
+void Blankevoort1991LigamentSet::setNull()
+{
+    setAuthors("Colin Smith");
+}
+
+void Blankevoort1991LigamentSet::constructProperties() {
+    Array<std::string> defaultListAll;
+    defaultListAll.append("all");
+
+    constructProperty_ligaments(defaultListAll);
+}
+
+void Blankevoort1991LigamentSet::extendConnectToModel(Model& model) {
+    Super::extendConnectToModel(model);
+
+    _ligaments.clear();
+
+    //Release ligaments that were removed from the set
+    for (Blankevoort1991Ligament& lig :
+        model.updComponentList<Blankevoort1991Ligament>()) {
+        if (lig._ligament_set.get() == this) {
+            lig._ligament_set.reset();
+            lig._ligament_set_index = -1;
+        }
+    }
+
+    std::vector<std::string> paths;
+    if (getProperty_ligaments().size() > 0 && get_ligaments(0) == "all") {
+        for (const Blankevoort1991Ligament& lig :
+            model.getComponentList<Blankevoort1991Ligament>()) {
+            paths.push_back(lig.getAbsolutePathString());
+        }
+    }
+    else {
+        for (int i = 0; i < getProperty_ligaments().size(); ++i) {
+            paths.push_back(get_ligaments(i));
+        }
+    }
+
+    int nLig = static_cast<int>(paths.size());
+
+    _inv_slack_length.resize(nLig);
+    _linear_stiffness.resize(nLig);
+    _transition_strain.resize(nLig);
+    _toe_coefficient.resize(nLig);
+    _damping_coefficient.resize(nLig);
+
+    for (int i = 0; i < nLig; ++i) {
+        Blankevoort1991Ligament& lig =
+            model.updComponent<Blankevoort1991Ligament>(paths[i]);
+
+        OPENSIM_THROW_IF_FRMOBJ(!lig._ligament_set.empty() &&
+            lig._ligament_set.get() != this, Exception, "Ligament " +
+            lig.getName() + " already belongs to another "
+            "Blankevoort1991LigamentSet.")
+
+        lig._ligament_set.reset(this);
+        lig._ligament_set_index = i;
+        _ligaments.push_back(
+            SimTK::ReferencePtr<const Blankevoort1991Ligament>(lig));
+
+        double k = lig.get_linear_stiffness();
+        double e_t = lig.get_transition_strain();
+
+        _inv_slack_length[i] = 1.0 / lig.get_slack_length();
+        _linear_stiffness[i] = k;
+        _transition_strain[i] = e_t;
+        _toe_coefficient[i] = 0.5 * k / e_t;
+        _damping_coefficient[i] = lig.get_damping_coefficient();
+    }
+}
+
+void Blankevoort1991LigamentSet::extendAddToSystem(
+        SimTK::MultibodySystem& system) const {
+    Super::extendAddToSystem(system);
+
+    int nLig = getNumLigaments();
+
+    PositionData pos_data;
+    pos_data.length.resize(nLig, 0.0);
+    pos_data.strain.resize(nLig, 0.0);
+    pos_data.spring_force.resize(nLig, 0.0);
+
+    VelocityData vel_data;
+    vel_data.lengthening_speed.resize(nLig, 0.0);
+    vel_data.strain_rate.resize(nLig, 0.0);
+    vel_data.damping_force.resize(nLig, 0.0);
+    vel_data.total_force.resize(nLig, 0.0);
+
+    addCacheVariable<PositionData>("position_data", pos_data,
+        SimTK::Stage::Position);
+    addCacheVariable<VelocityData>("velocity_data", vel_data,
+        SimTK::Stage::Velocity);
+}
+
+//=============================================================================
+// COMPUTATION
+//=============================================================================
+
+const Blankevoort1991LigamentSet::PositionData&
+Blankevoort1991LigamentSet::getPositionData(const SimTK::State& state) const {
+    if (isCacheVariableValid(state, "position_data")) {
+        return getCacheVariableValue<PositionData>(state, "position_data");
+    }
+
+    PositionData& data =
+        updCacheVariableValue<PositionData>(state, "position_data");
+    int nLig = getNumLigaments();
+
+    //Gather the path lengths (GeometryPath or path surrogate)
+    for (int i = 0; i < nLig; ++i) {
+        data.length[i] = _ligaments[i]->calcPathLength(state);
+    }
+
+    const double* length = data.length.data();
+    const double* inv_l0 = _inv_slack_length.data();
+    const double* k = _linear_stiffness.data();
+    const double* e_t = _transition_strain.data();
+    const double* toe = _toe_coefficient.data();
+    double* strain = data.strain.data();
+    double* spring_force = data.spring_force.data();
+
+    for (int i = 0; i < nLig; ++i) {
+        strain[i] = length[i] * inv_l0[i] - 1;
+    }
+
+    // slack region F = 0
+    // toe region F = 1/2 * k / e_t * e^2
+    // linear region F = k * (e-e_t/2)
+    for (int i = 0; i < nLig; ++i) {
+        double e = strain[i];
+        double toe_force = toe[i] * e * e;
+        double linear_force = k[i] * (e - e_t[i] / 2);
+        spring_force[i] = e <= 0 ? 0.0 : (e < e_t[i] ? toe_force : linear_force);
+    }
+
+    markCacheVariableValid(state, "position_data");
+    return data;
+}
+
+const Blankevoort1991LigamentSet::VelocityData&
+Blankevoort1991LigamentSet::getVelocityData(const SimTK::State& state) const {
+    if (isCacheVariableValid(state, "velocity_data")) {
+        return getCacheVariableValue<VelocityData>(state, "velocity_data");
+    }
+
+    const PositionData& pos_data = getPositionData(state);
+    VelocityData& data =
+        updCacheVariableValue<VelocityData>(state, "velocity_data");
+    int nLig = getNumLigaments();
+
+    //Gather the path lengthening speeds
+    for (int i = 0; i < nLig; ++i) {
+        data.lengthening_speed[i] =
+            _ligaments[i]->calcPathLengtheningSpeed(state);
+    }
+
+    const double* speed = data.lengthening_speed.data();
+    const double* inv_l0 = _inv_slack_length.data();
+    const double* c = _damping_coefficient.data();
+    const double* strain = pos_data.strain.data();
+    const double* spring_force = pos_data.spring_force.data();
+    double* strain_rate = data.strain_rate.data();
+    double* damping_force = data.damping_force.data();
+    double* total_force = data.total_force.data();
+
+    for (int i = 0; i < nLig; ++i) {
+        strain_rate[i] = speed[i] * inv_l0[i];
+    }
+
+    //Damping only when stretched and lengthening, phased-out with the same
+    //smooth-step function as Blankevoort1991Ligament
+    for (int i = 0; i < nLig; ++i) {
+        double e = strain[i];
+        damping_force[i] = (e > 0 && strain_rate[i] > 0) ? c[i] * 
+            strain_rate[i] * Blankevoort1991Ligament::calcDampingPhaseOut(e) 
+            : 0.0;
+    }
+
+    // make sure the ligament is only acting in tension
+    for (int i = 0; i < nLig; ++i) {
+        double force = spring_force[i] + damping_force[i];
+        total_force[i] = force < 0.0 ? 0.0 : force;
+    }
+
+    markCacheVariableValid(state, "velocity_data");
+    return data;
+}
+
+void Blankevoort1991LigamentSet::computeGeneralizedForceDerivatives(
+        const SimTK::State& state,
+        const std::vector<SimTK::ReferencePtr<const Coordinate>>& coordinates,
+        SimTK::Matrix& dfdq, SimTK::Matrix& dfdu) const {
+    int nCoord = static_cast<int>(coordinates.size());
+
+    dfdq.resize(nCoord, nCoord);
+    dfdu.resize(nCoord, nCoord);
+    dfdq = 0;
+    dfdu = 0;
+
+    SimTK::Vector dldq(nCoord);
+    for (int i = 0; i < getNumLigaments(); ++i) {
+        _ligaments[i]->addInGeneralizedForceDerivatives(
+            state, coordinates, dldq, dfdq, dfdu);
+    }
+}
+
+void Blankevoort1991LigamentSet::computeForce(const SimTK::State& s,
+    SimTK::Vector_<SimTK::SpatialVec>& bodyForces,
+    SimTK::Vector& generalizedForces) const {
+
+    const VelocityData& data = getVelocityData(s);
+
+    for (int i = 0; i < getNumLigaments(); ++i) {
+        const Blankevoort1991Ligament& lig = *_ligaments[i];
+
+        //Slack ligaments do not contribute
+        if (data.total_force[i] == 0.0 || !lig.get_appliesForce() ||
+            !lig.appliesForce(s)) {
+            continue;
+        }
+
+        lig.applyPathForce(
+            s, data.total_force[i], bodyForces, generalizedForces);
+    }
+}
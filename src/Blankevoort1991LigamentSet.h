@@ -0,0 +1,171 @@
+#ifndef OPENSIM_BLANKEVOORT_1991_LIGAMENT_SET_H_
+#define OPENSIM_BLANKEVOORT_1991_LIGAMENT_SET_H_
+/* -------------------------------------------------------------------------- *
+ *                       Blankevoort1991LigamentSet.h                         *
+ * -------------------------------------------------------------------------- *
+ * Author(s): Colin Smith                                                     *
+ *                                                                            *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may    *
+ * not use this file except in compliance with the License. You may obtain a  *
+ * copy of the License at http://www.apache.org/licenses/LICENSE-2.0.         *
+ *                                                                            *
+ * Unless required by applicable law or agreed to in writing, software        *
+ * distributed under the License is distributed on an "AS IS" BASIS,          *
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.   *
+ * See the License for the specific language governing permissions and        *
+ * limitations under the License.                                             *
+ * -------------------------------------------------------------------------- */
+
+#include <OpenSim/Simulation/Model/Force.h>
+#include "Blankevoort1991Ligament.h"
+#include "osimPluginDLL.h"
+
+namespace OpenSim {
+
+//=============================================================================
+//                       Blankevoort1991LigamentSet
+//=============================================================================
+/**
+This Force component evaluates a group of Blankevoort1991Ligaments together.
+Knee models typically contain many ligament bundles (e.g. the lenhart2015
+model has 76), and evaluating each one as a separate Force component adds a
+virtual call and several cache variable lookups per bundle to every force
+evaluation.
+
+The Blankevoort1991LigamentSet gathers the length and lengthening speed of
+all ligaments in the set after the GeometryPaths have been realized and
+computes the strain, spring force, damping force, and total force of all
+bundles in one pass over contiguous (structure-of-arrays) storage. The
+resulting forces are then applied by the Blankevoort1991LigamentSet, and the
+ligaments in the set skip their own computeForce(). The ligament parameters
+(slack_length, linear_stiffness, transition_strain, damping_coefficient)
+are gathered when the model is connected (e.g. initSystem()).
+
+The outputs and get methods of each Blankevoort1991Ligament are still
+available and return the values stored by the Blankevoort1991LigamentSet.
+The force-strain relationship is identical to the Blankevoort1991Ligament.
+
+To use, add the component to the ForceSet of a model containing
+Blankevoort1991Ligaments:
+
+\code
+<Blankevoort1991LigamentSet name="ligament_set">
+    <ligaments>all</ligaments>
+</Blankevoort1991LigamentSet>
+\endcode
+
+A ligament can only belong to one Blankevoort1991LigamentSet. If the
+appliesForce property of the Blankevoort1991LigamentSet is false, the
+ligaments apply their own forces.
+
+@author Colin Smith
+*/
+
+class OSIMPLUGIN_API Blankevoort1991LigamentSet : public Force {
+OpenSim_DECLARE_CONCRETE_OBJECT(Blankevoort1991LigamentSet, Force)
+
+public:
+//=============================================================================
+// PROPERTIES
+//=============================================================================
+    OpenSim_DECLARE_LIST_PROPERTY(ligaments, std::string,
+        "Paths to the Blankevoort1991Ligaments to evaluate together. "
+        "The default value is 'all'.")
+
+//=============================================================================
+// METHODS
+//=============================================================================
+    Blankevoort1991LigamentSet();
+
+    int getNumLigaments() const {
+        return static_cast<int>(_ligaments.size());
+    }
+
+    const Blankevoort1991Ligament& getLigament(int index) const {
+        return *_ligaments[index];
+    }
+
+    //-------------------------------------------------------------------------
+    // GET (index of the ligament in the set)
+    //-------------------------------------------------------------------------
+    double getLength(const SimTK::State& state, int index) const {
+        return getPositionData(state).length[index];
+    }
+    double getStrain(const SimTK::State& state, int index) const {
+        return getPositionData(state).strain[index];
+    }
+    double getSpringForce(const SimTK::State& state, int index) const {
+        return getPositionData(state).spring_force[index];
+    }
+    double getLengtheningSpeed(const SimTK::State& state, int index) const {
+        return getVelocityData(state).lengthening_speed[index];
+    }
+    double getStrainRate(const SimTK::State& state, int index) const {
+        return getVelocityData(state).strain_rate[index];
+    }
+    double getDampingForce(const SimTK::State& state, int index) const {
+        return getVelocityData(state).damping_force[index];
+    }
+    double getTotalForce(const SimTK::State& state, int index) const {
+        return getVelocityData(state).total_force[index];
+    }
+
+    //-------------------------------------------------------------------------
+    // COMPUTATIONS
+    //-------------------------------------------------------------------------
+    /** Compute the derivatives of the generalized forces applied by all
+    ligaments in the set to the input coordinates with respect to the values
+    (dfdq) and speeds (dfdu) of the same coordinates. This is the sum of
+    Blankevoort1991Ligament::computeGeneralizedForceDerivatives() over the
+    ligaments, and can be used to assemble the ligament contribution to the
+    stiffness and damping of the system without re-realizing the model. */
+    void computeGeneralizedForceDerivatives(const SimTK::State& state,
+        const std::vector<SimTK::ReferencePtr<const Coordinate>>& coordinates,
+        SimTK::Matrix& dfdq, SimTK::Matrix& dfdu) const;
+
+    void computeForce(const SimTK::State& s,
+        SimTK::Vector_<SimTK::SpatialVec>& bodyForces,
+        SimTK::Vector& generalizedForces) const override;
+
+protected:
+    void extendConnectToModel(Model& model) override;
+    void extendAddToSystem(SimTK::MultibodySystem& system) const override;
+
+private:
+    void setNull();
+    void constructProperties();
+
+    struct PositionData {
+        std::vector<double> length;
+        std::vector<double> strain;
+        std::vector<double> spring_force;
+    };
+
+    struct VelocityData {
+        std::vector<double> lengthening_speed;
+        std::vector<double> strain_rate;
+        std::vector<double> damping_force;
+        std::vector<double> total_force;
+    };
+
+    const PositionData& getPositionData(const SimTK::State& state) const;
+    const VelocityData& getVelocityData(const SimTK::State& state) const;
+
+//=============================================================================
+// DATA
+//=============================================================================
+    std::vector<SimTK::ReferencePtr<const Blankevoort1991Ligament>> _ligaments;
+
+    //Ligament parameters (structure-of-arrays)
+    std::vector<double> _inv_slack_length;
+    std::vector<double> _linear_stiffness;
+    std::vector<double> _transition_strain;
+    std::vector<double> _toe_coefficient;
+    std::vector<double> _damping_coefficient;
+//=============================================================================
+}; // END of class Blankevoort1991LigamentSet
+//=============================================================================
+
+} // end of namespace OpenSim
+
+#endif // OPENSIM_BLANKEVOORT_1991_LIGAMENT_SET_H_
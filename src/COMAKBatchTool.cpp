@@ -0,0 +1,270 @@
+/* -------------------------------------------------------------------------- *
+ *                             COMAKBatchTool.cpp                             *
+ * -------------------------------------------------------------------------- *
+ * Author(s): Colin Smith                                                     *
+ *                                                                            *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may    *
+ * not use this file except in compliance with the License. You may obtain a  *
+ * copy of the License at http://www.apache.org/licenses/LICENSE-2.0.         *
+ *                                                                            *
+ * Unless required by applicable law or agreed to in writing, software        *
+ * distributed under the License is distributed on an "AS IS" BASIS,          *
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.   *
+ * See the License for the specific language governing permissions and        *
+ * limitations under the License.                                             *
+ * -------------------------------------------------------------------------- */
+
+#include "COMAKBatchTool.h"
+#include "COMAKTool.h"
+#include <OpenSim/Common/IO.h>
+#include <thread>
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+
+using namespace OpenSim;
+
+//=============================================================================
+// CONSTRUCTOR
+//=============================================================================
+COMAKBatchTool::COMAKBatchTool()
+{
+    constructProperties();
+    _directoryOfSetupFile = "";
+}
+
+COMAKBatchTool::COMAKBatchTool(const std::string file) : Object(file) {
+    constructProperties();
+    updateFromXMLDocument();
+    _directoryOfSetupFile = IO::getParentDirectory(file);
+    IO::chDir(_directoryOfSetupFile);
+}
+
+void COMAKBatchTool::constructProperties()
+{
+    constructProperty_trial_settings_files();
+    constructProperty_results_directory("");
+    constructProperty_num_parallel_trials(1);
+}
+
+//=============================================================================
+// RUN
+//=============================================================================
+void COMAKBatchTool::run()
+{
+    int n_trials = getProperty_trial_settings_files().size();
+    OPENSIM_THROW_IF(n_trials == 0, Exception,
+        "COMAKBatchTool: no trial_settings_files listed.");
+
+    int num_parallel = get_num_parallel_trials();
+    if (num_parallel < 1) {
+        num_parallel = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    }
+    num_parallel = std::min(num_parallel, n_trials);
+
+    std::string summary_directory = IO::getCwd();
+    if (!get_results_directory().empty()) {
+        summary_directory =
+            SimTK::Pathname::getAbsolutePathname(get_results_directory());
+        IO::makeDir(summary_directory);
+    }
+
+    //Trials are named after their settings files
+    _trial_names.assign(n_trials, "");
+    _trial_status.assign(n_trials, "");
+    _trial_messages.assign(n_trials, "");
+    _trial_frames.assign(n_trials, 0);
+    _trial_bad_frames.assign(n_trials, 0);
+    _trial_times.assign(n_trials, 0.0);
+
+    for (int i = 0; i < n_trials; ++i) {
+        bool dontApplySearchPath;
+        std::string directory, name, extension;
+        SimTK::Pathname::deconstructPathname(get_trial_settings_files(i),
+            dontApplySearchPath, directory, name, extension);
+
+        if (std::find(_trial_names.begin(), _trial_names.end(), name) !=
+            _trial_names.end()) {
+            name += "_" + std::to_string(i);
+        }
+        _trial_names[i] = name;
+    }
+
+    std::cout << "\nRunning " << n_trials << " COMAK trials, "
+        << num_parallel << " at a time.\n" << std::endl;
+
+    //Models loaded from each model_file, shared by all trials
+    std::map<std::string, std::unique_ptr<Model>> models;
+
+    for (int first = 0; first < n_trials; first += num_parallel) {
+        int n = std::min(num_parallel, n_trials - first);
+
+        std::vector<std::unique_ptr<COMAKTool>> tools(n);
+        std::vector<SimTK::Vector> init_secondary_values(n);
+
+        //Perform a step of trial first + k, a trial that failed is skipped
+        //in the following steps
+        auto step = [&](int k, const std::function<void(COMAKTool&)>& func) {
+            int trial = first + k;
+            if (!tools[k]) return;
+
+            double start = SimTK::realTime();
+            try {
+                func(*tools[k]);
+            }
+            catch (const std::exception& ex) {
+                _trial_status[trial] = "failed";
+                _trial_messages[trial] = ex.what();
+                tools[k].reset();
+            }
+            catch (...) {
+                _trial_status[trial] = "failed";
+                _trial_messages[trial] = "UNRECOGNIZED EXCEPTION";
+                tools[k].reset();
+            }
+            _trial_times[trial] += SimTK::realTime() - start;
+        };
+
+        //Setup the trials one at a time, loading the model and applying the
+        //external loads read files relative to the working directory
+        for (int k = 0; k < n; ++k) {
+            int trial = first + k;
+            std::cout << "Trial " << trial + 1 << "/" << n_trials << ": "
+                << _trial_names[trial] << std::endl;
+
+            double start = SimTK::realTime();
+            try {
+                tools[k].reset(loadTrial(trial, models));
+            }
+            catch (const std::exception& ex) {
+                _trial_status[trial] = "failed";
+                _trial_messages[trial] = ex.what();
+            }
+            _trial_times[trial] += SimTK::realTime() - start;
+
+            step(k, [](COMAKTool& tool) {
+                tool.initialize();
+                tool._model.initSystem();
+                tool.extractKinematicsFromFile();
+            });
+        }
+
+        COMAKTool::runInParallel(n, [&](int k) {
+            step(k, [&](COMAKTool& tool) {
+                init_secondary_values[k] = tool.computeInitialSecondaryValues();
+            });
+        });
+
+        for (int k = 0; k < n; ++k) {
+            step(k, [](COMAKTool& tool) {
+                tool.prepareCOMAKModel();
+            });
+        }
+
+        COMAKTool::runInParallel(n, [&](int k) {
+            step(k, [&](COMAKTool& tool) {
+                tool.solveCOMAK(init_secondary_values[k]);
+            });
+        });
+
+        for (int k = 0; k < n; ++k) {
+            int trial = first + k;
+            step(k, [&](COMAKTool& tool) {
+                std::cout << "\nTrial: " << _trial_names[trial] << std::endl;
+                tool.printConvergenceSummary();
+                tool.printResultsFiles();
+
+                _trial_status[trial] = "done";
+                _trial_frames[trial] = tool._n_out_frames;
+                _trial_bad_frames[trial] = (int)tool._bad_frames.size();
+            });
+        }
+    }
+
+    printSummary(summary_directory + "/comak_batch_summary.txt");
+}
+
+COMAKTool* COMAKBatchTool::loadTrial(int trial,
+    std::map<std::string, std::unique_ptr<Model>>& models)
+{
+    std::string settings_file = SimTK::Pathname::getAbsolutePathname(
+        get_trial_settings_files(trial));
+
+    //The COMAKTool changes the working directory to the directory of its
+    //settings file, so the trial paths are made absolute there
+    std::string cwd = IO::getCwd();
+    std::unique_ptr<COMAKTool> tool(new COMAKTool(settings_file));
+
+    auto absolute = [](const std::string& path) {
+        if (path.empty() || path == "Unassigned") return path;
+        return SimTK::Pathname::getAbsolutePathname(path);
+    };
+
+    tool->set_model_file(absolute(tool->get_model_file()));
+    tool->set_coordinates_file(absolute(tool->get_coordinates_file()));
+    tool->set_external_loads_file(absolute(tool->get_external_loads_file()));
+    tool->set_initial_guess_file(absolute(tool->get_initial_guess_file()));
+    tool->set_force_set_file(absolute(tool->get_force_set_file()));
+    tool->set_results_directory(absolute(tool->get_results_directory()));
+    tool->set_settle_sim_results_directory(
+        absolute(tool->get_settle_sim_results_directory()));
+    tool->set_settle_cache_directory(
+        absolute(tool->get_settle_cache_directory()));
+
+    IO::chDir(cwd);
+
+    if (!get_results_directory().empty()) {
+        tool->set_results_directory(
+            SimTK::Pathname::getAbsolutePathname(get_results_directory()) +
+            "/" + _trial_names[trial]);
+    }
+
+    if (tool->get_num_windows() > 1) {
+        std::cout << "num_windows is not used in a COMAKBatchTool, "
+            "the trials are solved in parallel instead." << std::endl;
+        tool->set_num_windows(1);
+    }
+    tool->set_use_visualizer(false);
+
+    //Load each model once, the trials start from a copy
+    std::unique_ptr<Model>& model = models[tool->get_model_file()];
+    if (!model) {
+        std::cout << "Loading model: " << tool->get_model_file() << std::endl;
+        model.reset(new Model(tool->get_model_file()));
+        model->finalizeFromProperties();
+    }
+    tool->setModel(*model);
+
+    return tool.release();
+}
+
+void COMAKBatchTool::printSummary(const std::string& file)
+{
+    std::ofstream out(file);
+    if (!out) {
+        std::cout << "Could not write batch summary file: " << file << std::endl;
+    }
+    out << "trial\tstatus\tframes\tbad_frames\ttime[s]\tmessage" << std::endl;
+
+    std::cout << "\nCOMAK Batch Summary:" << std::endl;
+    std::cout << "--------------------" << std::endl;
+    std::cout << std::setw(30) << "Trial" << std::setw(10) << "Status"
+        << std::setw(10) << "Frames" << std::setw(12) << "Bad Frames"
+        << std::setw(12) << "Time [s]" << std::endl;
+
+    for (int i = 0; i < (int)_trial_names.size(); ++i) {
+        out << _trial_names[i] << "\t" << _trial_status[i] << "\t"
+            << _trial_frames[i] << "\t" << _trial_bad_frames[i] << "\t"
+            << _trial_times[i] << "\t" << _trial_messages[i] << std::endl;
+
+        std::cout << std::setw(30) << _trial_names[i]
+            << std::setw(10) << _trial_status[i]
+            << std::setw(10) << _trial_frames[i]
+            << std::setw(12) << _trial_bad_frames[i]
+            << std::setw(12) << _trial_times[i] << std::endl;
+
+        if (!_trial_messages[i].empty()) {
+            std::cout << "    " << _trial_messages[i] << std::endl;
+        }
+    }
+}
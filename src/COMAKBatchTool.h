@@ -0,0 +1,101 @@
+#ifndef OPENSIM_COMAK_BATCH_TOOL_H_
+#define OPENSIM_COMAK_BATCH_TOOL_H_
+/* -------------------------------------------------------------------------- *
+ *                              COMAKBatchTool.h                              *
+ * -------------------------------------------------------------------------- *
+ * Author(s): Colin Smith                                                     *
+ *                                                                            *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may    *
+ * not use this file except in compliance with the License. You may obtain a  *
+ * copy of the License at http://www.apache.org/licenses/LICENSE-2.0.         *
+ *                                                                            *
+ * Unless required by applicable law or agreed to in writing, software        *
+ * distributed under the License is distributed on an "AS IS" BASIS,          *
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.   *
+ * See the License for the specific language governing permissions and        *
+ * limitations under the License.                                             *
+ * -------------------------------------------------------------------------- */
+
+#include "osimPluginDLL.h"
+#include <OpenSim/Simulation/Model/Model.h>
+
+namespace OpenSim {
+
+class COMAKTool;
+
+//=============================================================================
+//                         COMAK Batch Tool
+//=============================================================================
+/**
+Run the COMAKTool for a list of trials in one process. Each trial is defined
+by a COMAKTool settings file.
+
+Each model_file is loaded (and its contact meshes preprocessed) once, and
+every trial using it starts from a copy of the loaded model. Up to
+num_parallel_trials trials are solved concurrently: the settling of the
+secondary coordinates and the COMAK frame loop run in parallel, while the
+model setup and the printing of the results are done one trial at a time.
+
+A trial that fails does not stop the batch. The status, number of frames,
+number of frames that did not converge and computation time of each trial
+are printed to comak_batch_summary.txt in the results_directory.
+
+@author Colin Smith
+*/
+
+class OSIMPLUGIN_API COMAKBatchTool : public Object{
+    OpenSim_DECLARE_CONCRETE_OBJECT(COMAKBatchTool, Object)
+
+public:
+    OpenSim_DECLARE_LIST_PROPERTY(trial_settings_files, std::string,
+        "Paths to the COMAKTool settings files of the trials.")
+
+    OpenSim_DECLARE_PROPERTY(results_directory, std::string,
+        "Path to folder where the batch summary is written. If not empty, "
+        "the results of each trial are written to a subfolder named after "
+        "its settings file, otherwise the results_directory of each trial "
+        "settings file is used.")
+
+    OpenSim_DECLARE_PROPERTY(num_parallel_trials, int,
+        "Number of trials solved concurrently. Set to 0 to use the number of "
+        "hardware threads. The default value is 1.")
+
+//=============================================================================
+// METHODS
+//=============================================================================
+
+    /**
+    * Default constructor.
+    */
+    COMAKBatchTool();
+
+    //Construct from .xml file
+    COMAKBatchTool(const std::string file);
+
+    void run();
+
+private:
+    void constructProperties();
+    COMAKTool* loadTrial(int trial,
+        std::map<std::string, std::unique_ptr<Model>>& models);
+    void printSummary(const std::string& file);
+
+    //--------------------------------------------------------------------------
+    // Members
+    //--------------------------------------------------------------------------
+private:
+    std::string _directoryOfSetupFile;
+
+    std::vector<std::string> _trial_names;
+    std::vector<std::string> _trial_status;
+    std::vector<std::string> _trial_messages;
+    std::vector<int> _trial_frames;
+    std::vector<int> _trial_bad_frames;
+    std::vector<double> _trial_times;
+
+//=============================================================================
+};  // END of class COMAK_BATCH_TOOL
+
+}; //namespace
+
+#endif // OPENSIM_COMAK_BATCH_TOOL_H_
@@ -22,6 +22,7 @@
 #include <OpenSim.h>
 #include "COMAKInverseKinematicsTool.h"
 #include "HelperFunctions.h"
+#include "COMAKStaticEquilibriumSolver.h"
 #include <OpenSim/Common/IO.h>
 
 using namespace OpenSim;
@@ -67,6 +68,9 @@ void COMAKInverseKinematicsTool::constructProperties()
     constructProperty_secondary_coupled_coordinate_stop_value(0.0);
     constructProperty_secondary_constraint_sim_integrator_accuracy(1e-6);
     constructProperty_secondary_constraint_sim_internal_step_limit(-1);
+    constructProperty_secondary_constraint_sim_settle_method(
+        "forward_simulation");
+    constructProperty_secondary_constraint_sim_settle_max_iterations(50);
     constructProperty_constraint_function_num_interpolation_points(20);
     constructProperty_secondary_constraint_function_file(
         "secondary_coordinate_constraint_functions.xml");
@@ -186,6 +190,16 @@ void COMAKInverseKinematicsTool::initialize()
         get_secondary_coupled_coordinate() << std::endl;
 
     if (get_perform_secondary_constraint_sim()) {
+        OPENSIM_THROW_IF(
+            get_secondary_constraint_sim_settle_method() != "forward_simulation" &&
+            get_secondary_constraint_sim_settle_method() != "static_equilibrium",
+            Exception, "secondary_constraint_sim_settle_method: " + 
+            get_secondary_constraint_sim_settle_method() + " is not valid. "
+            "Options: 'forward_simulation', 'static_equilibrium'.");
+
+        std::cout << "Settle Method: " <<
+            get_secondary_constraint_sim_settle_method() << std::endl;
+
         std::cout << "Settle Threshold: " <<
             get_secondary_constraint_sim_settle_threshold() << std::endl;
 
@@ -300,6 +314,27 @@ void COMAKInverseKinematicsTool::performIKSecondaryConstraintSimulation() {
     }
     model.equilibrateMuscles(state);
 
+    StatesTrajectory settle_states;
+
+    //solve for static equilibrium
+    bool settled = false;
+    if (get_secondary_constraint_sim_settle_method() == "static_equilibrium") {
+        ComakStaticEquilibriumSolver solver(model, _secondary_coord_path);
+        solver.setTolerance(get_secondary_constraint_sim_settle_threshold());
+        solver.setMaxIterations(
+            get_secondary_constraint_sim_settle_max_iterations());
+        solver.setVerbose(get_verbose());
+
+        settled = solver.solve(state);
+        settle_states.append(state);
+
+        if (get_verbose() > 0 || !settled) {
+            std::cout << "Static equilibrium " << 
+                (settled ? "found" : "not found") << " in " << 
+                solver.getNumIterations() << " iterations." << std::endl;
+        }
+    }
+
     //setup integrator
     SimTK::CPodesIntegrator integrator(
         model.getSystem(), SimTK::CPodes::BDF, SimTK::CPodes::Newton);
@@ -311,19 +346,19 @@ void COMAKInverseKinematicsTool::performIKSecondaryConstraintSimulation() {
     }
     SimTK::TimeStepper timestepper(model.getSystem(), integrator);
 
-    timestepper.initialize(state);
-    
-    StatesTrajectory settle_states;
+    if (!settled) {
+        timestepper.initialize(state);
+    }
 
     double dt = 0.01;
  
-    if (get_verbose() > 0) {
+    if (get_verbose() > 0 && !settled) {
         std::cout << "Starting Settling Simulation."<< std::endl;
     }
 
     SimTK::Vector prev_sec_coord_value(_n_secondary_coord);
 
-    double max_coord_delta = SimTK::Infinity;
+    double max_coord_delta = settled ? 0.0 : SimTK::Infinity;
     int i = 1;
     while (max_coord_delta > get_secondary_constraint_sim_settle_threshold()){
         timestepper.stepTo(i*dt);
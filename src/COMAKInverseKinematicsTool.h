@@ -104,6 +104,20 @@ public:
         "Limit on the number of internal steps that can be taken by BDF "
         "integrator. If -1, then there is no limit. The Default value is -1")
 
+    OpenSim_DECLARE_PROPERTY(
+        secondary_constraint_sim_settle_method, std::string,
+        "Method used to settle the secondary coordinates before the sweep "
+        "simulation. Options: 'forward_simulation', 'static_equilibrium'. "
+        "'static_equilibrium' solves for the secondary coordinate values "
+        "where their accelerations vanish (Levenberg-Marquardt), the forward "
+        "simulation is used if it does not converge. "
+        "The default value is 'forward_simulation'.")
+
+    OpenSim_DECLARE_PROPERTY(
+        secondary_constraint_sim_settle_max_iterations, int,
+        "Maximum number of iterations of the static_equilibrium settle "
+        "method. The default value is 50.")
+
      OpenSim_DECLARE_PROPERTY(
          secondary_constraint_function_file, std::string, 
         "Name for .xml results file where secondary constraint functions "
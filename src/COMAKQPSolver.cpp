@@ -0,0 +1,422 @@
+/* -------------------------------------------------------------------------- *
+ *                            COMAKQPSolver.cpp                               *
+ * -------------------------------------------------------------------------- *
+ * Author(s): Colin Smith                                                     *
+ *                                                                            *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may    *
+ * not use this file except in compliance with the License. You may obtain a  *
+ * copy of the License at http://www.apache.org/licenses/LICENSE-2.0.         *
+ *                                                                            *
+ * Unless required by applicable law or agreed to in writing, software        *
+ * distributed under the License is distributed on an "AS IS" BASIS,          *
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.   *
+ * See the License for the specific language governing permissions and        *
+ * limitations under the License.                                             *
+ * -------------------------------------------------------------------------- */
+
+#include "COMAKQPSolver.h"
+#include <algorithm>
+#include <vector>
+
+using namespace OpenSim;
+
+// The equality rows use a larger ADMM step size than the bounds (as in OSQP)
+static const double RHO_EQ_SCALE = 1e3;
+// Residuals are checked and the solution polished every CHECK_INTERVAL
+// iterations
+static const int CHECK_INTERVAL = 25;
+static const int NUM_SCALING_ITERATIONS = 15;
+// Regularization of the polishing KKT system
+static const double POLISH_DELTA = 1e-9;
+
+static double clamp(double value, double min, double max) {
+    return std::min(std::max(value, min), max);
+}
+
+//=============================================================================
+// CONSTRUCTOR
+//=============================================================================
+ComakQPSolver::ComakQPSolver() :
+    _max_iterations(4000), _tolerance(1e-6), _sigma(1e-6), _alpha(1.6),
+    _c(1.0), _rho(0.1), _num_iterations(0), _polished(false)
+{
+}
+
+void ComakQPSolver::resetWarmStart() {
+    _y_eq.resize(0);
+    _y_bound.resize(0);
+}
+
+//=============================================================================
+// SOLVE
+//=============================================================================
+bool ComakQPSolver::solve(const SimTK::Vector& hessian,
+    const SimTK::Vector& gradient, const SimTK::Matrix& A,
+    const SimTK::Vector& b, const SimTK::Vector& lower,
+    const SimTK::Vector& upper, SimTK::Vector& x)
+{
+    int n = hessian.size();
+    int m = b.size();
+
+    _num_iterations = 0;
+    _polished = false;
+
+    scaleProblem(hessian, gradient, A);
+
+    _b_s.resize(m);
+    for (int i = 0; i < m; ++i) {
+        _b_s[i] = _E[i] * b[i];
+    }
+    _lower_s.resize(n);
+    _upper_s.resize(n);
+    for (int j = 0; j < n; ++j) {
+        _lower_s[j] = lower[j] / _D[j];
+        _upper_s[j] = upper[j] / _D[j];
+    }
+
+    //Warm start from the multipliers of the previous solve
+    if (_y_eq.size() != m || _y_bound.size() != n) {
+        _y_eq.resize(m);
+        _y_bound.resize(n);
+        _y_eq = 0;
+        _y_bound = 0;
+    }
+
+    SimTK::Vector x_s(n), z_bound(n), y_bound(n), y_eq(m);
+    for (int j = 0; j < n; ++j) {
+        x_s[j] = clamp(x[j] / _D[j], _lower_s[j], _upper_s[j]);
+        z_bound[j] = x_s[j];
+        y_bound[j] = _c * _D[j] * _y_bound[j];
+    }
+    for (int i = 0; i < m; ++i) {
+        y_eq[i] = _c * _y_eq[i] / _E[i];
+    }
+
+    _rho = 0.1;
+    factorize();
+
+    SimTK::Vector rhs(n), x_tilde(n), Ax(m), Aty(n);
+    bool solved = false;
+
+    for (int k = 1; k <= _max_iterations; ++k) {
+        _num_iterations = k;
+        double rho_eq = RHO_EQ_SCALE * _rho;
+
+        //Solve the linear system for x_tilde
+        for (int j = 0; j < n; ++j) {
+            rhs[j] = _sigma * x_s[j] - _g_s[j] + _rho * z_bound[j] - y_bound[j];
+        }
+        for (int i = 0; i < m; ++i) {
+            double w = rho_eq * _b_s[i] - y_eq[i];
+            for (int j = 0; j < n; ++j) {
+                rhs[j] += _A_s(i, j) * w;
+            }
+        }
+        _K_factor.solve(rhs, x_tilde);
+
+        //Update the equality multipliers (z is always b)
+        for (int i = 0; i < m; ++i) {
+            double z_tilde = 0;
+            for (int j = 0; j < n; ++j) {
+                z_tilde += _A_s(i, j) * x_tilde[j];
+            }
+            double z_relaxed = _alpha * z_tilde + (1 - _alpha) * _b_s[i];
+            y_eq[i] += rho_eq * (z_relaxed - _b_s[i]);
+        }
+
+        //Project onto the bounds and update the bound multipliers
+        for (int j = 0; j < n; ++j) {
+            double z_relaxed = _alpha * x_tilde[j] + (1 - _alpha) * z_bound[j];
+            double z_new = clamp(z_relaxed + y_bound[j] / _rho,
+                _lower_s[j], _upper_s[j]);
+
+            y_bound[j] += _rho * (z_relaxed - z_new);
+            z_bound[j] = z_new;
+            x_s[j] = _alpha * x_tilde[j] + (1 - _alpha) * x_s[j];
+        }
+
+        if (k % CHECK_INTERVAL != 0 && k != _max_iterations) {
+            continue;
+        }
+
+        //Unscaled residuals
+        double prim_res = 0, prim_norm = 0;
+        for (int i = 0; i < m; ++i) {
+            Ax[i] = 0;
+            for (int j = 0; j < n; ++j) {
+                Ax[i] += _A_s(i, j) * x_s[j];
+            }
+            prim_res = std::max(prim_res, std::abs(Ax[i] - _b_s[i]) / _E[i]);
+            prim_norm = std::max(prim_norm, std::abs(Ax[i]) / _E[i]);
+            prim_norm = std::max(prim_norm, std::abs(_b_s[i]) / _E[i]);
+        }
+        for (int j = 0; j < n; ++j) {
+            prim_res = std::max(prim_res, std::abs(x_s[j] - z_bound[j]) * _D[j]);
+            prim_norm = std::max(prim_norm, std::abs(x_s[j]) * _D[j]);
+        }
+
+        double dual_res = 0, dual_norm = 0;
+        for (int j = 0; j < n; ++j) {
+            Aty[j] = 0;
+            for (int i = 0; i < m; ++i) {
+                Aty[j] += _A_s(i, j) * y_eq[i];
+            }
+            double scale = 1 / (_c * _D[j]);
+            double Hx = _h_s[j] * x_s[j];
+
+            dual_res = std::max(dual_res,
+                std::abs(Hx + _g_s[j] + Aty[j] + y_bound[j]) * scale);
+            dual_norm = std::max(dual_norm, std::max(
+                std::max(std::abs(Hx), std::abs(_g_s[j])),
+                std::max(std::abs(Aty[j]), std::abs(y_bound[j]))) * scale);
+        }
+
+        //Solve directly with the active set guessed from the multipliers
+        SimTK::Vector x_polish, y_eq_polish, y_bound_polish;
+        if (polish(x_s, z_bound, y_eq, y_bound,
+            x_polish, y_eq_polish, y_bound_polish)) {
+            x_s = x_polish;
+            y_eq = y_eq_polish;
+            y_bound = y_bound_polish;
+            _polished = true;
+            solved = true;
+            break;
+        }
+
+        if (prim_res <= _tolerance * (1 + prim_norm) &&
+            dual_res <= _tolerance * (1 + dual_norm)) {
+            solved = true;
+            break;
+        }
+
+        //Balance the primal and dual residuals
+        double ratio = std::sqrt((prim_res / (prim_norm + 1e-10)) /
+            (dual_res / (dual_norm + 1e-10) + 1e-10));
+        double rho_new = clamp(_rho * ratio, 1e-6, 1e6);
+
+        if (rho_new > 5 * _rho || rho_new < 0.2 * _rho) {
+            _rho = rho_new;
+            factorize();
+        }
+    }
+
+    if (!solved) {
+        resetWarmStart();
+        return false;
+    }
+
+    for (int j = 0; j < n; ++j) {
+        x[j] = clamp(_D[j] * x_s[j], lower[j], upper[j]);
+        _y_bound[j] = y_bound[j] / (_c * _D[j]);
+    }
+    for (int i = 0; i < m; ++i) {
+        _y_eq[i] = _E[i] * y_eq[i] / _c;
+    }
+    return true;
+}
+
+//=============================================================================
+// HELPERS
+//=============================================================================
+void ComakQPSolver::scaleProblem(const SimTK::Vector& hessian,
+    const SimTK::Vector& gradient, const SimTK::Matrix& A)
+{
+    int n = hessian.size();
+    int m = A.nrow();
+
+    _D.resize(n);
+    _E.resize(m);
+    _D = 1;
+    _E = 1;
+    _h_s = hessian;
+    _A_s = A;
+
+    //Ruiz equilibration of the KKT matrix [H A'; A 0]
+    for (int iter = 0; iter < NUM_SCALING_ITERATIONS; ++iter) {
+        for (int j = 0; j < n; ++j) {
+            double norm = std::abs(_h_s[j]);
+            for (int i = 0; i < m; ++i) {
+                norm = std::max(norm, std::abs(_A_s(i, j)));
+            }
+            norm = norm == 0 ? 1 : clamp(norm, 1e-4, 1e4);
+
+            double d = 1 / std::sqrt(norm);
+            _D[j] *= d;
+            _h_s[j] *= d * d;
+            for (int i = 0; i < m; ++i) {
+                _A_s(i, j) *= d;
+            }
+        }
+
+        for (int i = 0; i < m; ++i) {
+            double norm = 0;
+            for (int j = 0; j < n; ++j) {
+                norm = std::max(norm, std::abs(_A_s(i, j)));
+            }
+            norm = norm == 0 ? 1 : clamp(norm, 1e-4, 1e4);
+
+            double e = 1 / std::sqrt(norm);
+            _E[i] *= e;
+            for (int j = 0; j < n; ++j) {
+                _A_s(i, j) *= e;
+            }
+        }
+    }
+
+    //Cost scaling
+    _g_s.resize(n);
+    double h_mean = 0;
+    double g_max = 0;
+    for (int j = 0; j < n; ++j) {
+        _g_s[j] = _D[j] * gradient[j];
+        h_mean += _h_s[j] / n;
+        g_max = std::max(g_max, std::abs(_g_s[j]));
+    }
+    double cost_norm = std::max(h_mean, g_max);
+    _c = cost_norm > 0 ? clamp(1 / cost_norm, 1e-4, 1e4) : 1.0;
+    _h_s *= _c;
+    _g_s *= _c;
+}
+
+void ComakQPSolver::factorize()
+{
+    //K = H + sigma*I + rho*I + rho_eq*A'*A
+    int n = _h_s.size();
+    SimTK::Matrix K = (RHO_EQ_SCALE * _rho) * (~_A_s * _A_s);
+
+    for (int j = 0; j < n; ++j) {
+        K(j, j) += _h_s[j] + _sigma + _rho;
+    }
+    _K_factor.factor(K);
+}
+
+bool ComakQPSolver::polish(const SimTK::Vector& x, const SimTK::Vector& z_bound,
+    const SimTK::Vector& y_eq, const SimTK::Vector& y_bound,
+    SimTK::Vector& x_polish, SimTK::Vector& y_eq_polish,
+    SimTK::Vector& y_bound_polish) const
+{
+    int n = x.size();
+    int m = y_eq.size();
+
+    //Active set: -1 lower bound, 1 upper bound, 0 free
+    std::vector<int> active(n, 0);
+    std::vector<int> free;
+    x_polish.resize(n);
+
+    for (int j = 0; j < n; ++j) {
+        if (_upper_s[j] <= _lower_s[j] ||
+            z_bound[j] - _lower_s[j] < -y_bound[j]) {
+            active[j] = -1;
+            x_polish[j] = _lower_s[j];
+        }
+        else if (_upper_s[j] - z_bound[j] < y_bound[j]) {
+            active[j] = 1;
+            x_polish[j] = _upper_s[j];
+        }
+        else {
+            free.push_back(j);
+        }
+    }
+    int nF = static_cast<int>(free.size());
+    int N = nF + m;
+
+    //Equality constrained QP over the free parameters
+    //[H_FF A_F'; A_F 0] [x_F; y] = [-g_F; b - A_B*x_B]
+    SimTK::Matrix K(N, N, 0.0);
+    SimTK::Vector rhs(N);
+
+    for (int a = 0; a < nF; ++a) {
+        int j = free[a];
+        K(a, a) = _h_s[j];
+        rhs[a] = -_g_s[j];
+        for (int i = 0; i < m; ++i) {
+            K(nF + i, a) = _A_s(i, j);
+            K(a, nF + i) = _A_s(i, j);
+        }
+    }
+    for (int i = 0; i < m; ++i) {
+        rhs[nF + i] = _b_s[i];
+        for (int j = 0; j < n; ++j) {
+            if (active[j] != 0) {
+                rhs[nF + i] -= _A_s(i, j) * x_polish[j];
+            }
+        }
+    }
+
+    SimTK::Matrix K_reg = K;
+    for (int a = 0; a < nF; ++a) K_reg(a, a) += POLISH_DELTA;
+    for (int i = 0; i < m; ++i) K_reg(nF + i, nF + i) -= POLISH_DELTA;
+
+    SimTK::Vector sol(N);
+    try {
+        SimTK::FactorLU K_factor(K_reg);
+        K_factor.solve(rhs, sol);
+
+        //Iterative refinement on the unregularized system
+        SimTK::Vector delta(N);
+        for (int r = 0; r < 3; ++r) {
+            SimTK::Vector res = rhs - K * sol;
+            K_factor.solve(res, delta);
+            sol += delta;
+        }
+    }
+    catch (const std::exception&) {
+        return false;
+    }
+    for (int a = 0; a < N; ++a) {
+        if (!SimTK::isFinite(sol[a])) return false;
+    }
+
+    for (int a = 0; a < nF; ++a) {
+        x_polish[free[a]] = sol[a];
+    }
+    y_eq_polish.resize(m);
+    for (int i = 0; i < m; ++i) {
+        y_eq_polish[i] = sol[nF + i];
+    }
+
+    //Check the optimality conditions
+    for (int j = 0; j < n; ++j) {
+        double tol = _tolerance * (1 + std::abs(x_polish[j]));
+        if (x_polish[j] < _lower_s[j] - tol ||
+            x_polish[j] > _upper_s[j] + tol) {
+            return false;
+        }
+        x_polish[j] = clamp(x_polish[j], _lower_s[j], _upper_s[j]);
+    }
+
+    for (int i = 0; i < m; ++i) {
+        double Ax = 0;
+        for (int j = 0; j < n; ++j) {
+            Ax += _A_s(i, j) * x_polish[j];
+        }
+        if (std::abs(Ax - _b_s[i]) > _tolerance * (1 + std::abs(_b_s[i]))) {
+            return false;
+        }
+    }
+
+    //Bound multipliers from stationarity: H*x + g + A'*y + y_bound = 0
+    y_bound_polish.resize(n);
+    for (int j = 0; j < n; ++j) {
+        double grad = _h_s[j] * x_polish[j] + _g_s[j];
+        for (int i = 0; i < m; ++i) {
+            grad += _A_s(i, j) * y_eq_polish[i];
+        }
+        double tol = _tolerance * (1 + std::abs(_g_s[j]));
+
+        if (active[j] == 0) {
+            if (std::abs(grad) > tol) return false;
+            y_bound_polish[j] = 0;
+        }
+        else {
+            y_bound_polish[j] = -grad;
+
+            //Lower bound multipliers are negative, upper positive
+            if (_upper_s[j] > _lower_s[j] &&
+                active[j] * y_bound_polish[j] < -tol) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
@@ -0,0 +1,114 @@
+#ifndef OPENSIM_COMAK_QP_SOLVER_H_
+#define OPENSIM_COMAK_QP_SOLVER_H_
+/* -------------------------------------------------------------------------- *
+ *                             COMAKQPSolver.h                                *
+ * -------------------------------------------------------------------------- *
+ * Author(s): Colin Smith                                                     *
+ *                                                                            *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may    *
+ * not use this file except in compliance with the License. You may obtain a  *
+ * copy of the License at http://www.apache.org/licenses/LICENSE-2.0.         *
+ *                                                                            *
+ * Unless required by applicable law or agreed to in writing, software        *
+ * distributed under the License is distributed on an "AS IS" BASIS,          *
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.   *
+ * See the License for the specific language governing permissions and        *
+ * limitations under the License.                                             *
+ * -------------------------------------------------------------------------- */
+
+//=============================================================================
+// INCLUDES
+//=============================================================================
+#include "osimPluginDLL.h"
+#include <simmath/LinearAlgebra.h>
+
+namespace OpenSim {
+
+/**
+Dense solver for the convex quadratic program of the COMAK optimization
+(with the default activation exponent of 2):
+
+    min  1/2 x'*diag(h)*x + g'*x
+    s.t. A*x = b
+         lower <= x <= upper
+
+The Hessian is diagonal and positive semi-definite (the secondary coordinate
+parameters only appear in the linear contact energy term), so the problem is
+solved with the alternating direction method of multipliers (ADMM) in the
+form used by OSQP (Stellato et al. 2020), with Ruiz equilibration of the
+problem data and adaptive step size. Periodically, the active bounds are
+guessed from the ADMM multipliers and the equality constrained problem over
+the free parameters is solved directly (polishing). The polished solution is
+accepted if it satisfies all optimality conditions, which typically happens
+long before the ADMM iterations reach a tight tolerance.
+
+The multipliers of the previous solve are used to warm start the next one,
+so consecutive COMAK iterations and frames (with similar active sets)
+converge in few iterations.
+
+@author Colin Smith
+*/
+class OSIMPLUGIN_API ComakQPSolver {
+public:
+    ComakQPSolver();
+
+    void setMaxIterations(int max_iterations) {
+        _max_iterations = max_iterations;
+    }
+    void setTolerance(double tolerance) {
+        _tolerance = tolerance;
+    }
+
+    /** Solve the QP, x is the initial guess on input and the solution on
+    output. Returns false if no solution was found in max_iterations. */
+    bool solve(const SimTK::Vector& hessian, const SimTK::Vector& gradient,
+        const SimTK::Matrix& A, const SimTK::Vector& b,
+        const SimTK::Vector& lower, const SimTK::Vector& upper,
+        SimTK::Vector& x);
+
+    /** Discard the multipliers of the previous solve. */
+    void resetWarmStart();
+
+    int getNumIterations() const { return _num_iterations; }
+    bool getPolished() const { return _polished; }
+
+private:
+    void scaleProblem(const SimTK::Vector& hessian,
+        const SimTK::Vector& gradient, const SimTK::Matrix& A);
+    void factorize();
+    bool polish(const SimTK::Vector& x, const SimTK::Vector& z_bound,
+        const SimTK::Vector& y_eq, const SimTK::Vector& y_bound,
+        SimTK::Vector& x_polish, SimTK::Vector& y_eq_polish,
+        SimTK::Vector& y_bound_polish) const;
+
+    //Settings
+    int _max_iterations;
+    double _tolerance;
+    double _sigma;
+    double _alpha;
+
+    //Scaled problem: x = D*x_s, rows scaled by E, cost scaled by c
+    SimTK::Vector _D;
+    SimTK::Vector _E;
+    double _c;
+    SimTK::Vector _h_s;
+    SimTK::Vector _g_s;
+    SimTK::Matrix _A_s;
+    SimTK::Vector _b_s;
+    SimTK::Vector _lower_s;
+    SimTK::Vector _upper_s;
+
+    double _rho;
+    SimTK::FactorLU _K_factor;
+
+    //Unscaled multipliers for warm start
+    SimTK::Vector _y_eq;
+    SimTK::Vector _y_bound;
+
+    int _num_iterations;
+    bool _polished;
+};
+
+}; //namespace
+
+#endif // OPENSIM_COMAK_QP_SOLVER_H_
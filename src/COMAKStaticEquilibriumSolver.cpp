@@ -0,0 +1,153 @@
+/* -------------------------------------------------------------------------- *
+ *                     COMAKStaticEquilibriumSolver.cpp                       *
+ * -------------------------------------------------------------------------- *
+ * Author(s): Colin Smith                                                     *
+ *                                                                            *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may    *
+ * not use this file except in compliance with the License. You may obtain a  *
+ * copy of the License at http://www.apache.org/licenses/LICENSE-2.0.         *
+ *                                                                            *
+ * Unless required by applicable law or agreed to in writing, software        *
+ * distributed under the License is distributed on an "AS IS" BASIS,          *
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.   *
+ * See the License for the specific language governing permissions and        *
+ * limitations under the License.                                             *
+ * -------------------------------------------------------------------------- */
+
+#include "COMAKStaticEquilibriumSolver.h"
+#include <OpenSim/Simulation/SimbodyEngine/Coordinate.h>
+#include <simmath/LinearAlgebra.h>
+#include <iomanip>
+
+using namespace OpenSim;
+
+// Number of times the damping is increased before a step is rejected
+static const int MAX_DAMPING_INCREASES = 10;
+
+//=============================================================================
+// CONSTRUCTOR
+//=============================================================================
+ComakStaticEquilibriumSolver::ComakStaticEquilibriumSolver(Model& model,
+    const Array<std::string>& coordinate_paths) :
+    _model(model), _max_iterations(50), _tolerance(1e-5),
+    _residual_tolerance(1.0), _perturbation(1e-6), _verbose(0),
+    _num_iterations(0)
+{
+    for (int i = 0; i < coordinate_paths.size(); ++i) {
+        _coordinates.emplace_back(
+            &_model.getComponent<Coordinate>(coordinate_paths[i]));
+    }
+}
+
+//=============================================================================
+// SOLVE
+//=============================================================================
+void ComakStaticEquilibriumSolver::setCoordinateValues(SimTK::State& state,
+    const SimTK::Vector& values) const
+{
+    for (int i = 0; i < (int)_coordinates.size(); ++i) {
+        _coordinates[i]->setValue(state, values[i], false);
+    }
+    _model.assemble(state);
+}
+
+void ComakStaticEquilibriumSolver::computeResidual(SimTK::State& state,
+    const SimTK::Vector& values, SimTK::Vector& residual) const
+{
+    setCoordinateValues(state, values);
+    _model.realizeAcceleration(state);
+
+    for (int i = 0; i < (int)_coordinates.size(); ++i) {
+        residual[i] = _coordinates[i]->getAccelerationValue(state);
+    }
+}
+
+bool ComakStaticEquilibriumSolver::solve(SimTK::State& state)
+{
+    int n = (int)_coordinates.size();
+    _num_iterations = 0;
+
+    if (n == 0) return true;
+
+    state.updU() = 0;
+
+    SimTK::Vector values(n);
+    for (int i = 0; i < n; ++i) {
+        values[i] = _coordinates[i]->getValue(state);
+    }
+
+    SimTK::Vector residual(n);
+    computeResidual(state, values, residual);
+    double cost = residual.normSqr();
+
+    SimTK::Vector perturbed_residual(n);
+    SimTK::Matrix jacobian(n, n);
+    double damping = 1e-3;
+
+    for (int iter = 0; iter < _max_iterations; ++iter) {
+        _num_iterations++;
+
+        //Forward finite difference Jacobian
+        for (int j = 0; j < n; ++j) {
+            SimTK::Vector perturbed = values;
+            perturbed[j] += _perturbation;
+            computeResidual(state, perturbed, perturbed_residual);
+
+            for (int i = 0; i < n; ++i) {
+                jacobian(i, j) =
+                    (perturbed_residual[i] - residual[i]) / _perturbation;
+            }
+        }
+
+        SimTK::Matrix JtJ = ~jacobian * jacobian;
+        SimTK::Vector neg_Jtr = -(~jacobian * residual);
+
+        //Increase the damping until the step reduces the residual
+        SimTK::Vector step(n), trial(n), trial_residual(n);
+        bool accepted = false;
+
+        for (int k = 0; k < MAX_DAMPING_INCREASES && !accepted; ++k) {
+            SimTK::Matrix lhs = JtJ;
+            for (int i = 0; i < n; ++i) {
+                lhs(i, i) += damping * std::max(JtJ(i, i), SimTK::SignificantReal);
+            }
+
+            SimTK::FactorLU lu(lhs);
+            lu.solve(neg_Jtr, step);
+
+            trial = values + step;
+            computeResidual(state, trial, trial_residual);
+            double trial_cost = trial_residual.normSqr();
+
+            if (SimTK::isFinite(trial_cost) && trial_cost < cost) {
+                values = trial;
+                residual = trial_residual;
+                cost = trial_cost;
+                damping = std::max(damping / 10.0, 1e-12);
+                accepted = true;
+            }
+            else {
+                damping *= 10.0;
+            }
+        }
+
+        double max_step = accepted ? step.normInf() : 0.0;
+
+        if (_verbose > 0) {
+            std::cout << "Static equilibrium iteration: " << iter
+                << "\tmax udot: " << residual.normInf()
+                << "\tmax coordinate change: " << max_step
+                << "\tdamping: " << damping << std::endl;
+        }
+
+        //Stop once the step is below the tolerance or no step reduces the
+        //residual, only report equilibrium if the udots are small as well
+        //(a small step can also come from a large damping)
+        if (!accepted || max_step < _tolerance) {
+            break;
+        }
+    }
+
+    setCoordinateValues(state, values);
+    return residual.normInf() < _residual_tolerance;
+}
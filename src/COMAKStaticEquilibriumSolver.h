@@ -0,0 +1,88 @@
+#ifndef OPENSIM_COMAK_STATIC_EQUILIBRIUM_SOLVER_H_
+#define OPENSIM_COMAK_STATIC_EQUILIBRIUM_SOLVER_H_
+/* -------------------------------------------------------------------------- *
+ *                      COMAKStaticEquilibriumSolver.h                        *
+ * -------------------------------------------------------------------------- *
+ * Author(s): Colin Smith                                                     *
+ *                                                                            *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may    *
+ * not use this file except in compliance with the License. You may obtain a  *
+ * copy of the License at http://www.apache.org/licenses/LICENSE-2.0.         *
+ *                                                                            *
+ * Unless required by applicable law or agreed to in writing, software        *
+ * distributed under the License is distributed on an "AS IS" BASIS,          *
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.   *
+ * See the License for the specific language governing permissions and        *
+ * limitations under the License.                                             *
+ * -------------------------------------------------------------------------- */
+
+//=============================================================================
+// INCLUDES
+//=============================================================================
+#include "osimPluginDLL.h"
+#include <OpenSim/Simulation/Model/Model.h>
+
+namespace OpenSim {
+
+/**
+Find the values of a set of (secondary) coordinates where the model is in
+static equilibrium: with all speeds set to zero, the accelerations of the
+coordinates vanish. This replaces a settling forward simulation, the other
+coordinates are expected to be locked or prescribed in the state.
+
+The residual (coordinate accelerations) is minimized with a
+Levenberg-Marquardt iteration, using a forward finite difference Jacobian.
+The iteration stops when the largest change in the coordinate values is
+smaller than the tolerance, or when no damped step reduces the residual. It
+has only converged if the largest coordinate acceleration is then also
+smaller than the residual tolerance.
+
+@author Colin Smith
+*/
+class OSIMPLUGIN_API ComakStaticEquilibriumSolver {
+public:
+    ComakStaticEquilibriumSolver(Model& model,
+        const Array<std::string>& coordinate_paths);
+
+    void setMaxIterations(int max_iterations) {
+        _max_iterations = max_iterations;
+    }
+    void setTolerance(double tolerance) {
+        _tolerance = tolerance;
+    }
+    void setResidualTolerance(double residual_tolerance) {
+        _residual_tolerance = residual_tolerance;
+    }
+    void setPerturbation(double perturbation) {
+        _perturbation = perturbation;
+    }
+    void setVerbose(int verbose) {
+        _verbose = verbose;
+    }
+
+    /** Solve for the coordinate values, the state is updated in place (with
+    zero speeds). Returns false if the iteration did not converge. */
+    bool solve(SimTK::State& state);
+
+    int getNumIterations() const { return _num_iterations; }
+
+private:
+    void setCoordinateValues(SimTK::State& state,
+        const SimTK::Vector& values) const;
+    void computeResidual(SimTK::State& state, const SimTK::Vector& values,
+        SimTK::Vector& residual) const;
+
+    Model& _model;
+    std::vector<SimTK::ReferencePtr<const Coordinate>> _coordinates;
+
+    int _max_iterations;
+    double _tolerance;
+    double _residual_tolerance;
+    double _perturbation;
+    int _verbose;
+    int _num_iterations;
+};
+
+}; //namespace
+
+#endif // OPENSIM_COMAK_STATIC_EQUILIBRIUM_SOLVER_H_
@@ -22,6 +22,9 @@
 #include "COMAKTarget.h"
 #include "Smith2018ArticularContactForce.h"
 #include <OpenSim.h>
+#include <atomic>
+#include <thread>
+#include <algorithm>
 using namespace OpenSim;
 
 
@@ -61,6 +64,13 @@ ComakTarget(SimTK::State s,Model* aModel, const SimTK::Vector& observed_udot,
     _parameter_names = parameter_names;
     _activationExponent = 2.0;
     _model = aModel;
+
+    _max_broyden_updates = 0;
+    _n_broyden_updates = 0;
+    _reset_secondary_unit_udot = true;
+    _cnt_energy = 0.0;
+    _unit_udot_time = 0.0;
+    _n_gradient_evaluations = 0;
 }
 
 void ComakTarget::initialize(){
@@ -71,35 +81,17 @@ void ComakTarget::initialize(){
 
     _nParameters = _nActuators + _nSecondaryCoord;
     setNumParameters(_nParameters);
-    setParameterBounds(1);
     
     //Number of Constraints
-    int nC = 0;
-    int nCoord = 0;
-    for (const Coordinate& coord : _model->getComponentList<Coordinate>()) {
-        if (_primary_coords.findIndex(coord.getAbsolutePathString()) > -1) {
-            _constraint_names.append(coord.getName());
-            nC++;
-        }
-        else if(_secondary_coords.findIndex(coord.getAbsolutePathString())> -1) {
-            _constraint_names.append(coord.getName());
-            nC++;
-        }
-        nCoord++;
-    }
-    _nConstraints = nC;
-    _nCoordinates = nCoord;
+    initializeIndexMaps();
+
+    int nC = _nConstraints;
 
     setNumEqualityConstraints(nC);
     setNumLinearEqualityConstraints(nC);
     setNumInequalityConstraints(0);
 
-    //Initial Secondary Coordinates
     _init_secondary_values.resize(_nSecondaryCoord);
-
-    for (int i = 0; i < _nSecondaryCoord; ++i) {
-        _init_secondary_values[i] = _init_parameters[_nActuators + i];
-    }
     
 
     if(_muscle_weight.size() == 0){
@@ -118,8 +110,6 @@ void ComakTarget::initialize(){
     
    
 
-    //Precompute Constraint Matrix
-    precomputeConstraintMatrix();
     if (false) {
     //if (_verbose > 0) {
         std::cout << std::endl;
@@ -133,7 +123,135 @@ void ComakTarget::initialize(){
     }
 }
 
-void ComakTarget::precomputeConstraintMatrix() {
+void ComakTarget::initializeIndexMaps() {
+    const SimTK::SimbodyMatterSubsystem& matter = _model->getMatterSubsystem();
+
+    _constraint_names.setSize(0);
+    _constraint_coord_index.clear();
+    _constraint_u_index.clear();
+    _constraint_is_secondary.clear();
+
+    int nCoord = 0;
+    for (const Coordinate& coord : _model->getComponentList<Coordinate>()) {
+        std::string path = coord.getAbsolutePathString();
+        bool primary = _primary_coords.findIndex(path) > -1;
+        bool secondary = !primary && _secondary_coords.findIndex(path) > -1;
+
+        if (primary || secondary) {
+            const SimTK::MobilizedBody& mobod = matter.getMobilizedBody(coord.getBodyIndex());
+
+            _constraint_names.append(coord.getName());
+            _constraint_coord_index.push_back(nCoord);
+            _constraint_u_index.push_back(mobod.getFirstUIndex(_state) + coord.getMobilizerQIndex());
+            _constraint_is_secondary.push_back(secondary);
+        }
+        nCoord++;
+    }
+    _nConstraints = static_cast<int>(_constraint_coord_index.size());
+    _nCoordinates = nCoord;
+
+    //The worker models are copies of the model, the components are looked
+    //up in each copy once
+    std::vector<const Model*> models(1, _model);
+    models.insert(models.end(), _worker_models.begin(), _worker_models.end());
+
+    _parameter_components.clear();
+    for (const Model* model : models) {
+        ParameterComponents components;
+        for (int i = 0; i < _nMuscles; ++i) {
+            components.actuators.push_back(
+                &model->getComponent<ScalarActuator>(_muscle_path[i]));
+        }
+        for (int i = 0; i < _nNonMuscleActuators; ++i) {
+            components.actuators.push_back(
+                &model->getComponent<ScalarActuator>(_non_muscle_actuator_path[i]));
+        }
+        for (int i = 0; i < _nSecondaryCoord; ++i) {
+            components.secondary_coords.push_back(
+                &model->getComponent<Coordinate>(_secondary_coords[i]));
+            components.secondary_damping_actuators.push_back(
+                &model->getComponent<ScalarActuator>(_secondary_damping_actuator_path[i]));
+        }
+        _parameter_components.push_back(components);
+    }
+}
+
+void ComakTarget::update(SimTK::State s, const SimTK::Vector& observed_udot,
+    const SimTK::Vector& init_parameters) {
+
+    //Instead of perturbing the secondary coordinates, the secondary 
+    //columns can be updated with the change in the constraint udots 
+    //between the previous and new parameters (Broyden's method)
+    bool broyden = _max_broyden_updates > 0 && !_reset_secondary_unit_udot &&
+        _n_broyden_updates < _max_broyden_updates;
+
+    SimTK::Vector predicted_udot(_nConstraints);
+    SimTK::Vector dq(_nSecondaryCoord);
+    double predicted_cnt_energy = _cnt_energy;
+
+    if (broyden) {
+        //Prediction of the previous linearization
+        constraintFunc(init_parameters, true, predicted_udot);
+        predicted_udot += _constraint_desired_udot;
+
+        for (int i = 0; i < _nSecondaryCoord; ++i) {
+            dq[i] = init_parameters[_nActuators + i] - _init_secondary_values[i];
+            predicted_cnt_energy += dq[i] * _secondary_coord_unit_energy[i];
+        }
+
+        //The measured udots are computed without the COMAK damping, so it
+        //is removed from the prediction, otherwise the update would fold
+        //the damping into the secondary coordinate columns
+        for (int i = 0; i < _nConstraints; ++i) {
+            for (int j = 0; j < _nSecondaryCoord; ++j) {
+                predicted_udot[i] -= dq[j] / _dt * _secondary_damping_unit_udot(i, j);
+            }
+        }
+        broyden = dq.normSqr() > _unit_udot_epsilon * _unit_udot_epsilon;
+    }
+
+    _state = s;
+    _observed_udot = observed_udot;
+    _init_parameters = init_parameters;
+
+    //Initial Secondary Coordinates
+    for (int i = 0; i < _nSecondaryCoord; ++i) {
+        _init_secondary_values[i] = _init_parameters[_nActuators + i];
+    }
+
+    setParameterBounds(1);
+
+    //Precompute Constraint Matrix
+    precomputeConstraintMatrix(!broyden);
+
+    if (broyden) {
+        //Rank one update with the prediction error along dq
+        double dq_norm_sqr = dq.normSqr();
+        for (int i = 0; i < _nConstraints; ++i) {
+            double error = _constraint_initial_udot[i] - predicted_udot[i];
+            for (int j = 0; j < _nSecondaryCoord; ++j) {
+                _secondary_coord_unit_udot(i, j) += error * dq[j] / dq_norm_sqr;
+            }
+        }
+
+        double energy_error = _cnt_energy - predicted_cnt_energy;
+        for (int j = 0; j < _nSecondaryCoord; ++j) {
+            _secondary_coord_unit_energy[j] += energy_error * dq[j] / dq_norm_sqr;
+        }
+        _n_broyden_updates++;
+    }
+    else {
+        _n_broyden_updates = 0;
+    }
+    _reset_secondary_unit_udot = false;
+
+    if (_verbose > 0 && _max_broyden_updates > 0) {
+        std::cout << "Secondary coordinate unit udots: " 
+            << (broyden ? "Broyden update" : "finite difference") << std::endl;
+    }
+}
+
+void ComakTarget::precomputeConstraintMatrix(bool perturb_secondary_coords) {
     _constraint_initial_udot.resize(_nConstraints);
     _constraint_desired_udot.resize(_nConstraints);
 
@@ -143,24 +261,16 @@ void ComakTarget::precomputeConstraintMatrix() {
     computeSimulatedAcceleration(_state, _init_parameters, sim_udot);
     _initial_udot = sim_udot;
 
-    int i = 0;
-    int j = 0;
-    for (const Coordinate& coord : _model->getComponentList<Coordinate>()) {
-        if (_primary_coords.findIndex(coord.getAbsolutePathString()) > -1) {
-            _constraint_desired_udot[i] = _observed_udot[j];
-            _constraint_initial_udot[i] = _initial_udot[j];
-            i++;
-        }
-        if (_secondary_coords.findIndex(coord.getAbsolutePathString()) > -1) {
-            _constraint_desired_udot[i] = 0;
-            _constraint_initial_udot[i] = _initial_udot[j];
-            i++;
-        }
-        j++;
+    for (int i = 0; i < _nConstraints; ++i) {
+        int j = _constraint_coord_index[i];
+        _constraint_desired_udot[i] = _constraint_is_secondary[i] ? 0 : _observed_udot[j];
+        _constraint_initial_udot[i] = _initial_udot[j];
     }
 
     //constraint matrix
-    computeUnitUdot(_state, _init_parameters);
+    double start = SimTK::realTime();
+    computeUnitUdot(_state, _init_parameters, perturb_secondary_coords);
+    _unit_udot_time = SimTK::realTime() - start;
 }
 
 //==============================================================================
@@ -224,6 +334,7 @@ objectiveFunc(const SimTK::Vector &parameters, const bool new_parameters, SimTK:
 int ComakTarget::
 gradientFunc(const SimTK::Vector &parameters, const bool new_parameters, SimTK::Vector &gradient) const
 {
+    _n_gradient_evaluations++;
     gradient = 0;
 
     int p = 0;
@@ -355,35 +466,72 @@ int ComakTarget::constraintJacobian(const SimTK::Vector &parameters, bool new_pa
     }
     return 0;
 }
+
+void ComakTarget::getQuadraticProgram(SimTK::Vector& hessian,
+    SimTK::Vector& gradient, SimTK::Matrix& A, SimTK::Vector& b,
+    SimTK::Vector& lower, SimTK::Vector& upper) const
+{
+    OPENSIM_THROW_IF(_activationExponent != 2.0, Exception,
+        "COMAK quadratic program requires an activation exponent of 2.");
+
+    hessian.resize(_nParameters);
+    gradient.resize(_nParameters);
+
+    int p = 0;
+    for (int i = 0; i < _nMuscles; i++) {
+        double w = 1000000.0 * _muscle_volumes(i) * _muscle_weight(i);
+        hessian[p] = 2.0 * w;
+        gradient[p] = -2.0 * w * _desired_act(i);
+        p++;
+    }
+
+    for (int i = 0; i < _nNonMuscleActuators; i++) {
+        hessian[p] = 2.0 * 1000.0 * _optimalForce[p] * _optimalForce[p];
+        gradient[p] = 0.0;
+        p++;
+    }
+
+    for (int i = 0; i < _nSecondaryCoord; ++i) {
+        hessian[p] = 0.0;
+        gradient[p] = _contact_energy_weight * _secondary_coord_unit_energy[i];
+        p++;
+    }
+
+    //The constraints are linear: constraints(x) = A*x + constraints(0)
+    A.resize(_nConstraints, _nParameters);
+    constraintJacobian(_init_parameters, true, A);
+
+    SimTK::Vector zero(_nParameters, 0.0);
+    b.resize(_nConstraints);
+    constraintFunc(zero, true, b);
+    b *= -1.0;
+
+    SimTK::Real *lower_limits, *upper_limits;
+    getParameterLimits(&lower_limits, &upper_limits);
+    lower = SimTK::Vector(_nParameters, lower_limits);
+    upper = SimTK::Vector(_nParameters, upper_limits);
+}
+
 //=============================================================================
 // ACCELERATION
 //=============================================================================
 //
 void ComakTarget::computeSimulatedAcceleration(SimTK::State s, const SimTK::Vector &parameters, SimTK::Vector &sim_udot) 
 {
-    //Apply Muscle Forces
-    int j = 0;
-    for (int i = 0; i < _nMuscles; ++i) {
-        Muscle &msl = _model->updComponent<Muscle>(_muscle_path[i]);
-        msl.overrideActuation(s, true);
-        double force = _optimalForce[j] * parameters[j];
-        msl.setOverrideActuation(s,force);
-        j++;
-    }
+    const ParameterComponents& components = _parameter_components[0];
 
-    //Apply Non Muscle Actuator Forces
-    for (int i = 0; i < _nNonMuscleActuators; ++i) {
-        ScalarActuator &actuator = _model->updComponent<ScalarActuator>(_non_muscle_actuator_path[i]);
+    //Apply Muscle and Non Muscle Actuator Forces
+    for (int j = 0; j < _nActuators; ++j) {
+        const ScalarActuator& actuator = *components.actuators[j];
         actuator.overrideActuation(s, true);
         double force = _optimalForce[j] * parameters[j];
         actuator.setOverrideActuation(s,force);
-        j++;
     }
 
     //Set Secondary Coordinates 
     for (int i = 0; i < _nSecondaryCoord; ++i) {
         double value = parameters(_nActuators + i);
-        _model->updComponent<Coordinate>(_secondary_coords[i]).setValue(s, value, false);
+        components.secondary_coords[i]->setValue(s, value, false);
     }
     
     //Set ALL speeds to zero
@@ -402,47 +550,83 @@ void ComakTarget::computeSimulatedAcceleration(SimTK::State s, const SimTK::Vect
     }
 }
 
-void ComakTarget::computeUnitUdot(SimTK::State s, const SimTK::Vector& parameters) 
+//Copy the state of model to the working state of a copy of the model
+static void copyStateToWorker(const Model& model, const SimTK::State& s,
+    const Model& worker, SimTK::State& ws)
+{
+    ws.setTime(s.getTime());
+    ws.updQ() = s.getQ();
+    ws.updU() = s.getU();
+    ws.updZ() = s.getZ();
+
+    //Discrete variables used by COMAK. The worker is a copy of the model,
+    //so the component lists are in the same order.
+    auto worker_actuators = worker.getComponentList<ScalarActuator>();
+    auto worker_actuator = worker_actuators.begin();
+    for (const ScalarActuator& actuator : model.getComponentList<ScalarActuator>()) {
+        worker_actuator->overrideActuation(ws, actuator.isActuationOverridden(s));
+        worker_actuator->setOverrideActuation(ws, actuator.getOverrideActuation(s));
+        ++worker_actuator;
+    }
+
+    auto worker_coords = worker.getComponentList<Coordinate>();
+    auto worker_coord = worker_coords.begin();
+    for (const Coordinate& coord : model.getComponentList<Coordinate>()) {
+        worker_coord->setLocked(ws, coord.getLocked(s));
+        worker_coord->setClamped(ws, coord.getClamped(s));
+        ++worker_coord;
+    }
+
+    auto worker_frcs = worker.getComponentList<Smith2018ArticularContactForce>();
+    auto worker_frc = worker_frcs.begin();
+    for (const Smith2018ArticularContactForce& cnt_frc :
+        model.getComponentList<Smith2018ArticularContactForce>()) {
+        worker_frc->setModelingOption(ws, "flip_meshes",
+            cnt_frc.getModelingOption(s, "flip_meshes"));
+        worker_frc->setModelingOption(ws, "use_coarse_mesh",
+            cnt_frc.getModelingOption(s, "use_coarse_mesh"));
+        ++worker_frc;
+    }
+}
+
+void ComakTarget::computeUnitUdot(SimTK::State s, 
+    const SimTK::Vector& parameters, bool perturb_secondary_coords) 
 /**
 *
 * act_unit_udot: rows - coordinates, columns - actuators
+* perturb_secondary_coords: if false, the secondary coordinate columns and
+* unit contact energies are left unchanged 
 */
 {
     _msl_unit_udot.resize(_nConstraints, _nMuscles);
     _non_muscle_actuator_unit_udot.resize(_nConstraints, _nNonMuscleActuators);
-    _secondary_coord_unit_udot.resize(_nConstraints, _nSecondaryCoord);
     _secondary_damping_unit_udot.resize(_nConstraints, _nSecondaryCoord);
-    _secondary_coord_unit_energy.resize(_nSecondaryCoord);
        
     _msl_unit_udot = -1;
     _non_muscle_actuator_unit_udot = -1;
-    _secondary_coord_unit_udot = -1;
     _secondary_damping_unit_udot = -1;
-    _secondary_coord_unit_energy = -1;
 
-    //Apply Muscle Forces
-    int j = 0;
-    for (int i = 0; i < _nMuscles; ++i) {
-        Muscle &msl = _model->updComponent<Muscle>(_muscle_path[i]);
-        msl.overrideActuation(s, true);
-        double force = _optimalForce[j] * parameters[j];
-        msl.setOverrideActuation(s,force);
-        j++;
+    if (perturb_secondary_coords) {
+        _secondary_coord_unit_udot.resize(_nConstraints, _nSecondaryCoord);
+        _secondary_coord_unit_energy.resize(_nSecondaryCoord);
+        _secondary_coord_unit_udot = -1;
+        _secondary_coord_unit_energy = -1;
     }
 
-    //Apply Non Muscle Actuator Forces
-    for (int i = 0; i < _nNonMuscleActuators; ++i) {
-        ScalarActuator &actuator = _model->updComponent<ScalarActuator>(_non_muscle_actuator_path[i]);
+    const ParameterComponents& components = _parameter_components[0];
+
+    //Apply Muscle and Non Muscle Actuator Forces
+    for (int j = 0; j < _nActuators; ++j) {
+        const ScalarActuator& actuator = *components.actuators[j];
         actuator.overrideActuation(s, true);
         double force = _optimalForce[j] * parameters[j];
         actuator.setOverrideActuation(s,force);
-        j++;
     }
 
     //Set Secondary Kinematics to Current
     for (int i = 0; i < _nSecondaryCoord; ++i) {
         double value = parameters(_nActuators + i);
-        _model->updComponent<Coordinate>(_secondary_coords[i]).setValue(s, value, false);
+        components.secondary_coords[i]->setValue(s, value, false);
     }
     //Set ALL speeds to zero
     /*for (Coordinate& coord : _model->updComponentList<Coordinate>()) {
@@ -458,128 +642,223 @@ void ComakTarget::computeUnitUdot(SimTK::State s, const SimTK::Vector& parameter
     for (Smith2018ArticularContactForce& cnt_frc : _model->updComponentList<Smith2018ArticularContactForce>()) {
         current_cnt_energy += cnt_frc.getOutputValue<double>(s,"potential_energy");
     }
+    _cnt_energy = current_cnt_energy;
 
-    //Compute Muscle Unit Udot
-    j = 0;
-    for (int i = 0; i < _nMuscles; ++i) {
-        Muscle &msl = _model->updComponent<Muscle>(_muscle_path[i]);
+    //Actuator and damping columns are computed from the generalized forces
+    //of a unit actuation, the remaining columns are perturbed
+    std::vector<int> columns;
+    computeActuatorUnitUdot(s, columns);
 
-        double force = parameters[j] * _optimalForce[j];
+    if (!perturb_secondary_coords) {
+        columns.erase(std::remove_if(columns.begin(), columns.end(),
+            [&](int c) { return c >= _nActuators && c < _nActuators + _nSecondaryCoord; }),
+            columns.end());
+    }
 
-        msl.setOverrideActuation(s, force + 1.0);
+    //Each perturbed column (secondary coordinate perturbation, or an
+    //actuator type without analytical generalized forces) is computed from
+    //a copy of the current state, so the columns are independent and can
+    //be distributed over the worker models. Each column is written by one
+    //thread only, so the result does not depend on the number of threads.
+    int nColumns = static_cast<int>(columns.size());
+    int nWorkers = std::max(1, std::min(
+        1 + static_cast<int>(_worker_models.size()), nColumns));
 
-        _model->realizeAcceleration(s);
-        
-        int k = 0;
-        for (const Coordinate& coord : _model->updComponentList<Coordinate>()) {
-            if (_primary_coords.findIndex(coord.getAbsolutePathString()) > -1 ||
-                _secondary_coords.findIndex(coord.getAbsolutePathString()) > -1) {
+    std::vector<SimTK::State> base_states(nWorkers);
+    base_states[0] = s;
+    for (int w = 1; w < nWorkers; ++w) {
+        Model& worker = *_worker_models[w - 1];
+        base_states[w] = worker.getWorkingState();
+        copyStateToWorker(*_model, s, worker, base_states[w]);
+    }
+
+    std::atomic<int> next_column(0);
+    std::vector<std::exception_ptr> errors(nWorkers);
 
-                _msl_unit_udot(k, j) = coord.getAccelerationValue(s) - _constraint_initial_udot(k);
-                k++;
+    auto run_worker = [&](int w) {
+        try {
+            for (int c = next_column++; c < nColumns; c = next_column++) {
+                computeUnitUdotColumn(w, base_states[w], parameters, columns[c], current_cnt_energy);
             }
         }
-        msl.setOverrideActuation(s, force);
+        catch (...) {
+            errors[w] = std::current_exception();
+            next_column = nColumns;
+        }
+    };
 
-        j++;
+    std::vector<std::thread> threads;
+    for (int w = 1; w < nWorkers; ++w) {
+        threads.emplace_back(run_worker, w);
     }
+    run_worker(0);
 
-    //Compute Non Muscle Actuator Unit Udot
-    j = 0;
-    for (int i = 0; i < _nNonMuscleActuators; ++i) {
-        ScalarActuator &actuator = _model->updComponent<ScalarActuator>(_non_muscle_actuator_path[i]);
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    for (const std::exception_ptr& error : errors) {
+        if (error) std::rethrow_exception(error);
+    }
+}
 
-        double force = parameters[_nMuscles + j] * _optimalForce[_nMuscles + j];
-        actuator.setOverrideActuation(s, force + 1.0);
+void ComakTarget::computeActuatorUnitUdot(const SimTK::State& s,
+    std::vector<int>& perturbed_columns)
+/**
+* The accelerations are linear in the actuator forces, so the unit udot of
+* each PathActuator (including muscles) and CoordinateActuator is computed
+* by applying the generalized forces of a unit actuation to the constrained 
+* forward dynamics operator (calcAcceleration), without realizing the model 
+* forces (e.g. contact) again. 
+*
+* perturbed_columns: columns that must be computed with 
+* computeUnitUdotColumn (secondary coordinates and other actuator types)
+*/
+{
+    const SimTK::SimbodyMatterSubsystem& matter = _model->getMatterSubsystem();
+    int nu = s.getNU();
+    int nb = matter.getNumBodies();
+
+    const ParameterComponents& components = _parameter_components[0];
+
+    SimTK::Vector mobility_forces(nu, 0.0);
+    SimTK::Vector_<SimTK::SpatialVec> body_forces(nb, SimTK::SpatialVec(SimTK::Vec3(0), SimTK::Vec3(0)));
+    SimTK::Vector_<SimTK::SpatialVec> A_GB;
+    SimTK::Vector udot;
+
+    //calcAcceleration is affine in the applied forces, the response to a 
+    //unit actuation is the difference to the response to no applied force
+    SimTK::Vector zero_udot;
+    matter.calcAcceleration(s, mobility_forces, body_forces, zero_udot, A_GB);
+
+    int nColumns = _nActuators + _nSecondaryCoord;
+    for (int c = 0; c < nColumns; ++c) {
+        const ScalarActuator* actuator;
+        int column;
+
+        if (c < _nActuators) {
+            actuator = components.actuators[c];
+            column = c;
+        }
+        else {
+            actuator = components.secondary_damping_actuators[c - _nActuators];
+            column = c + _nSecondaryCoord;
+        }
 
-        _model->realizeAcceleration(s);
-        
-        int k = 0;
-        for (const Coordinate& coord : _model->updComponentList<Coordinate>()) {
-            if (_primary_coords.findIndex(coord.getAbsolutePathString()) > -1 ||
-                _secondary_coords.findIndex(coord.getAbsolutePathString()) > -1) {
+        mobility_forces = 0;
+        body_forces = SimTK::SpatialVec(SimTK::Vec3(0), SimTK::Vec3(0));
 
-                _non_muscle_actuator_unit_udot(k, j) = (coord.getAccelerationValue(s) - _constraint_initial_udot(k));
-                k++;
-            }
-        }
-        actuator.setOverrideActuation(s, force);
+        const PathActuator* path_actuator = dynamic_cast<const PathActuator*>(actuator);
+        const CoordinateActuator* coord_actuator = dynamic_cast<const CoordinateActuator*>(actuator);
 
-        j++;
-    }
+        if (path_actuator) {
+            path_actuator->getGeometryPath().addInEquivalentForces(s, 1.0, body_forces, mobility_forces);
+        }
+        else if (coord_actuator && coord_actuator->getCoordinate() != nullptr) {
+            const Coordinate& coord = *coord_actuator->getCoordinate();
+            matter.getMobilizedBody(coord.getBodyIndex()).applyOneMobilityForce(
+                s, coord.getMobilizerQIndex(), 1.0, mobility_forces);
+        }
+        else {
+            perturbed_columns.push_back(column);
+            continue;
+        }
 
-    //Compute Secondary Coordinate Unit Udot
-    for (int j = 0; j < _nSecondaryCoord; ++j) {		
-        double value = parameters(_nActuators + j) + _unit_udot_epsilon;
+        matter.calcAcceleration(s, mobility_forces, body_forces, udot, A_GB);
 
-        _model->updComponent<Coordinate>(_secondary_coords[j]).setValue(s, value,true);
-        
-        _model->realizeAcceleration(s);
-        
-        int k = 0;
-        for (const Coordinate& coord : _model->updComponentList<Coordinate>()) {
-            if (_primary_coords.findIndex(coord.getAbsolutePathString()) > -1 ||
-                _secondary_coords.findIndex(coord.getAbsolutePathString()) > -1) {
+        for (int k = 0; k < _nConstraints; ++k) {
+            int u = _constraint_u_index[k];
+            double unit_udot = udot(u) - zero_udot(u);
 
-                _secondary_coord_unit_udot(k, j) = (coord.getAccelerationValue(s) - _constraint_initial_udot(k)) / _unit_udot_epsilon;
-                k++;
+            if (c < _nMuscles) {
+                _msl_unit_udot(k, c) = unit_udot;
+            }
+            else if (c < _nActuators) {
+                _non_muscle_actuator_unit_udot(k, c - _nMuscles) = unit_udot;
+            }
+            else {
+                int j = c - _nActuators;
+                _secondary_damping_unit_udot(k, j) = -unit_udot * _secondary_coord_damping[j];
             }
         }
-        
-        //Contact Energy dot
-        double cnt_energy = 0;
-        for (Smith2018ArticularContactForce& cnt_frc : _model->updComponentList<Smith2018ArticularContactForce>()) {
-            cnt_energy += cnt_frc.getOutputValue<double>(s,"potential_energy"); 
-        }
-        _secondary_coord_unit_energy(j) = (cnt_energy - current_cnt_energy)/_unit_udot_epsilon;
-
-        value = parameters(_nActuators + j);
-        _model->updComponent<Coordinate>(_secondary_coords[j]).setValue(s, value, true);
     }
-    _model->realizeAcceleration(s);
 
-    //Compute COMAK damping unit udot
-    SimTK::Vector org_reserve_frc(_nSecondaryCoord,0.0);
+    for (int j = 0; j < _nSecondaryCoord; ++j) {
+        perturbed_columns.push_back(_nActuators + j);
+    }
+}
 
-    /*for (int j = 0; j < _nSecondaryCoord; ++j) {
-        std::string coord_name = _model->updComponent<Coordinate>(_secondary_coords[j]).getName();
-        //org_reserve_frc(j) = _model->updComponent<CoordinateActuator>("/forceset/" + coord_name + "_reserve").getActuation(s);
-        org_reserve_frc(j) = _model->updComponent<CoordinateActuator>(_secondary_damping_actuator_path[j]).getActuation(s);
-    }*/
+void ComakTarget::computeUnitUdotColumn(int worker,
+    const SimTK::State& base_state, const SimTK::Vector& parameters,
+    int column, double base_cnt_energy)
+/**
+* worker: 0 for the model, w for worker model w - 1
+* column: muscles, non muscle actuators, secondary coordinates, 
+* secondary damping
+*/
+{
+    const Model& model = worker == 0 ? *_model : *_worker_models[worker - 1];
+    const ParameterComponents& components = _parameter_components[worker];
+    SimTK::State s = base_state;
 
-    for (int j = 0; j < _nSecondaryCoord; ++j) {
-        std::string coord_name = _model->updComponent<Coordinate>(_secondary_coords[j]).getName();
+    int nMsl = _nMuscles;
+    int nAct = _nActuators;
+    int nSec = _nSecondaryCoord;
 
-        CoordinateActuator& actuator = _model->updComponent<CoordinateActuator>(_secondary_damping_actuator_path[j]);
+    //Apply Perturbation
+    if (column < nAct) {
+        int j = column;
+        double force = parameters[j] * _optimalForce[j];
+        components.actuators[j]->setOverrideActuation(s, force + 1.0);
+    }
+    else if (column < nAct + nSec) {
+        int j = column - nAct;
+        double value = parameters(nAct + j) + _unit_udot_epsilon;
+        components.secondary_coords[j]->setValue(s, value, true);
+    }
+    else {
+        int j = column - nAct - nSec;
+        components.secondary_damping_actuators[j]->setOverrideActuation(s, 1.0);
+    }
 
-        actuator.setOverrideActuation(s, 1.0);
+    model.realizeAcceleration(s);
 
-        _model->realizeAcceleration(s);
+    const SimTK::Vector& s_udot = s.getUDot();
+    for (int k = 0; k < _nConstraints; ++k) {
+        double udot = s_udot[_constraint_u_index[k]] - _constraint_initial_udot(k);
 
-        
-        int k = 0;
-        for (const Coordinate& coord : _model->updComponentList<Coordinate>()) {
-            if (_primary_coords.findIndex(coord.getAbsolutePathString()) > -1 ||
-                _secondary_coords.findIndex(coord.getAbsolutePathString()) > -1) {
-                double damping_force_udot = coord.getAccelerationValue(s) - _constraint_initial_udot(k);
-
-                _secondary_damping_unit_udot(k, j) = -damping_force_udot * _secondary_coord_damping[j];
-                k++;
-            }
+        if (column < nMsl) {
+            _msl_unit_udot(k, column) = udot;
+        }
+        else if (column < nAct) {
+            _non_muscle_actuator_unit_udot(k, column - nMsl) = udot;
+        }
+        else if (column < nAct + nSec) {
+            _secondary_coord_unit_udot(k, column - nAct) = udot / _unit_udot_epsilon;
+        }
+        else {
+            int j = column - nAct - nSec;
+            _secondary_damping_unit_udot(k, j) = -udot * _secondary_coord_damping[j];
         }
-
-        actuator.setOverrideActuation(s, 0.0);		
     }
 
-    _model->realizeAcceleration(s);
+    //Contact Energy dot
+    if (column >= nAct && column < nAct + nSec) {
+        double cnt_energy = 0;
+        for (const Smith2018ArticularContactForce& cnt_frc : model.getComponentList<Smith2018ArticularContactForce>()) {
+            cnt_energy += cnt_frc.getOutputValue<double>(s, "potential_energy");
+        }
+        _secondary_coord_unit_energy(column - nAct) = (cnt_energy - base_cnt_energy) / _unit_udot_epsilon;
+    }
 }
 
 void ComakTarget::setParameterBounds(double scale) {
 
     SimTK::Vector lower_bounds(_nParameters), upper_bounds(_nParameters);
+    const ParameterComponents& components = _parameter_components[0];
+
     int p = 0;
     for (int i = 0; i < _nMuscles; ++i) {
-        Muscle &msl = _model->updComponent<Muscle>(_muscle_path[i]);
+        const ScalarActuator& msl = *components.actuators[p];
 
         double min_value = msl.getMinControl();
         double max_value = msl.getMaxControl();
@@ -590,7 +869,7 @@ void ComakTarget::setParameterBounds(double scale) {
     }
 
     for (int i = 0; i < _nNonMuscleActuators; ++i) {
-        ScalarActuator &actuator = _model->updComponent<ScalarActuator>(_non_muscle_actuator_path[i]);
+        const ScalarActuator& actuator = *components.actuators[p];
 
         double min_value = actuator.getMinControl()*scale;
         double max_value = actuator.getMaxControl()*scale;
@@ -601,7 +880,6 @@ void ComakTarget::setParameterBounds(double scale) {
     }
 
     for (int j = 0; j < _nSecondaryCoord; j++) {
-        Coordinate& coord = _model->updComponent<Coordinate>(_secondary_coords[j]);
             lower_bounds(p) = _init_parameters[p] - _max_change[j] * scale;
             upper_bounds(p) = _init_parameters[p] + _max_change[j] * scale;
         p++;
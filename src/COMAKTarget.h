@@ -31,7 +31,7 @@ namespace OpenSim {
 /**
 
  */
-class ComakTarget : public SimTK::OptimizerSystem
+class OSIMPLUGIN_API ComakTarget : public SimTK::OptimizerSystem
 {
 
 
@@ -49,8 +49,16 @@ public:
         bool useMusclePhysiology = false);
 
 
+    /** Size the problem, called once before the first update(). */
     void initialize();
 
+    /** %Set the state, observed accelerations and initial parameters for 
+    the next optimization and recompute the linearized acceleration 
+    constraints. The problem dimensions do not change, so the same target 
+    (and Optimizer) can be reused for every COMAK iteration and frame. */
+    void update(SimTK::State s, const SimTK::Vector& observed_udot,
+        const SimTK::Vector& init_parameters);
+
     //--------------------------------------------------------------------------
     // REQUIRED OPTIMIZATION TARGET METHODS
     //--------------------------------------------------------------------------
@@ -121,11 +129,65 @@ public:
         _prev_secondary_values = prev_secondary_values;
     }
 
+    /** Update the secondary coordinate unit udots with rank one Broyden
+    updates for up to max_updates consecutive update() calls before they
+    are recomputed by finite differences. 0 (default) disables. */
+    void setMaxBroydenUpdates(int max_updates) {
+        _max_broyden_updates = max_updates;
+    }
+
+    /** Recompute the secondary coordinate unit udots by finite differences 
+    in the next update(). */
+    void resetSecondaryUnitUdot() {
+        _reset_secondary_unit_udot = true;
+    }
+
+    /** Copies of the model (connected with initSystem()) used to evaluate
+    the unit udots in parallel, one thread per worker model. Must be set 
+    before initialize(). */
+    void setWorkerModels(const std::vector<Model*>& worker_models) {
+        _worker_models = worker_models;
+    }
+
     //Helper
     void computeSimulatedAcceleration(SimTK::State s, const SimTK::Vector &parameters, SimTK::Vector& sim_udot);
-    void computeUnitUdot(SimTK::State s, const SimTK::Vector& parameters);
-    void precomputeConstraintMatrix();
+    void computeUnitUdot(SimTK::State s, const SimTK::Vector& parameters,
+        bool perturb_secondary_coords = true);
+    void computeActuatorUnitUdot(const SimTK::State& s,
+        std::vector<int>& perturbed_columns);
+    void computeUnitUdotColumn(int worker, const SimTK::State& base_state,
+        const SimTK::Vector& parameters, int column, double base_cnt_energy);
+    void precomputeConstraintMatrix(bool perturb_secondary_coords = true);
     void setParameterBounds(double scale);
+    void initializeIndexMaps();
+
+    double getActivationExponent() const {
+        return _activationExponent;
+    }
+
+    /** Wall time [s] of the unit udot computation in the last update(). */
+    double getUnitUdotTime() const {
+        return _unit_udot_time;
+    }
+
+    /** Number of gradientFunc() calls since the last reset. IPOPT does not
+    report its iteration count through SimTK::Optimizer, this is the closest
+    measure of the optimizer work (roughly one per iteration plus those of 
+    any restarts). */
+    int getNumGradientEvaluations() const {
+        return _n_gradient_evaluations;
+    }
+
+    void resetNumGradientEvaluations() {
+        _n_gradient_evaluations = 0;
+    }
+
+    /** Export the optimization as a quadratic program for ComakQPSolver:
+    min 1/2 x'*diag(hessian)*x + gradient'*x s.t. A*x = b and
+    lower <= x <= upper. Only valid for an activation exponent of 2. */
+    void getQuadraticProgram(SimTK::Vector& hessian, SimTK::Vector& gradient,
+        SimTK::Matrix& A, SimTK::Vector& b,
+        SimTK::Vector& lower, SimTK::Vector& upper) const;
     void printPerformance(SimTK::Vector parameters);
 private:
 
@@ -136,6 +198,7 @@ public:
 
 private:
     Model *_model;
+    std::vector<Model*> _worker_models;
     SimTK::State _state;
     SimTK::Vector _optimalForce;
     SimTK::Vector _init_parameters;
@@ -166,6 +229,14 @@ private:
     SimTK::Matrix _secondary_coord_unit_udot;
     SimTK::Matrix _secondary_damping_unit_udot;
     SimTK::Vector _secondary_coord_unit_energy;
+    double _cnt_energy;
+
+    int _max_broyden_updates;
+    int _n_broyden_updates;
+    bool _reset_secondary_unit_udot;
+
+    double _unit_udot_time;
+    mutable int _n_gradient_evaluations;
 
     SimTK::Vector _init_secondary_values;
     SimTK::Vector _prev_secondary_values;
@@ -177,6 +248,22 @@ private:
     
     Array<std::string> _constraint_names;
 
+    //Index maps built in initialize() so the unit udot and acceleration
+    //loops do not look up components by path. For each constraint: the 
+    //index in the coordinate list, the index in udot and whether it is a
+    //secondary coordinate.
+    std::vector<int> _constraint_coord_index;
+    std::vector<int> _constraint_u_index;
+    std::vector<bool> _constraint_is_secondary;
+
+    //Parameter components of the model (index 0) and each worker model
+    struct ParameterComponents {
+        std::vector<const ScalarActuator*> actuators;
+        std::vector<const Coordinate*> secondary_coords;
+        std::vector<const ScalarActuator*> secondary_damping_actuators;
+    };
+    std::vector<ParameterComponents> _parameter_components;
+
     int _verbose;
 
     SimTK::Vector _max_change;
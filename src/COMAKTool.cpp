@@ -25,13 +25,62 @@
 #include <OpenSim.h>
 #include "COMAKTool.h"
 #include "COMAKTarget.h"
+#include "COMAKQPSolver.h"
+#include "COMAKStaticEquilibriumSolver.h"
 #include "HelperFunctions.h"
 #include "Smith2018ArticularContactForce.h"
 #include <OpenSim/Common/Stopwatch.h>
+#include <thread>
+#include <mutex>
+#include <functional>
+#include <fstream>
+#include <sstream>
+#include <cstring>
+#include <cstdint>
+#include <cstdio>
 
 using namespace OpenSim;
 using namespace SimTK;
 
+//IPOPT (with the sequential MUMPS linear solver built into Simbody) is not
+//thread safe, COMAK windows solved in parallel take turns calling it.
+static std::mutex ipopt_mutex;
+
+//Call func(0) ... func(n-1) with one thread each, func(0) on the calling 
+//thread so the visualizer stays on the main thread. The first exception
+//thrown by any of the calls is rethrown once all threads are finished.
+void COMAKTool::runInParallel(int n, const std::function<void(int)>& func)
+{
+    std::vector<std::exception_ptr> errors(n);
+    std::vector<std::thread> threads;
+
+    for (int k = 1; k < n; ++k) {
+        threads.emplace_back([&func, &errors, k]() {
+            try {
+                func(k);
+            }
+            catch (...) {
+                errors[k] = std::current_exception();
+            }
+        });
+    }
+
+    try {
+        func(0);
+    }
+    catch (...) {
+        errors[0] = std::current_exception();
+    }
+
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    for (const std::exception_ptr& error : errors) {
+        if (error) std::rethrow_exception(error);
+    }
+}
+
 COMAKTool::COMAKTool()
 {
     constructProperties();
@@ -50,6 +99,7 @@ void COMAKTool::constructProperties()
     constructProperty_model_file("");
     constructProperty_coordinates_file("");
     constructProperty_external_loads_file("");
+    constructProperty_initial_guess_file("");
     constructProperty_results_directory("");
     constructProperty_results_prefix("");
 
@@ -71,37 +121,79 @@ void COMAKTool::constructProperties()
     constructProperty_settle_threshold(1e-5);
     constructProperty_settle_accuracy(1e-6);
     constructProperty_settle_internal_step_limit(1e-6);
+    constructProperty_settle_method("forward_simulation");
+    constructProperty_settle_max_iterations(50);
     constructProperty_print_settle_sim_results(false);
     constructProperty_settle_sim_results_directory("");
     constructProperty_settle_sim_results_prefix("");
+    constructProperty_use_settle_cache(true);
+    constructProperty_settle_cache_directory("");
 
     constructProperty_max_iterations(50);
     constructProperty_udot_tolerance(1.0);
     constructProperty_udot_worse_case_tolerance(50.0);
     constructProperty_unit_udot_epsilon(1e-8);
+    constructProperty_num_threads(1);
+    constructProperty_comak_solver("ipopt");
+    constructProperty_max_secondary_broyden_updates(0);
+    constructProperty_coarse_contact_iterations(0);
+    constructProperty_coarse_contact_udot_threshold(-1.0);
+    constructProperty_num_windows(1);
+    constructProperty_window_overlap_frames(5);
+    constructProperty_stream_results(false);
+    constructProperty_stream_flush_interval(10);
+    constructProperty_restart_from_checkpoint(false);
     
     constructProperty_contact_energy_weight(0.0);
     constructProperty_COMAKCostFunctionParameterSet(COMAKCostFunctionParameterSet());
 
     constructProperty_use_visualizer(false);    
     constructProperty_verbose(0);
+    constructProperty_print_telemetry(false);
 
     constructProperty_AnalysisSet(AnalysisSet());
 }
 
 void COMAKTool::setModel(Model& model) {
-    _model = model;
+    _set_model.reset(model.clone());
 }
 
 void COMAKTool::run()
 {
     printCOMAKascii();
     initialize();
-    performCOMAK();
+
+    if (get_num_windows() > 1) {
+        performWindowedCOMAK();
+    }
+    else {
+        performCOMAK();
+    }
+
+    printConvergenceSummary();
+    printResultsFiles();
 }
 
 void COMAKTool::initialize()
 {
+    _telemetry.clear();
+    _bad_frames.clear();
+    _bad_times.clear();
+    _bad_udot_errors.clear();
+    _bad_udot_coord.clear();
+
+    //A copy of an initialized tool (e.g. a COMAK window) starts from the
+    //properties only, these are rebuilt from the model below
+    _muscle_path.setSize(0);
+    _non_muscle_actuator_path.setSize(0);
+    _secondary_damping_actuator_path.setSize(0);
+    _cost_muscle_weights.clearAndDestroy();
+
+    _settle_time = 0.0;
+    _prepare_time = 0.0;
+    _solve_time = 0.0;
+    _output_time = 0.0;
+
     //Make results directory
     int makeDir_out = IO::makeDir(get_results_directory());
     if (errno == ENOENT && makeDir_out == -1) {
@@ -109,9 +201,30 @@ void COMAKTool::initialize()
             get_results_directory() +
             "Possible reason: This tool cannot make new folder with subfolder.");
     }
-    _model = Model(get_model_file());
 
-    //setModel(Model(get_model_file()));
+    OPENSIM_THROW_IF(get_comak_solver() != "ipopt" &&
+        get_comak_solver() != "qp", Exception,
+        "comak_solver: " + get_comak_solver() + " is not valid. "
+        "Options: 'ipopt', 'qp'.");
+
+    OPENSIM_THROW_IF(get_settle_method() != "forward_simulation" &&
+        get_settle_method() != "static_equilibrium", Exception,
+        "settle_method: " + get_settle_method() + " is not valid. "
+        "Options: 'forward_simulation', 'static_equilibrium'.");
+
+    //The windows are solved from settled poses, the streamed files of a 
+    //previous run cannot be split between them
+    OPENSIM_THROW_IF(get_restart_from_checkpoint() && get_num_windows() > 1,
+        Exception, "restart_from_checkpoint is not supported with "
+        "num_windows > 1.");
+
+    //A model passed to setModel() is used instead of loading model_file
+    if (_set_model) {
+        _model = *_set_model;
+    }
+    else {
+        _model = Model(get_model_file());
+    }
     updateModelForces();
 
     _model.initSystem();
@@ -248,10 +361,18 @@ void COMAKTool::initialize()
     }
 
     // Find the index of each coordinate in the updComponentList<Coordinate>
+    _coord_is_secondary.clear();
+    _coord_is_constrained.clear();
+
     int nCoord = 0;
     for (Coordinate& coord : _model.updComponentList<Coordinate>()) {
         std::string path = coord.getAbsolutePathString();
 
+        bool secondary = _secondary_coord_path.findIndex(path) > -1;
+        _coord_is_secondary.push_back(secondary);
+        _coord_is_constrained.push_back(
+            secondary || _primary_coord_path.findIndex(path) > -1);
+
         int ind = _prescribed_coord_path.findIndex(path);
         if ( ind > -1){
             _prescribed_coord_index[ind] = nCoord;
@@ -442,22 +563,215 @@ void COMAKTool::initialize()
 
 void COMAKTool::performCOMAK()
 {
-    SimTK::State state = _model.initSystem();
+    _model.initSystem();
 
     //Read Kinematics and Compute Desired Accelerations
     extractKinematicsFromFile();
 
-    //Initialize Secondary Kinematics
+    SimTK::Vector init_secondary_values = computeInitialSecondaryValues();
+
+    prepareCOMAKModel();
+
+    solveCOMAK(init_secondary_values);
+}
+
+void COMAKTool::performWindowedCOMAK()
+{
+    _model.initSystem();
+    extractKinematicsFromFile();
+
+    //Split the output frames into windows of equal size, each window after
+    //the first starts window_overlap_frames early from a settled pose and 
+    //the overlap frames are discarded when the windows are stitched
+    int n_windows = std::min(get_num_windows(), _n_out_frames);
+    int window_size = (_n_out_frames + n_windows - 1) / n_windows;
+    n_windows = (_n_out_frames + window_size - 1) / window_size;
+    int n_overlap = std::max(0, get_window_overlap_frames());
+
+    std::cout << "\nPerforming COMAK in " << n_windows << " windows of " 
+        << window_size << " frames (" << n_overlap << " overlap frames)." 
+        << std::endl;
+
+    double stop_time = get_stop_time();
+
+    //Divide the unit udot threads between the windows so the windows 
+    //solved in parallel do not oversubscribe the machine
+    int input_num_threads = get_num_threads();
+    int num_threads = input_num_threads;
+    if (num_threads < 1) {
+        num_threads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    }
+    int window_threads = std::max(1, num_threads / n_windows);
+    set_num_threads(window_threads);
+
+    std::cout << "Computing the unit udots of each window with " 
+        << window_threads << " thread(s)." << std::endl;
+
+    //The first window is solved by this tool, the others by copies
+    std::vector<std::unique_ptr<COMAKTool>> window_tools;
+    std::vector<COMAKTool*> windows;
+    std::vector<int> first_kept_frame;
+
+    for (int k = 0; k < n_windows; ++k) {
+        int first = _start_frame + k * window_size;
+        int last = std::min(first + window_size, 
+            _start_frame + _n_out_frames) - 1;
+        first_kept_frame.push_back(first);
+
+        if (k == 0) {
+            set_stop_time(_time[last]);
+            windows.push_back(this);
+            continue;
+        }
+
+        COMAKTool* window = clone();
+        window_tools.emplace_back(window);
+        windows.push_back(window);
+
+        window->set_start_time(_time[std::max(_start_frame, first - n_overlap)]);
+        window->set_stop_time(_time[last]);
+        window->set_num_windows(1);
+        window->set_settle_secondary_coordinates_at_start(true);
+        window->set_print_settle_sim_results(false);
+        window->set_print_processed_input_kinematics(false);
+        window->set_use_visualizer(false);
+        window->set_stream_results(false);
+
+        //The model set with setModel() is not copied with the tool
+        if (_set_model) {
+            window->setModel(*_set_model);
+        }
+
+        window->initialize();
+        window->_model.initSystem();
+        window->extractKinematicsFromFile();
+    }
+
+    //Settle and solve the windows in parallel, applying the external loads
+    //changes the working directory so it is done serially in between
+    std::vector<SimTK::Vector> init_secondary_values(n_windows);
+
+    runInParallel(n_windows, [&](int k) {
+        init_secondary_values[k] = windows[k]->computeInitialSecondaryValues();
+    });
+
+    for (COMAKTool* window : windows) {
+        window->prepareCOMAKModel();
+    }
+
+    runInParallel(n_windows, [&](int k) {
+        windows[k]->solveCOMAK(init_secondary_values[k]);
+    });
+
+    set_stop_time(stop_time);
+    set_num_threads(input_num_threads);
+
+    //Stitch the windows, recording the kept frames with this model
+    SimTK::State state = _model.getWorkingState();
+    initializeParameterComponents();
+
+    for (int k = 1; k < n_windows; ++k) {
+        COMAKTool& window = *windows[k];
+        int n_discard = first_kept_frame[k] - window._start_frame;
+
+        int n_window_states = static_cast<int>(window._result_states.getSize());
+
+        SimTK::RowVector prev_values = 
+            _result_values.getRowAtIndex(_result_values.getNumRows() - 1);
+
+        for (int j = n_discard; j < n_window_states; ++j) {
+            const SimTK::State& window_state = window._result_states.get(j);
+
+            state.setTime(window_state.getTime());
+            state.updQ() = window_state.getQ();
+            state.updU() = window_state.getU();
+            state.updZ() = window_state.getZ();
+
+            const auto& activations = window._result_activations.getRowAtIndex(j);
+            for (int m = 0; m < _n_actuators; ++m) {
+                _optim_parameters(m) = activations(m);
+            }
+            setActuatorsFromComakParameters(state, _optim_parameters);
+            _model.realizeAcceleration(state);
+
+            recordResultsStorage(state, window._start_frame + j);
+        }
+
+        //Jump in the secondary coordinates at the window boundary
+        const auto& values = 
+            _result_values.getRowAtIndex(_result_values.getNumRows() - 
+                (n_window_states - n_discard));
+
+        double max_jump = 0.0;
+        std::string max_jump_coord;
+        for (int m = 0; m < _n_secondary_coord; ++m) {
+            int c = _secondary_coord_index[m];
+            double jump = std::abs(values(c) - prev_values(c));
+            if (jump > max_jump) {
+                max_jump = jump;
+                max_jump_coord = _secondary_coord_name[m];
+            }
+        }
+        std::cout << "Window " << k << " starts at time " 
+            << _time[first_kept_frame[k]] << ", max secondary coordinate "
+            << "change from previous frame: " << max_jump << " (" 
+            << max_jump_coord << ")" << std::endl;
+
+        for (const IterationTelemetry& telemetry : window._telemetry) {
+            if (telemetry.frame >= first_kept_frame[k]) {
+                _telemetry.push_back(telemetry);
+            }
+        }
+
+        for (int b = 0; b < (int)window._bad_frames.size(); ++b) {
+            if (window._bad_frames[b] < first_kept_frame[k]) continue;
+
+            _bad_frames.push_back(window._bad_frames[b]);
+            _bad_times.push_back(window._bad_times[b]);
+            _bad_udot_errors.push_back(window._bad_udot_errors[b]);
+            _bad_udot_coord.push_back(window._bad_udot_coord[b]);
+        }
+    }
+}
+
+SimTK::Vector COMAKTool::computeInitialSecondaryValues()
+{
+    double start = SimTK::realTime();
     SimTK::Vector init_secondary_values(_n_secondary_coord);
 
-    if (get_settle_secondary_coordinates_at_start()) {
-        init_secondary_values = equilibriateSecondaryCoordinates();
+    if (!get_initial_guess_file().empty()) {
+        readInitialGuessFile();
+
+        for (int i = 0; i < _n_secondary_coord; ++i) {
+            init_secondary_values(i) = _initial_guess(_start_frame, _n_actuators + i);
+        }
+        std::cout << "Using the initial guess secondary coordinate values." << std::endl;
+    }
+    else if (get_settle_secondary_coordinates_at_start()) {
+        std::string cache_file;
+        if (get_use_settle_cache()) {
+            cache_file = computeSettleCacheFile();
+        }
+
+        if (!cache_file.empty() && 
+            readSettleCache(cache_file, init_secondary_values)) {
+            std::cout << "Using settled secondary coordinate values from "
+                << cache_file << std::endl;
+        }
+        else {
+            init_secondary_values = equilibriateSecondaryCoordinates();
+
+            if (!cache_file.empty()) {
+                writeSettleCache(cache_file, init_secondary_values);
+            }
+        }
     }
     else {
         for (int i = 0; i < _n_secondary_coord; ++i) {
             init_secondary_values(i) = _q_matrix(_start_frame, _secondary_coord_index[i]);
         }
     }
+    _settle_time = SimTK::realTime() - start;
 
     if (get_verbose() > 1) {
         std::cout << std::endl;
@@ -468,8 +782,14 @@ void COMAKTool::performCOMAK()
         }
         std::cout << std::endl;
     }
+    return init_secondary_values;
+}
+
+void COMAKTool::prepareCOMAKModel()
+{
+    double start = SimTK::realTime();
 
-     //Apply External Loads
+    //Apply External Loads
     applyExternalLoads();
 
     //Set Prescribed Coordinates
@@ -490,11 +810,17 @@ void COMAKTool::performCOMAK()
         coord.set_locked(false);
         coord.set_prescribed(false);
     }
+    _prepare_time = SimTK::realTime() - start;
+}
+
+void COMAKTool::solveCOMAK(const SimTK::Vector& init_secondary_values)
+{
+    double solve_start = SimTK::realTime();
 
     if (get_use_visualizer()) {
         _model.setUseVisualizer(true);
     }
-    state = _model.initSystem();
+    SimTK::State state = _model.initSystem();
 
     //Setup Results Storage
     initializeResultsStorage();
@@ -503,6 +829,30 @@ void COMAKTool::performCOMAK()
     //Prepare for Optimization
     _model.setAllControllersEnabled(false);
 
+    //Model copies for computing the unit udots in parallel
+    int num_threads = get_num_threads();
+    if (num_threads < 1) {
+        num_threads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    }
+
+    _worker_models.clear();
+    std::vector<Model*> worker_models;
+    for (int w = 1; w < num_threads; ++w) {
+        Model* worker = _model.clone();
+        worker->setUseVisualizer(false);
+        worker->updAnalysisSet().clearAndDestroy();
+        worker->initSystem();
+        worker->setAllControllersEnabled(false);
+
+        _worker_models.emplace_back(worker);
+        worker_models.push_back(worker);
+    }
+    if (num_threads > 1) {
+        std::cout << "Computing COMAK unit udots with " << num_threads << " threads." << std::endl;
+    }
+
+    initializeParameterComponents();
+
     for (ScalarActuator &actuator : _model.updComponentList<ScalarActuator>()) {
         actuator.overrideActuation(state, true);
     }
@@ -538,14 +888,88 @@ void COMAKTool::performCOMAK()
 
     _consecutive_bad_frame = 1;
 
+    //The COMAK problem dimensions do not change, so the same target and
+    //optimizer are used for every iteration and frame. The target is 
+    //updated before each solve, and IPOPT is warm started from the
+    //previous solution.
+    ComakTarget target = ComakTarget(state, &_model, ~_udot_matrix[_start_frame],
+        _optim_parameters, _optim_parameter_names,
+        _primary_coord_path, _secondary_coord_path,
+        _muscle_path, _non_muscle_actuator_path,
+        _secondary_damping_actuator_path, false);
+
+    target.setUdotTolerance(get_udot_tolerance());
+    target.setUnitUdotEpsilon(get_unit_udot_epsilon());
+    target.setDT(_dt);
+    target.setOptimalForces(_optimal_force);
+    target.setMuscleVolumes(_muscle_volumes);
+    target.setSecondaryCoordinateDamping(_secondary_coord_damping);
+    target.setMaxChange(_secondary_coord_max_change);
+    target.setContactEnergyWeight(get_contact_energy_weight());
+    target.setWorkerModels(worker_models);
+    target.setMaxBroydenUpdates(get_max_secondary_broyden_updates());
+    target.initialize();
+
+    SimTK::OptimizerAlgorithm algorithm = SimTK::InteriorPoint;
+    std::unique_lock<std::mutex> ipopt_lock(ipopt_mutex);
+    SimTK::Optimizer optimizer(target, algorithm);
+    ipopt_lock.unlock();
+
+    optimizer.setDiagnosticsLevel(1);
+    optimizer.setMaxIterations(500);
+    //optimizer.setConvergenceTolerance(0.00000001);
+    //optimizer.setConstraintTolerance();
+    optimizer.useNumericalGradient(false);
+    optimizer.useNumericalJacobian(false);
+    //optimizer.setLimitedMemoryHistory();
+    /*
+     convergenceTolerance(Real(1e-3)),
+     constraintTolerance(Real(1e-4)),
+     maxIterations(1000),
+     limitedMemoryHistory(50),
+     diagnosticsLevel(0),
+     diffMethod(Differentiator::CentralDifference),
+     objectiveEstimatedAccuracy(SignificantReal),
+     constraintsEstimatedAccuracy(SignificantReal),
+     numericalGradient(false), 
+     numericalJacobian(false)
+    */
+
+    if (algorithm == SimTK::InteriorPoint) {
+        // Some IPOPT-specific settings
+        optimizer.setAdvancedBoolOption("warm_start", true);
+        optimizer.setAdvancedRealOption("obj_scaling_factor", 1);
+        optimizer.setAdvancedRealOption("nlp_scaling_max_gradient", 1);
+    }
+
+    //With the default activation exponent of 2 the COMAK optimization is a
+    //convex QP, solved directly and warm started from the previous solve
+    bool use_qp_solver = get_comak_solver() == "qp" &&
+        target.getActivationExponent() == 2.0;
+    ComakQPSolver qp_solver;
+
+    SimTK::Vector qp_hessian, qp_gradient, qp_b, qp_lower, qp_upper;
+    SimTK::Matrix qp_A;
+
     //Loop over each time step
     //------------------------
     std::cout << "\nPerforming COMAK...\n" << std::endl;
 
-    int frame_num = 0;
+    //Restore the frames solved by an interrupted run
+    int last_restored_frame = -1;
+    if (get_restart_from_checkpoint()) {
+        last_restored_frame = restoreStreamedResults(state);
+    }
+    else if (get_stream_results()) {
+        openResultsStreams();
+    }
+
+    int frame_num = last_restored_frame < 0 ? 0 : 
+        last_restored_frame - _start_frame + 1;
     for (int i = 0; i < _n_frames; ++i) {
         if (_time[i] < get_start_time()) { continue; }
         if (_time[i] > get_stop_time()) { break; };
+        if (i <= last_restored_frame) { continue; }
 
         //Set Time
         state.setTime(_time[i]);
@@ -567,6 +991,20 @@ void COMAKTool::performCOMAK()
             coord.setSpeedValue(state, _u_matrix(i, _secondary_coord_index[j]));
         }
 
+        //Start from the initial guess solution
+        if (!get_initial_guess_file().empty()) {
+            for (int j = 0; j < _n_parameters; ++j) {
+                if (!SimTK::isNaN(_initial_guess(i, j))) {
+                    _optim_parameters[j] = _initial_guess(i, j);
+                }
+            }
+            for (int j = 0; j < _n_secondary_coord; ++j) {
+                Coordinate& coord = _model.updComponent<Coordinate>(_secondary_coord_path[j]);
+                coord.setValue(state, _initial_guess(i, _n_actuators + j), false);
+                coord.setSpeedValue(state, _initial_guess_speed(i, j));
+            }
+        }
+
         _model.assemble(state);
         _model.realizeVelocity(state);
 
@@ -577,10 +1015,28 @@ void COMAKTool::performCOMAK()
         SimTK::Matrix iter_parameters(get_max_iterations(), _n_parameters, 0.0);
 
         int n_iter = 0;
+        bool use_coarse = false;
+        std::vector<bool> iter_coarse(get_max_iterations(), false);
 
         for (int iter = 0; iter < get_max_iterations(); ++iter) {
             n_iter++;
 
+            //Use the coarse contact meshes for the first iterations or 
+            //while the udot error is large, never for the last iteration
+            bool prev_coarse = use_coarse;
+            use_coarse = iter < get_max_iterations() - 1 &&
+                (iter < get_coarse_contact_iterations() ||
+                (get_coarse_contact_udot_threshold() > 0 && iter > 0 &&
+                iter_max_udot_error(iter - 1) >
+                get_coarse_contact_udot_threshold()));
+            iter_coarse[iter] = use_coarse;
+            setUseCoarseContactMeshes(state, use_coarse);
+
+            IterationTelemetry telemetry;
+            telemetry.frame = i;
+            telemetry.iteration = iter;
+            telemetry.coarse = use_coarse;
+
             if (get_verbose() > 0) {
                 std::cout << std::endl;
                 std::cout << "--------------------------------------------------------------------------------" << std::endl;
@@ -606,61 +1062,69 @@ void COMAKTool::performCOMAK()
                 j++;
             }*/
 
-            ComakTarget target = ComakTarget(state, &_model, ~_udot_matrix[i],
-                _optim_parameters, _optim_parameter_names,
-                _primary_coord_path, _secondary_coord_path,
-                _muscle_path, _non_muscle_actuator_path,
-                _secondary_damping_actuator_path, false);
-
             SimTK::Vector msl_weight(_n_muscles);
             for (int m = 0; m < _n_muscles; ++m) {
                 msl_weight(m) = _cost_muscle_weights.get(m).calcValue(SimTK::Vector(1, _time[i]));
             }
 
             target.setCostFunctionWeight(msl_weight);
-            target.setUdotTolerance(get_udot_tolerance());
-            target.setUnitUdotEpsilon(get_unit_udot_epsilon());
-            target.setDT(_dt);
-            target.setOptimalForces(_optimal_force);
             target.setPrevSecondaryValues(_prev_secondary_value);
-            target.setMuscleVolumes(_muscle_volumes);
-            target.setSecondaryCoordinateDamping(_secondary_coord_damping);
-            target.setMaxChange(_secondary_coord_max_change);
-            target.setContactEnergyWeight(get_contact_energy_weight());
-            target.initialize();
-
-            SimTK::OptimizerAlgorithm algorithm = SimTK::InteriorPoint;
-            SimTK::Optimizer optimizer(target, algorithm);
-
-            optimizer.setDiagnosticsLevel(1);
-            optimizer.setMaxIterations(500);
-            //optimizer.setConvergenceTolerance(0.00000001);
-            //optimizer.setConstraintTolerance();
-            optimizer.useNumericalGradient(false);
-            optimizer.useNumericalJacobian(false);
-            //optimizer.setLimitedMemoryHistory();
-            /*
-             convergenceTolerance(Real(1e-3)),
-             constraintTolerance(Real(1e-4)),
-             maxIterations(1000),
-             limitedMemoryHistory(50),
-             diagnosticsLevel(0),
-             diffMethod(Differentiator::CentralDifference),
-             objectiveEstimatedAccuracy(SignificantReal),
-             constraintsEstimatedAccuracy(SignificantReal),
-             numericalGradient(false), 
-             numericalJacobian(false)
-            */
-
-            if (algorithm == SimTK::InteriorPoint) {
-                // Some IPOPT-specific settings
-                optimizer.setAdvancedBoolOption("warm_start", true);
-                optimizer.setAdvancedRealOption("obj_scaling_factor", 1);
-                optimizer.setAdvancedRealOption("nlp_scaling_max_gradient", 1);
+
+            //Perturb the secondary coordinates at the first iteration of 
+            //each frame, when the last iteration did not reduce the
+            //udot error and when the contact mesh resolution changed
+            //(Broyden updates otherwise)
+            if (iter == 0 || use_coarse != prev_coarse || (iter > 1 && 
+                iter_max_udot_error(iter - 1) >= iter_max_udot_error(iter - 2))) {
+                target.resetSecondaryUnitUdot();
+            }
+            double start = SimTK::realTime();
+            target.update(state, ~_udot_matrix[i], _optim_parameters);
+            telemetry.update_time = SimTK::realTime() - start;
+            telemetry.unit_udot_time = target.getUnitUdotTime();
+
+            bool qp_solved = false;
+            if (use_qp_solver) {
+                start = SimTK::realTime();
+                target.getQuadraticProgram(qp_hessian, qp_gradient,
+                    qp_A, qp_b, qp_lower, qp_upper);
+                telemetry.qp_setup_time = SimTK::realTime() - start;
+
+                start = SimTK::realTime();
+                SimTK::Vector qp_parameters = _optim_parameters;
+                qp_solved = qp_solver.solve(qp_hessian, qp_gradient,
+                    qp_A, qp_b, qp_lower, qp_upper, qp_parameters);
+                telemetry.qp_solve_time = SimTK::realTime() - start;
+                telemetry.qp_iterations = qp_solver.getNumIterations();
+
+                if (qp_solved) {
+                    _optim_parameters = qp_parameters;
+                }
+
+                if (get_verbose() > 0) {
+                    if (qp_solved) {
+                        std::cout << "COMAK QP solved in " 
+                            << qp_solver.getNumIterations() << " iterations"
+                            << (qp_solver.getPolished() ? " (polished)." : ".")
+                            << std::endl;
+                    }
+                    else {
+                        std::cout << "COMAK QP failed, using IPOPT." << std::endl;
+                    }
+                }
             }
 
-            for (int m = 0; m < 10; ++m) {
+            start = SimTK::realTime();
+            target.resetNumGradientEvaluations();
+
+            for (int m = 0; m < 10 && !qp_solved; ++m) {
                 try {
+                    //IPOPT is not thread safe, time the wait for other 
+                    //threads separately from the solve
+                    double wait_start = SimTK::realTime();
+                    std::lock_guard<std::mutex> lock(ipopt_mutex);
+                    telemetry.ipopt_wait_time += 
+                        SimTK::realTime() - wait_start;
                     optimizer.optimize(_optim_parameters);
                     break;
                 }
@@ -669,15 +1133,26 @@ void COMAKTool::performCOMAK()
                         std::cout << "COMAK Optimization failed, upping the parameter bounds: " << ex.getMessage() << std::endl;
                     }
                     target.setParameterBounds(m);
-                    optimizer.setOptimizerSystem(target);
+                    telemetry.ipopt_retries++;
                 }
 
             }
+            if (!qp_solved) {
+                telemetry.ipopt_time = SimTK::realTime() - start - 
+                    telemetry.ipopt_wait_time;
+                telemetry.gradient_evaluations = 
+                    target.getNumGradientEvaluations();
+            }
             iter_parameters[iter] = ~_optim_parameters;
 
+            start = SimTK::realTime();
             setStateFromComakParameters(state, _optim_parameters);
+            telemetry.set_state_time = SimTK::realTime() - start;
 
+            start = SimTK::realTime();
             _model.realizeAcceleration(state);
+            telemetry.realize_time = SimTK::realTime() - start;
+            _telemetry.push_back(telemetry);
 
             //Output Optimization Results
             if (get_verbose() > 1) {
@@ -702,13 +1177,13 @@ void COMAKTool::performCOMAK()
             int k = 0;
             max_udot_error = 0;
             for (const Coordinate& coord : _model.getComponentList<Coordinate>()) {
-                std::string path = coord.getAbsolutePathString();
-
+                bool secondary = _coord_is_secondary[k];
+                bool constrained = _coord_is_constrained[k];
 
                 double coord_udot = coord.getAccelerationValue(state);
                 double udot_error;
                 double observed_udot;
-                if (_secondary_coord_path.findIndex(path) > -1) {
+                if (secondary) {
                     observed_udot = 0.0;
                 }
                 else {
@@ -717,7 +1192,7 @@ void COMAKTool::performCOMAK()
                 udot_error = abs(observed_udot - coord_udot);
 
                 k++;
-                if (_secondary_coord_path.findIndex(path) == -1 && _primary_coord_path.findIndex(path) == -1) {
+                if (!constrained) {
                     continue;
                 }
 
@@ -738,8 +1213,8 @@ void COMAKTool::performCOMAK()
             iter_max_udot_coord[iter] = max_udot_coord;
 
             
-            //Check for convergence
-            if (max_udot_error < get_udot_tolerance()) {
+            //Check for convergence, only with the full resolution meshes
+            if (!use_coarse && max_udot_error < get_udot_tolerance()) {
                 _consecutive_bad_frame = 1; //converged so reset
                 break;
             }
@@ -757,6 +1232,8 @@ void COMAKTool::performCOMAK()
             int min_iter = -1;
             std::string bad_coord;
             for (int m = 0; m < get_max_iterations(); ++m) {
+                if (iter_coarse[m]) continue;
+
                 if (iter_max_udot_error(m) < min_val) {
                     min_val = iter_max_udot_error(m);
                     min_iter = m;
@@ -811,7 +1288,12 @@ void COMAKTool::performCOMAK()
         }
 
         //Save the results
+        double record_start = SimTK::realTime();
         recordResultsStorage(state,i);
+
+        if (!_telemetry.empty()) {
+            _telemetry.back().record_time = SimTK::realTime() - record_start;
+        }
  
         //Visualize the Results
         if (get_use_visualizer()) {
@@ -834,7 +1316,21 @@ void COMAKTool::performCOMAK()
         }
     } //END of COMAK timestep
 
-    //Print Convergence Summary
+    _solve_time = SimTK::realTime() - solve_start;
+
+    if (get_verbose() > 0) {
+        std::cout << std::endl;
+        std::cout << "Contact Proximity Cache:" << std::endl;
+        std::cout << std::setw(40) << "Contact" << std::setw(15) << "Hits" << std::setw(15) << "Misses" << std::endl;
+
+        for (const Smith2018ArticularContactForce& cnt_force : _model.getComponentList<Smith2018ArticularContactForce>()) {
+            std::cout << std::setw(40) << cnt_force.getName() << std::setw(15) << cnt_force.getProximityCacheHits() << std::setw(15) << cnt_force.getProximityCacheMisses() << std::endl;
+        }
+    }
+}
+
+void COMAKTool::printConvergenceSummary()
+{
     std::cout << "Convergence Summary:" << std::endl;
     std::cout << "--------------------" << std::endl;
 
@@ -848,33 +1344,15 @@ void COMAKTool::performCOMAK()
             std::cout << std::setw(15) << _bad_times[i] << std::setw(15) << _bad_frames[i] << std::setw(15) << _bad_udot_errors[i] << std::endl;
         }
     }
-    //Print Results
-    printResultsFiles();
 }
 
 void COMAKTool::setStateFromComakParameters(SimTK::State& state, const SimTK::Vector& parameters) {
-    //Set Muscle Activations to Optimized
-    int j = 0;
-    for (int m = 0; m < _n_muscles; ++m) {
-        Muscle &msl = _model.updComponent<Muscle>(_muscle_path[m]);
-        msl.overrideActuation(state, true);
-        double force = _optimal_force[j] * parameters[j];
-        msl.setOverrideActuation(state,force);
-        j++;
-    }
-    //Set Reserve Activations to Optimized
-    for (int m = 0; m < _n_non_muscle_actuators; ++m) {
-        ScalarActuator &actuator = _model.updComponent<ScalarActuator>(_non_muscle_actuator_path[m]);
-        actuator.overrideActuation(state, true);
-        double force = _optimal_force[j] * parameters[j];
-        actuator.setOverrideActuation(state,force);
-        j++;
-    }
+    setActuatorsFromComakParameters(state, parameters);
     _model.realizeAcceleration(state);
 
     //Set Secondary Kinematics to Optimized
     for (int m = 0; m < _n_secondary_coord; ++m) {
-        Coordinate& coord = _model.updComponent<Coordinate>(_secondary_coord_path[m]);
+        const Coordinate& coord = *_parameter_secondary_coords[m];
 
         double value = parameters(_n_actuators + m);
         coord.setValue(state, value, false);
@@ -891,6 +1369,43 @@ void COMAKTool::setStateFromComakParameters(SimTK::State& state, const SimTK::Ve
     _model.assemble(state);
  }
 
+void COMAKTool::initializeParameterComponents() {
+    //Look up the parameter components once for the frame loop
+    _parameter_actuators.clear();
+    _parameter_secondary_coords.clear();
+    for (int m = 0; m < _n_muscles; ++m) {
+        _parameter_actuators.push_back(
+            &_model.getComponent<ScalarActuator>(_muscle_path[m]));
+    }
+    for (int m = 0; m < _n_non_muscle_actuators; ++m) {
+        _parameter_actuators.push_back(
+            &_model.getComponent<ScalarActuator>(_non_muscle_actuator_path[m]));
+    }
+    for (int m = 0; m < _n_secondary_coord; ++m) {
+        _parameter_secondary_coords.push_back(
+            &_model.getComponent<Coordinate>(_secondary_coord_path[m]));
+    }
+}
+
+void COMAKTool::setActuatorsFromComakParameters(SimTK::State& state, const SimTK::Vector& parameters) {
+    //Set Muscle and Reserve Activations to Optimized
+    for (int j = 0; j < _n_actuators; ++j) {
+        const ScalarActuator& actuator = *_parameter_actuators[j];
+        actuator.overrideActuation(state, true);
+        double force = _optimal_force[j] * parameters[j];
+        actuator.setOverrideActuation(state,force);
+    }
+}
+
+void COMAKTool::setUseCoarseContactMeshes(SimTK::State& state, bool use_coarse) {
+    for (const Smith2018ArticularContactForce& cnt_force :
+        _model.getComponentList<Smith2018ArticularContactForce>()) {
+        if (cnt_force.getModelingOption(state, "use_coarse_mesh") != use_coarse) {
+            cnt_force.setModelingOption(state, "use_coarse_mesh", use_coarse);
+        }
+    }
+}
+
 void COMAKTool::initializeResultsStorage() {
 
     std::vector<std::string> actuator_names;
@@ -958,9 +1473,21 @@ void COMAKTool::recordResultsStorage(const SimTK::State& state, int frame) {
     _result_kinematics.appendRow(_time[frame], kinematics);
     _result_values.appendRow(_time[frame], values);
 
+    if (!_result_streams.empty()) {
+        _result_streams[0]->appendRow(_time[frame], 
+            ~_model.getStateVariableValues(state));
+        _result_streams[1]->appendRow(_time[frame], activations);
+        _result_streams[2]->appendRow(_time[frame], forces);
+        _result_streams[3]->appendRow(_time[frame], 
+            kinematics.elementwiseMultiply(_kinematics_stream_scale));
+        _result_streams[4]->appendRow(_time[frame], 
+            values.elementwiseMultiply(_values_stream_scale));
+    }
 }
 
 void COMAKTool::printResultsFiles() {
+    double start = SimTK::realTime();
+
     int makeDir_out = IO::makeDir(get_results_directory());
     if (errno == ENOENT && makeDir_out == -1) {
         OPENSIM_THROW(Exception, "Could not create " +
@@ -968,6 +1495,21 @@ void COMAKTool::printResultsFiles() {
             "Possible reason: This tool cannot make new folder with subfolder.");
     }
 
+    //The streamed files already hold every frame
+    if (!_result_streams.empty()) {
+        for (auto& stream : _result_streams) {
+            stream->close();
+        }
+        _result_streams.clear();
+
+        _output_time = SimTK::realTime() - start;
+
+        if (get_print_telemetry()) {
+            printTelemetryFile();
+        }
+        return;
+    }
+
     STOFileAdapter sto;
     TimeSeriesTable states_table = _result_states.exportToTable(_model);
     states_table.addTableMetaData("header", std::string("COMAK Model States"));
@@ -1002,6 +1544,428 @@ void COMAKTool::printResultsFiles() {
     _result_values.addTableMetaData("nColumns", std::to_string(_result_values.getNumColumns() + 1));
 
     sto.write(_result_values, get_results_directory() + "/" + get_results_prefix() + "_values.sto");
+
+    _output_time = SimTK::realTime() - start;
+
+    if (get_print_telemetry()) {
+        printTelemetryFile();
+    }
+}
+
+void COMAKTool::readInitialGuessFile()
+{
+    std::string activation_file = get_initial_guess_file();
+    std::string suffix = "_activation.sto";
+
+    OPENSIM_THROW_IF(activation_file.size() < suffix.size() ||
+        activation_file.compare(activation_file.size() - suffix.size(),
+            suffix.size(), suffix) != 0, Exception,
+        "initial_guess_file: " + activation_file + " is not a COMAK "
+        "<results_prefix>_activation.sto results file.");
+
+    std::string kinematics_file = activation_file.substr(0,
+        activation_file.size() - suffix.size()) + "_kinematics.sto";
+
+    std::cout << "Reading initial guess: " << activation_file << " and "
+        << kinematics_file << std::endl;
+
+    TimeSeriesTable activations(activation_file);
+    TimeSeriesTable kinematics(kinematics_file);
+
+    //COMAK results kinematics are printed in degrees
+    _model.getSimbodyEngine().convertDegreesToRadians(kinematics);
+
+    //Interpolate a column to the frame times, holding the end values
+    auto interpolate = [&](const TimeSeriesTable& table,
+        const std::string& label, SimTK::Matrix& guess, int col)
+    {
+        const std::vector<double>& times = table.getIndependentColumn();
+        SimTK::Vector values = table.getDependentColumn(label);
+
+        PiecewiseLinearFunction func(static_cast<int>(times.size()),
+            &times[0], &values[0]);
+
+        for (int i = 0; i < _n_frames; ++i) {
+            double t = std::min(std::max(_time[i], times.front()), times.back());
+            guess(i, col) = func.calcValue(SimTK::Vector(1, t));
+        }
+    };
+
+    //Actuators missing from the initial guess are marked NaN and keep the
+    //default initialization
+    _initial_guess.resize(_n_frames, _n_parameters);
+    _initial_guess = SimTK::NaN;
+    _initial_guess_speed.resize(_n_frames, _n_secondary_coord);
+
+    for (int m = 0; m < _n_actuators; ++m) {
+        std::string path = m < _n_muscles ? _muscle_path[m] :
+            _non_muscle_actuator_path[m - _n_muscles];
+
+        if (activations.hasColumn(path)) {
+            interpolate(activations, path, _initial_guess, m);
+        }
+        else {
+            std::cout << "WARNING: Actuator (" << path << ") not found in "
+                "initial_guess_file." << std::endl;
+        }
+    }
+
+    for (int m = 0; m < _n_secondary_coord; ++m) {
+        std::string path = _secondary_coord_path[m];
+
+        OPENSIM_THROW_IF(!kinematics.hasColumn(path + "/value") ||
+            !kinematics.hasColumn(path + "/speed"), Exception,
+            "Secondary coordinate " + path + " not found in " +
+            kinematics_file);
+
+        interpolate(kinematics, path + "/value", _initial_guess, 
+            _n_actuators + m);
+        interpolate(kinematics, path + "/speed", _initial_guess_speed, m);
+    }
+}
+
+void COMAKTool::printTelemetryFile() {
+    std::string file = get_results_directory() + "/" + get_results_prefix() + "_telemetry.txt";
+    std::ofstream out(file);
+    if (!out) {
+        std::cout << "Could not write telemetry file: " << file << std::endl;
+        return;
+    }
+
+    out << "COMAK Telemetry" << std::endl;
+    out << "settle_time=" << _settle_time << std::endl;
+    out << "prepare_time=" << _prepare_time << std::endl;
+    out << "solve_time=" << _solve_time << std::endl;
+    out << "output_time=" << _output_time << std::endl;
+    out << "endheader" << std::endl;
+
+    out << "frame\ttime\titeration\tcoarse\tupdate_time\tunit_udot_time\t"
+        "qp_setup_time\tqp_solve_time\tqp_iterations\tipopt_time\t"
+        "ipopt_wait_time\tgradient_evaluations\tipopt_retries\t"
+        "set_state_time\trealize_time\trecord_time" << std::endl;
+
+    IterationTelemetry total;
+    for (const IterationTelemetry& t : _telemetry) {
+        out << t.frame << "\t" << _time[t.frame] << "\t" << t.iteration 
+            << "\t" << t.coarse << "\t" << t.update_time 
+            << "\t" << t.unit_udot_time << "\t" << t.qp_setup_time 
+            << "\t" << t.qp_solve_time << "\t" << t.qp_iterations 
+            << "\t" << t.ipopt_time << "\t" << t.ipopt_wait_time 
+            << "\t" << t.gradient_evaluations << "\t" << t.ipopt_retries << "\t" << t.set_state_time 
+            << "\t" << t.realize_time << "\t" << t.record_time << std::endl;
+
+        total.update_time += t.update_time;
+        total.unit_udot_time += t.unit_udot_time;
+        total.qp_setup_time += t.qp_setup_time;
+        total.qp_solve_time += t.qp_solve_time;
+        total.ipopt_time += t.ipopt_time;
+        total.ipopt_wait_time += t.ipopt_wait_time;
+        total.gradient_evaluations += t.gradient_evaluations;
+        total.ipopt_retries += t.ipopt_retries;
+        total.set_state_time += t.set_state_time;
+        total.realize_time += t.realize_time;
+        total.record_time += t.record_time;
+    }
+
+    std::cout << "\nCOMAK Telemetry [s]:" << std::endl;
+    std::cout << "--------------------" << std::endl;
+    std::cout << std::setw(25) << "Settle" << std::setw(15) << _settle_time << std::endl;
+    std::cout << std::setw(25) << "Model setup" << std::setw(15) << _prepare_time << std::endl;
+    std::cout << std::setw(25) << "Solve" << std::setw(15) << _solve_time << std::endl;
+    std::cout << std::setw(25) << "  Unit udot" << std::setw(15) << total.unit_udot_time << std::endl;
+    std::cout << std::setw(25) << "  Target update (other)" << std::setw(15) << total.update_time - total.unit_udot_time << std::endl;
+    std::cout << std::setw(25) << "  QP setup" << std::setw(15) << total.qp_setup_time << std::endl;
+    std::cout << std::setw(25) << "  QP solve" << std::setw(15) << total.qp_solve_time << std::endl;
+    std::cout << std::setw(25) << "  IPOPT" << std::setw(15) << total.ipopt_time 
+        << " (" << total.gradient_evaluations << " gradient evaluations, " 
+        << total.ipopt_retries << " retries)" << std::endl;
+    std::cout << std::setw(25) << "  IPOPT wait" << std::setw(15) << total.ipopt_wait_time << std::endl;
+    std::cout << std::setw(25) << "  Set state" << std::setw(15) << total.set_state_time << std::endl;
+    std::cout << std::setw(25) << "  Realize acceleration" << std::setw(15) << total.realize_time << std::endl;
+    std::cout << std::setw(25) << "  Record results" << std::setw(15) << total.record_time << std::endl;
+    std::cout << std::setw(25) << "Output" << std::setw(15) << _output_time << std::endl;
+    std::cout << "Telemetry printed to: " << file << std::endl;
+}
+
+std::string COMAKTool::getResultsFile(const std::string& suffix)
+{
+    return get_results_directory() + "/" + get_results_prefix() + suffix;
+}
+
+void COMAKTool::openResultsStreams()
+{
+    int makeDir_out = IO::makeDir(get_results_directory());
+    if (errno == ENOENT && makeDir_out == -1) {
+        OPENSIM_THROW(Exception, "Could not create " +
+            get_results_directory() +
+            "Possible reason: This tool cannot make new folder with subfolder.");
+    }
+
+    //Scale factors from the stored radians to the degrees written in the
+    //kinematics and values files, the same conversion as printResultsFiles
+    TimeSeriesTable kinematics_scale;
+    kinematics_scale.setColumnLabels(_result_kinematics.getColumnLabels());
+    kinematics_scale.appendRow(0.0, SimTK::RowVector(
+        static_cast<int>(_result_kinematics.getNumColumns()), 1.0));
+    kinematics_scale.addTableMetaData("inDegrees", std::string("no"));
+    _model.getSimbodyEngine().convertRadiansToDegrees(kinematics_scale);
+    _kinematics_stream_scale = kinematics_scale.getRowAtIndex(0);
+
+    TimeSeriesTable values_scale;
+    values_scale.setColumnLabels(_result_values.getColumnLabels());
+    values_scale.appendRow(0.0, SimTK::RowVector(
+        static_cast<int>(_result_values.getNumColumns()), 1.0));
+    values_scale.addTableMetaData("inDegrees", std::string("no"));
+    _model.getSimbodyEngine().convertRadiansToDegrees(values_scale);
+    _values_stream_scale = values_scale.getRowAtIndex(0);
+
+    Array<std::string> state_names = _model.getStateVariableNames();
+    std::vector<std::string> state_labels;
+    for (int i = 0; i < state_names.getSize(); ++i) {
+        state_labels.push_back(state_names[i]);
+    }
+
+    int flush_interval = get_stream_flush_interval();
+
+    _result_streams.clear();
+    for (int i = 0; i < 5; ++i) {
+        _result_streams.emplace_back(new STOFileStream());
+    }
+    _result_streams[0]->open(getResultsFile("_states.sto"),
+        "COMAK Model States", state_labels, false, flush_interval);
+    _result_streams[1]->open(getResultsFile("_activation.sto"),
+        "COMAK Actuator Activations", _result_activations.getColumnLabels(),
+        false, flush_interval);
+    _result_streams[2]->open(getResultsFile("_force.sto"),
+        "COMAK Actuator Forces", _result_forces.getColumnLabels(),
+        false, flush_interval);
+    _result_streams[3]->open(getResultsFile("_kinematics.sto"),
+        "COMAK Model Kinematics", _result_kinematics.getColumnLabels(),
+        true, flush_interval);
+    _result_streams[4]->open(getResultsFile("_values.sto"),
+        "COMAK Model Values", _result_values.getColumnLabels(),
+        true, flush_interval);
+}
+
+int COMAKTool::restoreStreamedResults(SimTK::State& state)
+{
+    std::string states_file = getResultsFile("_states.sto");
+    std::string activation_file = getResultsFile("_activation.sto");
+
+    std::vector<std::string> state_labels, activation_labels;
+    std::vector<double> state_times, activation_times;
+    std::vector<SimTK::RowVector> state_rows, activation_rows;
+
+    if (!STOFileStream::readRows(states_file, state_labels, state_times, state_rows) ||
+        !STOFileStream::readRows(activation_file, activation_labels, 
+            activation_times, activation_rows)) {
+        std::cout << "COMAK results files not found: " << states_file << ", "
+            << activation_file << "\nStarting from the first frame." 
+            << std::endl;
+
+        if (get_stream_results()) {
+            openResultsStreams();
+        }
+        return -1;
+    }
+
+    Array<std::string> state_names = _model.getStateVariableNames();
+    bool labels_match = 
+        static_cast<int>(state_labels.size()) == state_names.getSize() &&
+        activation_labels == _result_activations.getColumnLabels();
+    for (int i = 0; i < state_names.getSize() && labels_match; ++i) {
+        labels_match = state_labels[i] == state_names[i];
+    }
+
+    OPENSIM_THROW_IF(!labels_match, Exception, "COMAK results files: " + 
+        states_file + ", " + activation_file + " do not match the model "
+        "and COMAK actuators.");
+
+    int n_restored = static_cast<int>(
+        std::min(state_rows.size(), activation_rows.size()));
+    n_restored = std::min(n_restored, _n_out_frames);
+
+    for (int j = 0; j < n_restored; ++j) {
+        int frame = _start_frame + j;
+        OPENSIM_THROW_IF(
+            std::abs(_time[frame] - state_times[j]) > 1e-8 ||
+            std::abs(_time[frame] - activation_times[j]) > 1e-8,
+            Exception, "COMAK results files: " + states_file + " frame at "
+            "time " + std::to_string(state_times[j]) + " does not match the "
+            "input kinematics.");
+    }
+
+    //Rewrite the restored frames, the solved frames are appended after them
+    if (get_stream_results()) {
+        openResultsStreams();
+    }
+
+    //Replay the restored frames to rebuild the results
+    int last_frame = -1;
+    for (int j = 0; j < n_restored; ++j) {
+        int frame = _start_frame + j;
+
+        state.setTime(_time[frame]);
+        _model.setStateVariableValues(state, SimTK::Vector(~state_rows[j]));
+
+        for (int m = 0; m < _n_actuators; ++m) {
+            _optim_parameters(m) = activation_rows[j](m);
+        }
+        for (int m = 0; m < _n_secondary_coord; ++m) {
+            const Coordinate& coord = 
+                _model.getComponent<Coordinate>(_secondary_coord_path[m]);
+            _optim_parameters(_n_actuators + m) = coord.getValue(state);
+        }
+
+        setActuatorsFromComakParameters(state, _optim_parameters);
+        _model.realizeAcceleration(state);
+
+        recordResultsStorage(state, frame);
+        last_frame = frame;
+    }
+
+    if (last_frame == -1) {
+        std::cout << "COMAK results files: " << states_file << " has no "
+            "frames.\nStarting from the first frame." << std::endl;
+        return -1;
+    }
+
+    _prev_parameters = _optim_parameters;
+    _consecutive_bad_frame = 1;
+
+    for (int m = 0; m < _n_secondary_coord; ++m) {
+        const Coordinate& coord = 
+            _model.getComponent<Coordinate>(_secondary_coord_path[m]);
+        _prev_secondary_value(m) = coord.getValue(state);
+    }
+
+    std::cout << "Restarting COMAK from results files: " << states_file 
+        << std::endl;
+    std::cout << n_restored << " frames restored, last time: " 
+        << _time[last_frame] << std::endl;
+
+    return last_frame;
+}
+
+std::string COMAKTool::computeSettleCacheFile()
+{
+    std::uint64_t hash = FNV_OFFSET_BASIS;
+
+    //Serialized model, this includes the force_set_file forces after they 
+    //were appended to (or replaced) the model ForceSet
+    XMLDocument model_doc;
+    SimTK::Xml::Element model_root = model_doc.getRootElement();
+    _model.updateXMLNode(model_root);
+
+    SimTK::String model_xml;
+    model_doc.writeToString(model_xml);
+    hash_string(hash, model_xml);
+
+    //Contact mesh geometry, thickness and material properties read from 
+    //the mesh files the model references
+    for (const Smith2018ContactMesh& mesh : 
+        _model.getComponentList<Smith2018ContactMesh>()) {
+        hash_string(hash, mesh.getAbsolutePathString());
+
+        const SimTK::Vector_<SimTK::Vec3>& centers = 
+            mesh.getTriangleCenters();
+        for (int i = 0; i < centers.size(); ++i) {
+            for (int j = 0; j < 3; ++j) {
+                hash_double(hash, centers(i)[j]);
+            }
+            hash_double(hash, mesh.getTriangleThickness(i));
+            hash_double(hash, mesh.getTriangleElasticModulus(i));
+            hash_double(hash, mesh.getTrianglePoissonsRatio(i));
+        }
+    }
+
+    //Starting pose
+    for (int j = 0; j < _q_matrix.ncol(); ++j) {
+        hash_double(hash, _q_matrix(_start_frame, j));
+        hash_double(hash, _u_matrix(_start_frame, j));
+    }
+
+    //Coordinate types
+    for (int i = 0; i < _n_prescribed_coord; ++i) {
+        hash_string(hash, _prescribed_coord_path[i]);
+    }
+    hash_string(hash, "primary");
+    for (int i = 0; i < _n_primary_coord; ++i) {
+        hash_string(hash, _primary_coord_path[i]);
+    }
+    hash_string(hash, "secondary");
+    for (int i = 0; i < _n_secondary_coord; ++i) {
+        hash_string(hash, _secondary_coord_path[i]);
+    }
+
+    //Settle properties
+    hash_string(hash, get_settle_method());
+    hash_double(hash, get_settle_threshold());
+    hash_double(hash, get_settle_accuracy());
+    hash_double(hash, get_settle_internal_step_limit());
+    hash_double(hash, get_settle_max_iterations());
+
+    std::string directory = get_settle_cache_directory();
+    if (directory.empty()) {
+        directory = get_results_directory();
+    }
+
+    std::stringstream file;
+    file << directory << "/comak_settle_" << std::hex << std::setw(16) 
+        << std::setfill('0') << hash << ".txt";
+    return file.str();
+}
+
+bool COMAKTool::readSettleCache(const std::string& file, SimTK::Vector& values)
+{
+    std::ifstream in(file);
+    if (!in) {
+        return false;
+    }
+
+    SimTK::Vector cached(_n_secondary_coord);
+    for (int i = 0; i < _n_secondary_coord; ++i) {
+        std::string path;
+        if (!(in >> path >> cached[i]) || path != _secondary_coord_path[i]) {
+            return false;
+        }
+    }
+    values = cached;
+    return true;
+}
+
+void COMAKTool::writeSettleCache(const std::string& file, const SimTK::Vector& values)
+{
+    IO::makeDir(IO::getParentDirectory(file));
+
+    //Trials run in parallel (COMAKBatchTool) can share a cache file, write
+    //to a file unique to this thread and rename it so a reader never sees
+    //a partially written file
+    std::stringstream tmp_file;
+    tmp_file << file << "." << std::this_thread::get_id() << ".tmp";
+
+    std::ofstream out(tmp_file.str());
+    if (!out) {
+        std::cout << "Could not write settle cache file: " << file << std::endl;
+        return;
+    }
+
+    out << std::setprecision(17);
+    for (int i = 0; i < _n_secondary_coord; ++i) {
+        out << _secondary_coord_path[i] << " " << values[i] << std::endl;
+    }
+    out.close();
+
+    if (std::rename(tmp_file.str().c_str(), file.c_str()) != 0) {
+        //The rename does not replace an existing file on Windows, another
+        //trial with the same key has written the same values
+        std::remove(tmp_file.str().c_str());
+        std::ifstream existing(file);
+        if (!existing) {
+            std::cout << "Could not write settle cache file: " << file 
+                << std::endl;
+        }
+    }
 }
 
 SimTK::Vector COMAKTool::equilibriateSecondaryCoordinates() 
@@ -1082,6 +2046,34 @@ SimTK::Vector COMAKTool::equilibriateSecondaryCoordinates()
         prev_sec_coord_value(k) = coord.getValue(state);
     }
 
+    // Solve for static equilibrium
+    bool settled = false;
+    if (get_settle_method() == "static_equilibrium") {
+        ComakStaticEquilibriumSolver solver(settle_model, _secondary_coord_path);
+        solver.setTolerance(get_settle_threshold());
+        solver.setResidualTolerance(get_udot_tolerance());
+        solver.setMaxIterations(get_settle_max_iterations());
+        solver.setVerbose(get_verbose());
+
+        settled = solver.solve(state);
+        result_states.append(state);
+
+        if (settled) {
+            std::cout << "Static equilibrium found in " 
+                << solver.getNumIterations() << " iterations." << std::endl;
+        }
+        else {
+            std::cout << "Static equilibrium not found in " 
+                << solver.getNumIterations() << " iterations, "
+                << "performing forward simulation." << std::endl;
+
+            for (int k = 0; k < _n_secondary_coord; k++) {
+                Coordinate& coord = settle_model.updComponent<Coordinate>(_secondary_coord_path[k]);
+                prev_sec_coord_value(k) = coord.getValue(state);
+            }
+        }
+    }
+
     // Perform settling simulation
     SimTK::CPodesIntegrator integrator(settle_model.getSystem(),
         SimTK::CPodes::BDF, SimTK::CPodes::Newton);
@@ -1089,11 +2081,13 @@ SimTK::Vector COMAKTool::equilibriateSecondaryCoordinates()
     integrator.setAccuracy(get_settle_accuracy());
     integrator.setInternalStepLimit(get_settle_internal_step_limit());
     SimTK::TimeStepper timestepper(settle_model.getSystem(), integrator);
-    timestepper.initialize(state);
+    if (!settled) {
+        timestepper.initialize(state);
+    }
     
     double dt = 0.01;
 
-    double max_coord_delta = SimTK::Infinity;
+    double max_coord_delta = settled ? 0.0 : SimTK::Infinity;
     int i = 1;
     while (max_coord_delta > get_settle_threshold()){
         timestepper.stepTo(i*dt);
@@ -23,12 +23,15 @@
 #include <OpenSim/Simulation/Model/ForceSet.h>
 #include <OpenSim/Simulation/Model/AnalysisSet.h>
 #include <OpenSim/Simulation/StatesTrajectory.h>
+#include "STOFileStream.h"
+#include <functional>
 
 namespace OpenSim { 
 class COMAKSecondaryCoordinate;
 class COMAKSecondaryCoordinateSet;
 class COMAKCostFunctionParameter;
 class COMAKCostFunctionParameterSet;
+class COMAKBatchTool;
 
  
 //=============================================================================
@@ -67,6 +70,10 @@ forward dynamic simulation, the Secondary Coordinate are allowed to settle into
 equilibrium based on the passive muscle, ligament, and articular contact forces. 
 This settling simulation is terminated when the largest change in the Secondary
 Coordinates between time steps is less than the settle_threshold. 
+Alternatively (settle_method = static_equilibrium), the equilibrium Secondary
+Coordinate values are solved for directly with a damped Newton 
+(Levenberg-Marquardt) iteration, falling back to the forward simulation if it 
+does not converge.
 
 ### References
 [1] 
@@ -92,6 +99,14 @@ public:
     OpenSim_DECLARE_PROPERTY(external_loads_file, std::string, "Path to .xml "
         "file that defines the ExternalLoads applied to the model.")
 
+    OpenSim_DECLARE_PROPERTY(initial_guess_file, std::string,
+        "Path to the <results_prefix>_activation.sto file of a previous COMAK "
+        "run. The activations, and the secondary coordinate values and "
+        "speeds from the <results_prefix>_kinematics.sto file next to it, "
+        "are interpolated to the frame times and used as the starting point "
+        "of each frame. The settling of the secondary coordinates at start "
+        "is skipped. If empty, no initial guess is used.")
+
     OpenSim_DECLARE_PROPERTY(results_directory, std::string, 
         "Path to folder where all results files will be written.")
 
@@ -155,6 +170,19 @@ public:
         "integrator initializing forward simulation. If -1, then there is no "
         "limit. The Default value is -1.")
 
+    OpenSim_DECLARE_PROPERTY(settle_method, std::string,
+        "Method used to settle the secondary coordinates. Options: "
+        "'forward_simulation', 'static_equilibrium'. 'static_equilibrium' "
+        "solves for the secondary coordinate values where their "
+        "accelerations vanish (Levenberg-Marquardt), the forward simulation "
+        "is used if it does not converge in settle_max_iterations or the "
+        "remaining secondary accelerations exceed udot_tolerance. "
+        "The default value is 'forward_simulation'.")
+
+    OpenSim_DECLARE_PROPERTY(settle_max_iterations, int,
+        "Maximum number of iterations of the static_equilibrium "
+        "settle_method. The default value is 50.")
+
     OpenSim_DECLARE_PROPERTY(print_settle_sim_results, bool, 
         "Print the model states during the forward simulation to a .sto file "
         "in the settle_sim_results_dir.")
@@ -166,6 +194,18 @@ public:
     OpenSim_DECLARE_PROPERTY(settle_sim_results_prefix, std::string, 
         "Prefix to settle simulation results file names.")
 
+    OpenSim_DECLARE_PROPERTY(use_settle_cache, bool,
+        "Save the settled secondary coordinate values to a file in the "
+        "settle_cache_directory, and reuse them when the model (including "
+        "the force_set_file forces and the contact mesh files), the "
+        "coordinate values and speeds at start_time, the prescribed, "
+        "primary and secondary coordinates and the settle properties match "
+        "a previous run. The default value is true.")
+
+    OpenSim_DECLARE_PROPERTY(settle_cache_directory, std::string,
+        "Directory for the settle cache files. If empty, the "
+        "results_directory is used. The default value is ''.")
+
     OpenSim_DECLARE_PROPERTY(max_iterations, int, 
         "Maximum number of COMAK iterations per time step allowed for the "
         "the simulated model accelerations to converge to the input observed "
@@ -190,6 +230,72 @@ public:
         "COMAK optimization to changes in the secondary coordinate values. "
         "The default value is 1e-8.")
 
+    OpenSim_DECLARE_PROPERTY(num_threads, int, 
+        "Number of threads used to compute the gradient of the acceleration "
+        "constraints (unit udots) in the COMAK optimization. Each additional "
+        "thread evaluates its own copy of the model. Set to 0 to use the "
+        "number of hardware threads. The default value is 1.")
+
+    OpenSim_DECLARE_PROPERTY(comak_solver, std::string,
+        "Solver used for the COMAK optimization. Options: 'ipopt', 'qp'. "
+        "'qp' solves the quadratic program (activation exponent of 2) with "
+        "a dedicated ADMM solver that is warm started from the previous "
+        "solution, IPOPT is used if it fails. The default value is 'ipopt'.")
+
+    OpenSim_DECLARE_PROPERTY(max_secondary_broyden_updates, int,
+        "Maximum number of consecutive COMAK iterations in which the "
+        "gradient of the acceleration constraints to the secondary "
+        "coordinates is updated with a Broyden (rank one) update instead of "
+        "perturbing each secondary coordinate. The secondary coordinates are "
+        "always perturbed at the first iteration of each frame and when the "
+        "max udot error did not decrease. The default value is 0 (disabled).")
+
+    OpenSim_DECLARE_PROPERTY(coarse_contact_iterations, int,
+        "Number of COMAK iterations at the start of each frame in which the "
+        "Smith2018ArticularContactForce components use their coarse contact "
+        "meshes (see coarse_mesh_face_ratio in Smith2018ContactMesh). The "
+        "last iteration and the recorded results always use the full "
+        "resolution meshes. The default value is 0 (disabled).")
+
+    OpenSim_DECLARE_PROPERTY(coarse_contact_udot_threshold, double,
+        "The coarse contact meshes are also used while the max udot error of "
+        "the previous iteration is larger than this value. Set to a negative "
+        "value to disable. The default value is -1.")
+
+    OpenSim_DECLARE_PROPERTY(num_windows, int,
+        "Number of time windows solved in parallel, each with its own copy "
+        "of the model. Each window after the first is started from a "
+        "settled pose (see settle_secondary_coordinates_at_start) "
+        "window_overlap_frames early and the overlap frames are discarded. "
+        "The num_threads unit udot threads are divided between the windows "
+        "(at least one each). "
+        "The default value is 1 (all frames are solved in sequence).")
+
+    OpenSim_DECLARE_PROPERTY(window_overlap_frames, int,
+        "Number of frames solved and discarded at the start of each window "
+        "after the first, so the secondary coordinates can converge from "
+        "the settled pose. The default value is 5.")
+
+    OpenSim_DECLARE_PROPERTY(stream_results, bool, "Write each solved "
+        "frame to the _states.sto, _activation.sto, _force.sto, "
+        "_kinematics.sto and _values.sto results files as soon as it is "
+        "recorded, instead of writing the files at the end of the run. The "
+        "frames up to the last flush are kept if the run is aborted, and "
+        "can be restored with restart_from_checkpoint. "
+        "The default value is false.")
+
+    OpenSim_DECLARE_PROPERTY(stream_flush_interval, int, "Number of frames "
+        "between flushes of the streamed results files to disk "
+        "(see stream_results). The default value is 10.")
+
+    OpenSim_DECLARE_PROPERTY(restart_from_checkpoint, bool,
+        "Restore the frames in the streamed _states.sto and _activation.sto "
+        "results files of a previous run (see stream_results) and continue "
+        "from the frame after the last one, warm started from its "
+        "solution. The bad frames of the restored part are not reported in "
+        "the convergence summary. Cannot be combined with num_windows > 1. "
+        "The default value is false.")
+
     OpenSim_DECLARE_UNNAMED_PROPERTY(COMAKCostFunctionParameterSet,
         "List of COMAKCostFunctionWeight objects.")
 
@@ -200,6 +306,16 @@ public:
     OpenSim_DECLARE_PROPERTY(verbose, int, 
         "Level of debug information reported (0: low, 1: medium, 2: high)")
 
+    OpenSim_DECLARE_PROPERTY(print_telemetry, bool,
+        "Print the wall time of each COMAK phase (settle, model setup, solve, "
+        "output) and, for each frame and iteration, of the unit udot "
+        "computation, optimizer setup and solve, state update, acceleration "
+        "realization and result recording, with the QP iteration and IPOPT "
+        "gradient evaluation counts, to a <results_prefix>_telemetry.txt "
+        "table. The IPOPT solve time excludes the wait for other threads "
+        "using IPOPT, which is reported separately. "
+        "The default value is false.")
+
     OpenSim_DECLARE_PROPERTY(use_visualizer, bool, 
         "Use SimTK visualizer to display simulations in progress. "
         "The default value is false.")
@@ -227,16 +343,37 @@ private:
     void applyExternalLoads();
     void printCOMAKascii();
     SimTK::Vector equilibriateSecondaryCoordinates();
+    std::string computeSettleCacheFile();
+    bool readSettleCache(const std::string& file, SimTK::Vector& values);
+    void writeSettleCache(const std::string& file, const SimTK::Vector& values);
+    std::string getResultsFile(const std::string& suffix);
+    void openResultsStreams();
+    int restoreStreamedResults(SimTK::State& state);
     void performCOMAK();
+    void performWindowedCOMAK();
+    SimTK::Vector computeInitialSecondaryValues();
+    void prepareCOMAKModel();
+    void solveCOMAK(const SimTK::Vector& init_secondary_values);
+    void printConvergenceSummary();
     void setStateFromComakParameters(SimTK::State& state, const SimTK::Vector& parameters);
+    void initializeParameterComponents();
+    void setActuatorsFromComakParameters(SimTK::State& state, const SimTK::Vector& parameters);
+    void setUseCoarseContactMeshes(SimTK::State& state, bool use_coarse);
     SimTK::Vector computeMuscleVolumes();
     void printOptimizationResultsToConsole(const SimTK::Vector& parameters);
     void initializeResultsStorage();
     void recordResultsStorage(const SimTK::State& state, int frame);
     void printResultsFiles();
+    void printTelemetryFile();
+    void readInitialGuessFile();
+    static void runInParallel(int n, const std::function<void(int)>& func);
+
+    friend class COMAKBatchTool;
 
 public:
     void run();
+
+    /** Use a copy of model instead of loading model_file in run(). */
     void setModel(Model& model);
 
 
@@ -245,6 +382,10 @@ public:
     //--------------------------------------------------------------------------
 public:
     Model _model;
+    //Model passed to setModel(), copied to _model in initialize() so 
+    //windows (and repeated runs) start from the model as it was set
+    SimTK::ResetOnCopy<std::unique_ptr<Model>> _set_model;
+    SimTK::ResetOnCopy<std::vector<std::unique_ptr<Model>>> _worker_models;
 
     int _n_prescribed_coord;
     int _n_primary_coord;
@@ -273,6 +414,14 @@ public:
     Array<std::string> _secondary_coord_path;
     Array<int> _secondary_coord_index;
 
+    //Per coordinate list index, set in initialize()
+    std::vector<bool> _coord_is_secondary;
+    std::vector<bool> _coord_is_constrained;
+
+    //Components of the optimization parameters, set in solveCOMAK()
+    std::vector<const ScalarActuator*> _parameter_actuators;
+    std::vector<const Coordinate*> _parameter_secondary_coords;
+
     int _n_frames;
     int _n_out_frames;
     int _start_frame;
@@ -284,9 +433,35 @@ public:
     std::vector<double> _bad_udot_errors;
     std::vector<std::string> _bad_udot_coord;
 
+    //Telemetry of each COMAK iteration, times in seconds
+    struct IterationTelemetry {
+        int frame = 0;
+        int iteration = 0;
+        bool coarse = false;
+        double update_time = 0.0;
+        double unit_udot_time = 0.0;
+        double qp_setup_time = 0.0;
+        double qp_solve_time = 0.0;
+        int qp_iterations = 0;
+        double ipopt_time = 0.0;
+        double ipopt_wait_time = 0.0;
+        int gradient_evaluations = 0;
+        int ipopt_retries = 0;
+        double set_state_time = 0.0;
+        double realize_time = 0.0;
+        double record_time = 0.0;
+    };
+    std::vector<IterationTelemetry> _telemetry;
+    double _settle_time;
+    double _prepare_time;
+    double _solve_time;
+    double _output_time;
+
     SimTK::Matrix _q_matrix;
     SimTK::Matrix _u_matrix;
     SimTK::Matrix _udot_matrix;
+    SimTK::Matrix _initial_guess;
+    SimTK::Matrix _initial_guess_speed;
     ExternalLoads _external_loads;
 
     SimTK::Vector _secondary_coord_damping;
@@ -306,6 +481,13 @@ public:
     TimeSeriesTable _result_forces;
     TimeSeriesTable _result_kinematics;
     TimeSeriesTable _result_values;
+
+    //Streamed results files (stream_results), in the order states, 
+    //activation, force, kinematics, values
+    SimTK::ResetOnCopy<std::vector<std::unique_ptr<STOFileStream>>> 
+        _result_streams;
+    SimTK::RowVector _kinematics_stream_scale;
+    SimTK::RowVector _values_stream_scale;
 //=============================================================================
 };  // END of class COMAK_TOOL
 
@@ -0,0 +1,736 @@
+/* -------------------------------------------------------------------------- *
+ *                     ContactMeshConvergenceTool.cpp                         *
+ * -------------------------------------------------------------------------- *
+ * Author(s): Colin Smith                                                     *
+ *                                                                            *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may    *
+ * not use this file except in compliance with the License. You may obtain a  *
+ * copy of the License at http://www.apache.org/licenses/LICENSE-2.0.         *
+ *                                                                            *
+ * Unless required by applicable law or agreed to in writing, software        *
+ * distributed under the License is distributed on an "AS IS" BASIS,          *
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.   *
+ * See the License for the specific language governing permissions and        *
+ * limitations under the License.                                             *
+ * -------------------------------------------------------------------------- */
+
+#include "ContactMeshConvergenceTool.h"
+#include "Smith2018ContactMesh.h"
+#include "HelperFunctions.h"
+#include <OpenSim/Common/Storage.h>
+#include <OpenSim/Common/IO.h>
+#include <chrono>
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <set>
+#include <tuple>
+
+using namespace OpenSim;
+
+ContactMeshConvergenceTool::ContactMeshConvergenceTool() : Object()
+{
+    setNull();
+    constructProperties();
+    _directoryOfSetupFile = "";
+}
+
+ContactMeshConvergenceTool::ContactMeshConvergenceTool(
+    std::string settings_file) : Object(settings_file) {
+    setNull();
+    constructProperties();
+    updateFromXMLDocument();
+
+    _directoryOfSetupFile = IO::getParentDirectory(settings_file);
+    IO::chDir(_directoryOfSetupFile);
+}
+
+void ContactMeshConvergenceTool::setNull()
+{
+    setAuthors("Colin Smith");
+    _n_frames = 0;
+}
+
+void ContactMeshConvergenceTool::constructProperties()
+{
+    Array<std::string> defaultListAll;
+    defaultListAll.append("all");
+
+    constructProperty_model_file("");
+    constructProperty_states_file("");
+    constructProperty_results_directory(".");
+    constructProperty_results_file_basename("");
+    constructProperty_start_time(-1);
+    constructProperty_stop_time(-1);
+    constructProperty_contacts(defaultListAll);
+    constructProperty_num_decimation_levels(2);
+    constructProperty_num_subdivision_levels(1);
+    constructProperty_decimation_factor(2.0);
+    constructProperty_force_tolerance(0.02);
+    constructProperty_center_of_pressure_tolerance(0.001);
+    constructProperty_max_pressure_tolerance(0.1);
+}
+
+void ContactMeshConvergenceTool::run()
+{
+    OPENSIM_THROW_IF(get_model_file().empty(), Exception,
+        "No model file was specified (<model_file> element is empty) in "
+        "the Setup file. ");
+
+    OPENSIM_THROW_IF(get_num_decimation_levels() < 0 ||
+        get_num_subdivision_levels() < 0, Exception,
+        "num_decimation_levels and num_subdivision_levels must be >= 0.")
+
+    OPENSIM_THROW_IF(get_num_decimation_levels() > 0 &&
+        get_decimation_factor() <= 1.0, Exception,
+        "decimation_factor must be greater than 1.")
+
+    //Make results directory
+    int makeDir_out = IO::makeDir(get_results_directory());
+    if (errno == ENOENT && makeDir_out == -1) {
+        OPENSIM_THROW(Exception, "Could not create " +
+            get_results_directory() +
+            "Possible reason: This tool cannot make new folder with subfolder.");
+    }
+    IO::makeDir(get_results_directory() + "/meshes");
+
+    //Load the original model
+    std::string saveWorkingDirectory = IO::getCwd();
+    IO::chDir(_directoryOfSetupFile);
+    Model model(get_model_file());
+    IO::chDir(saveWorkingDirectory);
+
+    model.initSystem();
+
+    findContacts(model);
+    readStatesFromFile(model);
+
+    _levels.clear();
+    for (int k = get_num_decimation_levels(); k > 0; --k) {
+        _levels.push_back(-k);
+    }
+    for (int k = 0; k <= get_num_subdivision_levels(); ++k) {
+        _levels.push_back(k);
+    }
+    int nLevels = static_cast<int>(_levels.size());
+
+    generateMeshes(model);
+
+    _level_mesh_num_faces.resize(nLevels);
+    _level_eval_time.resize(nLevels);
+    _contact_force.resize(nLevels);
+    _center_of_pressure.resize(nLevels);
+    _max_pressure.resize(nLevels);
+
+    for (int l = 0; l < nLevels; ++l) {
+        evaluateLevel(l);
+    }
+
+    computeErrors();
+    printResults();
+}
+
+void ContactMeshConvergenceTool::findContacts(const Model& model)
+{
+    _contact_force_paths.clear();
+    _contact_mesh_paths.clear();
+
+    if (getProperty_contacts().size() == 0 || get_contacts(0) == "none") {
+        OPENSIM_THROW(Exception, "ContactMeshConvergenceTool: no contacts "
+            "were specified.")
+    }
+    else if (get_contacts(0) == "all") {
+        for (const Smith2018ArticularContactForce& contactForce :
+            model.getComponentList<Smith2018ArticularContactForce>()) {
+
+            _contact_force_paths.push_back(
+                contactForce.getAbsolutePathString());
+        }
+    }
+    else {
+        for (int i = 0; i < getProperty_contacts().size(); ++i) {
+            const Smith2018ArticularContactForce& contactForce =
+                model.getComponent<Smith2018ArticularContactForce>(
+                    get_contacts(i));
+
+            _contact_force_paths.push_back(
+                contactForce.getAbsolutePathString());
+        }
+    }
+
+    OPENSIM_THROW_IF(_contact_force_paths.empty(), Exception,
+        "ContactMeshConvergenceTool: model does not contain any "
+        "Smith2018ArticularContactForces.")
+
+    //Collect the unique meshes connected to the contact forces
+    for (const std::string& path : _contact_force_paths) {
+        const Smith2018ArticularContactForce& contactForce =
+            model.getComponent<Smith2018ArticularContactForce>(path);
+
+        for (const char* socket : { "casting_mesh", "target_mesh" }) {
+            std::string mesh_path = contactForce.
+                getConnectee<Smith2018ContactMesh>(socket).
+                getAbsolutePathString();
+
+            if (!contains_string(_contact_mesh_paths, mesh_path)) {
+                _contact_mesh_paths.push_back(mesh_path);
+            }
+        }
+    }
+}
+
+void ContactMeshConvergenceTool::readStatesFromFile(const Model& model)
+{
+    std::string saveWorkingDirectory = IO::getCwd();
+    IO::chDir(_directoryOfSetupFile);
+    Storage store = Storage(get_states_file());
+    IO::chDir(saveWorkingDirectory);
+
+    //Set Start and Stop Times
+    store.getTimeColumn(_time);
+
+    if (get_start_time() == -1) {
+        set_start_time(_time.get(0));
+    }
+    if (get_stop_time() == -1) {
+        set_stop_time(_time.getLast());
+    }
+
+    if (store.isInDegrees()) {
+        model.getSimbodyEngine().convertDegreesToRadians(store);
+    }
+
+    //Cut to start and stop times
+    store.crop(get_start_time(), get_stop_time());
+
+    store.getTimeColumn(_time);
+    _n_frames = _time.size();
+
+    //Gather Q values
+    Array<std::string> col_labels = store.getColumnLabels();
+
+    _coord_paths.clear();
+    for (const Coordinate& coord : model.getComponentList<Coordinate>()) {
+        _coord_paths.push_back(coord.getAbsolutePathString());
+    }
+    int nCoord = static_cast<int>(_coord_paths.size());
+
+    Array<int> q_col_map(-1, nCoord);
+
+    for (int i = 0; i < col_labels.size(); ++i) {
+        std::vector<std::string> split_label = split_string(col_labels[i], "/");
+
+        int j = 0;
+        for (const Coordinate& coord : model.getComponentList<Coordinate>()) {
+            if (contains_string(split_label, coord.getName())) {
+                if (split_label.back() == "value" ||
+                    split_label.back() == coord.getName()) {
+                    q_col_map[j] = i;
+                }
+            }
+            j++;
+        }
+    }
+
+    _q_matrix.resize(_n_frames, nCoord);
+
+    int j = 0;
+    for (const Coordinate& coord : model.getComponentList<Coordinate>()) {
+        if (q_col_map[j] != -1) {
+            double* data = NULL;
+            store.getDataColumn(col_labels[q_col_map[j]], data);
+            for (int i = 0; i < _n_frames; ++i) {
+                _q_matrix(i, j) = data[i];
+            }
+        }
+        else {
+            std::cout << "Coordinate Value: " << coord.getName() <<
+                " not found in states_file, set to default value." <<
+                std::endl;
+
+            for (int i = 0; i < _n_frames; ++i) {
+                _q_matrix(i, j) = coord.getDefaultValue();
+            }
+        }
+        j++;
+    }
+}
+
+std::string ContactMeshConvergenceTool::getLevelName(int level) const
+{
+    if (level < 0) {
+        return "decimated_" + std::to_string(-level);
+    }
+    else if (level > 0) {
+        return "subdivided_" + std::to_string(level);
+    }
+    return "original";
+}
+
+void ContactMeshConvergenceTool::generateMeshes(const Model& model)
+{
+    int nLevels = static_cast<int>(_levels.size());
+    int nMeshes = static_cast<int>(_contact_mesh_paths.size());
+
+    //Use absolute paths so the meshes are found relative to any model
+    std::string mesh_dir = SimTK::Pathname::getAbsoluteDirectoryPathname(
+        get_results_directory() + "/meshes");
+
+    _level_mesh_files.assign(nLevels, std::vector<std::string>(nMeshes));
+
+    for (int m = 0; m < nMeshes; ++m) {
+        const Smith2018ContactMesh& cnt_mesh =
+            model.getComponent<Smith2018ContactMesh>(_contact_mesh_paths[m]);
+
+        //The loaded mesh is scaled by scale_factors, write the variants in
+        //the unscaled mesh_file coordinates so the scale_factors (and the
+        //mesh_back_file) remain valid.
+        const SimTK::PolygonalMesh& scaled_mesh = cnt_mesh.getPolygonalMesh();
+        SimTK::Vec3 scale = cnt_mesh.get_scale_factors();
+
+        SimTK::PolygonalMesh mesh;
+        for (int v = 0; v < scaled_mesh.getNumVertices(); ++v) {
+            SimTK::Vec3 pos = scaled_mesh.getVertexPosition(v);
+            mesh.addVertex(SimTK::Vec3(
+                pos(0) / scale(0), pos(1) / scale(1), pos(2) / scale(2)));
+        }
+        for (int f = 0; f < scaled_mesh.getNumFaces(); ++f) {
+            SimTK::Array_<int> face;
+            for (int k = 0; k < scaled_mesh.getNumVerticesForFace(f); ++k) {
+                face.push_back(scaled_mesh.getFaceVertex(f, k));
+            }
+            mesh.addFace(face);
+        }
+
+        double edge_length = computeMeanEdgeLength(mesh);
+
+        for (int l = 0; l < nLevels; ++l) {
+            int level = _levels[l];
+
+            if (level == 0) {
+                _level_mesh_files[l][m] = cnt_mesh.get_mesh_file();
+                continue;
+            }
+
+            SimTK::PolygonalMesh variant;
+            if (level < 0) {
+                //Triangle count scales with 1/cell_size^2
+                double cell_size = edge_length *
+                    std::pow(std::sqrt(get_decimation_factor()), -level);
+
+                decimateMesh(mesh, cell_size, variant);
+            }
+            else {
+                SimTK::PolygonalMesh coarse = mesh;
+                for (int k = 0; k < level; ++k) {
+                    SimTK::PolygonalMesh refined;
+                    subdivideMesh(coarse, refined);
+                    coarse = refined;
+                }
+                variant = coarse;
+            }
+
+            std::string file = mesh_dir + cnt_mesh.getName() + "_" +
+                getLevelName(level) + ".obj";
+
+            writeMeshFile(variant, file);
+            _level_mesh_files[l][m] = file;
+
+            std::cout << "Generated mesh: " << file << " (" <<
+                variant.getNumFaces() << " triangles)" << std::endl;
+        }
+    }
+}
+
+void ContactMeshConvergenceTool::evaluateLevel(int l)
+{
+    int level = _levels[l];
+    int nMeshes = static_cast<int>(_contact_mesh_paths.size());
+    int nContacts = static_cast<int>(_contact_force_paths.size());
+
+    std::cout << std::endl;
+    std::cout << "Evaluating mesh level: " << getLevelName(level) << std::endl;
+
+    //Load a fresh copy of the model so the meshes are reinitialized
+    std::string saveWorkingDirectory = IO::getCwd();
+    IO::chDir(_directoryOfSetupFile);
+    Model model(get_model_file());
+    IO::chDir(saveWorkingDirectory);
+
+    if (level != 0) {
+        for (int m = 0; m < nMeshes; ++m) {
+            Smith2018ContactMesh& cnt_mesh =
+                model.updComponent<Smith2018ContactMesh>(
+                    _contact_mesh_paths[m]);
+
+            cnt_mesh.set_mesh_file(_level_mesh_files[l][m]);
+
+            //Region labels do not apply to the modified triangulation
+            if (!cnt_mesh.getProperty_region_labels_file().empty()) {
+                cnt_mesh.set_region_labels_file("");
+            }
+            if (!cnt_mesh.getProperty_region_labels_array().empty()) {
+                cnt_mesh.set_region_labels_array("");
+            }
+        }
+    }
+
+    SimTK::State state = model.initSystem();
+
+    _level_mesh_num_faces[l].resize(nMeshes);
+    for (int m = 0; m < nMeshes; ++m) {
+        _level_mesh_num_faces[l][m] = model.getComponent
+            <Smith2018ContactMesh>(_contact_mesh_paths[m]).getNumFaces();
+    }
+
+    _contact_force[l].assign(nContacts, SimTK::Vector_<SimTK::Vec3>(
+        _n_frames, SimTK::Vec3(0.0)));
+    _center_of_pressure[l].assign(nContacts, SimTK::Vector_<SimTK::Vec3>(
+        _n_frames, SimTK::Vec3(0.0)));
+    _max_pressure[l].assign(nContacts, SimTK::Vector(_n_frames, 0.0));
+
+    std::vector<const Smith2018ArticularContactForce*> contact_forces;
+    for (const std::string& path : _contact_force_paths) {
+        contact_forces.push_back(
+            &model.getComponent<Smith2018ArticularContactForce>(path));
+    }
+
+    std::vector<const Coordinate*> coords;
+    for (const std::string& path : _coord_paths) {
+        coords.push_back(&model.getComponent<Coordinate>(path));
+    }
+
+    double eval_time = 0.0;
+
+    for (int i = 0; i < _n_frames; ++i) {
+        state.setTime(_time[i]);
+
+        for (int j = 0; j < static_cast<int>(coords.size()); ++j) {
+            coords[j]->setValue(state, _q_matrix(i, j), false);
+        }
+
+        auto start = std::chrono::high_resolution_clock::now();
+
+        model.realizeDynamics(state);
+
+        auto stop = std::chrono::high_resolution_clock::now();
+        eval_time += std::chrono::duration<double>(stop - start).count();
+
+        for (int c = 0; c < nContacts; ++c) {
+            const Smith2018ArticularContactForce& frc = *contact_forces[c];
+
+            _contact_force[l][c](i) = frc.getOutputValue<SimTK::Vec3>(
+                state, "casting_total_contact_force");
+            _center_of_pressure[l][c](i) = frc.getOutputValue<SimTK::Vec3>(
+                state, "casting_total_center_of_pressure");
+            _max_pressure[l][c](i) = frc.getOutputValue<double>(
+                state, "casting_total_max_pressure");
+        }
+    }
+    _level_eval_time[l] = eval_time;
+
+    std::cout << "Evaluation Time: " << eval_time << " s" << std::endl;
+}
+
+void ContactMeshConvergenceTool::computeErrors()
+{
+    int nLevels = static_cast<int>(_levels.size());
+    int nContacts = static_cast<int>(_contact_force_paths.size());
+    int ref = nLevels - 1;
+
+    _force_error.assign(nLevels, std::vector<double>(nContacts, 0.0));
+    _cop_error.assign(nLevels, std::vector<double>(nContacts, 0.0));
+    _max_pressure_error.assign(nLevels, std::vector<double>(nContacts, 0.0));
+
+    for (int c = 0; c < nContacts; ++c) {
+        double ref_force = 0.0;
+        double ref_pressure = 0.0;
+        for (int i = 0; i < _n_frames; ++i) {
+            ref_force = std::max(ref_force, _contact_force[ref][c](i).norm());
+            ref_pressure = std::max(ref_pressure,
+                std::abs(_max_pressure[ref][c](i)));
+        }
+
+        for (int l = 0; l < nLevels; ++l) {
+            double force_err = 0.0;
+            double cop_err = 0.0;
+            double pressure_err = 0.0;
+
+            for (int i = 0; i < _n_frames; ++i) {
+                force_err = std::max(force_err,
+                    (_contact_force[l][c](i) - _contact_force[ref][c](i)).
+                    norm());
+
+                pressure_err = std::max(pressure_err,
+                    std::abs(_max_pressure[l][c](i) - _max_pressure[ref][c](i)));
+
+                //Center of pressure is only defined for frames in contact,
+                //ignore frames with negligible contact in the reference
+                if (_contact_force[ref][c](i).norm() > 0.01 * ref_force &&
+                    _contact_force[l][c](i).norm() > 0.0) {
+
+                    cop_err = std::max(cop_err, (_center_of_pressure[l][c](i) -
+                        _center_of_pressure[ref][c](i)).norm());
+                }
+            }
+
+            _force_error[l][c] = ref_force > 0.0 ? force_err / ref_force : 0.0;
+            _cop_error[l][c] = cop_err;
+            _max_pressure_error[l][c] =
+                ref_pressure > 0.0 ? pressure_err / ref_pressure : 0.0;
+        }
+    }
+}
+
+void ContactMeshConvergenceTool::printResults()
+{
+    int nLevels = static_cast<int>(_levels.size());
+    int nContacts = static_cast<int>(_contact_force_paths.size());
+    int nMeshes = static_cast<int>(_contact_mesh_paths.size());
+
+    //Find the cheapest level within tolerance for all contacts
+    int recommended = -1;
+    std::vector<bool> within_tol(nLevels, true);
+    for (int l = 0; l < nLevels; ++l) {
+        for (int c = 0; c < nContacts; ++c) {
+            if (_force_error[l][c] > get_force_tolerance() ||
+                _cop_error[l][c] > get_center_of_pressure_tolerance() ||
+                _max_pressure_error[l][c] > get_max_pressure_tolerance()) {
+                within_tol[l] = false;
+            }
+        }
+        if (within_tol[l] && (recommended == -1 ||
+            _level_eval_time[l] < _level_eval_time[recommended])) {
+            recommended = l;
+        }
+    }
+
+    //Write results file
+    std::string file = get_results_directory() + "/" +
+        get_results_file_basename() + "_mesh_convergence.csv";
+
+    std::ofstream out(file);
+    OPENSIM_THROW_IF(!out.is_open(), Exception,
+        "ContactMeshConvergenceTool: could not open " + file)
+
+    out << "level,level_name";
+    for (int m = 0; m < nMeshes; ++m) {
+        out << "," << _contact_mesh_paths[m] << "/num_triangles";
+    }
+    out << ",evaluation_time";
+    for (int c = 0; c < nContacts; ++c) {
+        out << "," << _contact_force_paths[c] << "/force_error";
+        out << "," << _contact_force_paths[c] << "/center_of_pressure_error";
+        out << "," << _contact_force_paths[c] << "/max_pressure_error";
+    }
+    out << ",within_tolerance,recommended" << std::endl;
+
+    out << std::setprecision(8);
+    for (int l = 0; l < nLevels; ++l) {
+        out << _levels[l] << "," << getLevelName(_levels[l]);
+        for (int m = 0; m < nMeshes; ++m) {
+            out << "," << _level_mesh_num_faces[l][m];
+        }
+        out << "," << _level_eval_time[l];
+        for (int c = 0; c < nContacts; ++c) {
+            out << "," << _force_error[l][c];
+            out << "," << _cop_error[l][c];
+            out << "," << _max_pressure_error[l][c];
+        }
+        out << "," << within_tol[l] << "," << (l == recommended) << std::endl;
+    }
+    out.close();
+
+    //Print summary
+    std::cout << std::endl;
+    std::cout << "Contact Mesh Convergence Results" << std::endl;
+    std::cout << "================================" << std::endl;
+    std::cout << "Reference level: " << getLevelName(_levels.back()) <<
+        std::endl;
+
+    for (int l = 0; l < nLevels; ++l) {
+        std::cout << std::endl;
+        std::cout << getLevelName(_levels[l]) << "  evaluation time: " <<
+            _level_eval_time[l] << " s" <<
+            (within_tol[l] ? "" : "  [exceeds tolerance]") << std::endl;
+
+        for (int m = 0; m < nMeshes; ++m) {
+            std::cout << "  " << _contact_mesh_paths[m] << ": " <<
+                _level_mesh_num_faces[l][m] << " triangles" << std::endl;
+        }
+        for (int c = 0; c < nContacts; ++c) {
+            std::cout << "  " << _contact_force_paths[c] <<
+                "  force error: " << _force_error[l][c] <<
+                "  cop error: " << _cop_error[l][c] <<
+                "  max pressure error: " << _max_pressure_error[l][c] <<
+                std::endl;
+        }
+    }
+
+    std::cout << std::endl;
+    std::cout << "Recommended mesh level: " << getLevelName(_levels[recommended])
+        << std::endl;
+    for (int m = 0; m < nMeshes; ++m) {
+        std::cout << "  " << _contact_mesh_paths[m] << ": " <<
+            _level_mesh_files[recommended][m] << std::endl;
+    }
+    std::cout << "Results written to: " << file << std::endl;
+}
+
+double ContactMeshConvergenceTool::computeMeanEdgeLength(
+    const SimTK::PolygonalMesh& mesh)
+{
+    double sum = 0.0;
+    int nEdges = 0;
+
+    for (int f = 0; f < mesh.getNumFaces(); ++f) {
+        int nVert = mesh.getNumVerticesForFace(f);
+        for (int k = 0; k < nVert; ++k) {
+            SimTK::Vec3 p0 = mesh.getVertexPosition(mesh.getFaceVertex(f, k));
+            SimTK::Vec3 p1 = mesh.getVertexPosition(
+                mesh.getFaceVertex(f, (k + 1) % nVert));
+            sum += (p1 - p0).norm();
+            nEdges++;
+        }
+    }
+    return nEdges > 0 ? sum / nEdges : 0.0;
+}
+
+void ContactMeshConvergenceTool::subdivideMesh(
+    const SimTK::PolygonalMesh& mesh, SimTK::PolygonalMesh& refined_mesh)
+{
+    refined_mesh = SimTK::PolygonalMesh();
+
+    for (int v = 0; v < mesh.getNumVertices(); ++v) {
+        refined_mesh.addVertex(mesh.getVertexPosition(v));
+    }
+
+    //Edge midpoints are shared by the neighboring triangles
+    std::map<std::pair<int, int>, int> midpoints;
+    auto getMidpoint = [&](int a, int b) {
+        std::pair<int, int> edge(std::min(a, b), std::max(a, b));
+        auto it = midpoints.find(edge);
+        if (it != midpoints.end()) {
+            return it->second;
+        }
+        int index = refined_mesh.addVertex(0.5 *
+            (mesh.getVertexPosition(a) + mesh.getVertexPosition(b)));
+        midpoints[edge] = index;
+        return index;
+    };
+
+    for (int f = 0; f < mesh.getNumFaces(); ++f) {
+        OPENSIM_THROW_IF(mesh.getNumVerticesForFace(f) != 3, Exception,
+            "ContactMeshConvergenceTool: only triangle meshes are supported.")
+
+        int a = mesh.getFaceVertex(f, 0);
+        int b = mesh.getFaceVertex(f, 1);
+        int c = mesh.getFaceVertex(f, 2);
+
+        int ab = getMidpoint(a, b);
+        int bc = getMidpoint(b, c);
+        int ca = getMidpoint(c, a);
+
+        refined_mesh.addFace(SimTK::Array_<int>{a, ab, ca});
+        refined_mesh.addFace(SimTK::Array_<int>{ab, b, bc});
+        refined_mesh.addFace(SimTK::Array_<int>{ca, bc, c});
+        refined_mesh.addFace(SimTK::Array_<int>{ab, bc, ca});
+    }
+}
+
+void ContactMeshConvergenceTool::decimateMesh(
+    const SimTK::PolygonalMesh& mesh, double cell_size,
+    SimTK::PolygonalMesh& coarse_mesh)
+{
+    OPENSIM_THROW_IF(cell_size <= 0.0, Exception,
+        "ContactMeshConvergenceTool: cell_size must be greater than 0.")
+
+    coarse_mesh = SimTK::PolygonalMesh();
+    int nVert = mesh.getNumVertices();
+
+    //Assign each vertex to a grid cell
+    typedef std::tuple<long, long, long> Cell;
+    std::map<Cell, int> cell_index;
+    std::vector<int> vertex_cluster(nVert);
+    std::vector<SimTK::Vec3> cluster_sum;
+    std::vector<int> cluster_count;
+
+    for (int v = 0; v < nVert; ++v) {
+        SimTK::Vec3 pos = mesh.getVertexPosition(v);
+        Cell cell(static_cast<long>(std::floor(pos(0) / cell_size)),
+            static_cast<long>(std::floor(pos(1) / cell_size)),
+            static_cast<long>(std::floor(pos(2) / cell_size)));
+
+        auto it = cell_index.find(cell);
+        if (it == cell_index.end()) {
+            int index = static_cast<int>(cluster_sum.size());
+            cell_index[cell] = index;
+            cluster_sum.push_back(pos);
+            cluster_count.push_back(1);
+            vertex_cluster[v] = index;
+        }
+        else {
+            cluster_sum[it->second] += pos;
+            cluster_count[it->second]++;
+            vertex_cluster[v] = it->second;
+        }
+    }
+
+    //Merged vertex is located at the mean of the cluster
+    for (int k = 0; k < static_cast<int>(cluster_sum.size()); ++k) {
+        coarse_mesh.addVertex(cluster_sum[k] / cluster_count[k]);
+    }
+
+    //Keep the triangles whose vertices are in different clusters
+    std::set<std::tuple<int, int, int>> faces;
+    for (int f = 0; f < mesh.getNumFaces(); ++f) {
+        OPENSIM_THROW_IF(mesh.getNumVerticesForFace(f) != 3, Exception,
+            "ContactMeshConvergenceTool: only triangle meshes are supported.")
+
+        int a = vertex_cluster[mesh.getFaceVertex(f, 0)];
+        int b = vertex_cluster[mesh.getFaceVertex(f, 1)];
+        int c = vertex_cluster[mesh.getFaceVertex(f, 2)];
+
+        if (a == b || b == c || c == a) {
+            continue;
+        }
+
+        std::vector<int> key{ a, b, c };
+        std::sort(key.begin(), key.end());
+        if (!faces.insert(std::make_tuple(key[0], key[1], key[2])).second) {
+            continue;
+        }
+
+        coarse_mesh.addFace(SimTK::Array_<int>{a, b, c});
+    }
+
+    //Unused clusters are harmless, but the mesh must contain triangles
+    OPENSIM_THROW_IF(coarse_mesh.getNumFaces() == 0, Exception,
+        "ContactMeshConvergenceTool: decimated mesh contains no triangles, "
+        "reduce decimation_factor or num_decimation_levels.")
+}
+
+void ContactMeshConvergenceTool::writeMeshFile(
+    const SimTK::PolygonalMesh& mesh, const std::string& file)
+{
+    std::ofstream out(file);
+    OPENSIM_THROW_IF(!out.is_open(), Exception,
+        "ContactMeshConvergenceTool: could not open " + file)
+
+    out << std::setprecision(12);
+    for (int v = 0; v < mesh.getNumVertices(); ++v) {
+        SimTK::Vec3 pos = mesh.getVertexPosition(v);
+        out << "v " << pos(0) << " " << pos(1) << " " << pos(2) << "\n";
+    }
+
+    //.obj vertex indices start at 1
+    for (int f = 0; f < mesh.getNumFaces(); ++f) {
+        out << "f";
+        for (int k = 0; k < mesh.getNumVerticesForFace(f); ++k) {
+            out << " " << mesh.getFaceVertex(f, k) + 1;
+        }
+        out << "\n";
+    }
+    out.close();
+}
@@ -0,0 +1,190 @@
+#ifndef OPENSIM_CONTACT_MESH_CONVERGENCE_TOOL_H_
+#define OPENSIM_CONTACT_MESH_CONVERGENCE_TOOL_H_
+/* -------------------------------------------------------------------------- *
+ *                      ContactMeshConvergenceTool.h                          *
+ * -------------------------------------------------------------------------- *
+ * Author(s): Colin Smith                                                     *
+ *                                                                            *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may    *
+ * not use this file except in compliance with the License. You may obtain a  *
+ * copy of the License at http://www.apache.org/licenses/LICENSE-2.0.         *
+ *                                                                            *
+ * Unless required by applicable law or agreed to in writing, software        *
+ * distributed under the License is distributed on an "AS IS" BASIS,          *
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.   *
+ * See the License for the specific language governing permissions and        *
+ * limitations under the License.                                             *
+ * -------------------------------------------------------------------------- */
+
+#include <OpenSim/Simulation/Model/Model.h>
+#include "Smith2018ArticularContactForce.h"
+#include "osimPluginDLL.h"
+
+namespace OpenSim {
+
+//=============================================================================
+//                     Contact Mesh Convergence Tool
+//=============================================================================
+/**
+The ContactMeshConvergenceTool performs a mesh resolution convergence study
+for the Smith2018ContactMeshes in a model. The resolution of a cartilage mesh
+is a trade off between the accuracy of the predicted contact pressures and
+the computational cost of the collision detection and pressure calculations,
+so this tool enables the mesh resolution to be selected based on measured
+errors and evaluation times rather than guesswork.
+
+For each resolution level, a variant of each contact mesh is generated
+in-process and written to results_directory/meshes as an .obj file. Coarser
+levels are generated by vertex clustering (the mesh is overlayed with a
+uniform grid, the vertices in each grid cell are merged, and the degenerate
+triangles are removed) and finer levels are generated by midpoint
+subdivision (each triangle is split into four). Level 0 is the original mesh.
+The model is then posed at each frame in the states_file (similar to the
+JointMechanicsTool) and the contact force, center of pressure and max
+pressure of each Smith2018ArticularContactForce are computed.
+
+The errors of each level are computed relative to the finest level:
+
+force error: max |F - F_finest| / max |F_finest| (over all frames)
+
+center of pressure error: max |COP - COP_finest| (over frames in contact)
+
+max pressure error: max |P - P_finest| / max |P_finest| (over all frames)
+
+The results are printed to the console and written to
+results_directory/results_file_basename_mesh_convergence.csv. The cheapest
+level (smallest evaluation time) with all errors below the tolerances is
+reported as the recommended resolution.
+
+Note: the generated meshes use the default half space regions, as the
+region labels of the original mesh do not apply to the modified
+triangulation.
+*/
+class OSIMPLUGIN_API ContactMeshConvergenceTool : public Object {
+
+    OpenSim_DECLARE_CONCRETE_OBJECT(ContactMeshConvergenceTool, Object);
+
+//=============================================================================
+// PROPERTIES
+//=============================================================================
+public:
+    OpenSim_DECLARE_PROPERTY(model_file, std::string,
+        "Path to .osim model file.")
+
+    OpenSim_DECLARE_PROPERTY(states_file, std::string,
+        "Path to storage file (.sto) containing the model coordinate values "
+        "at each frame to be evaluated.")
+
+    OpenSim_DECLARE_PROPERTY(results_directory, std::string,
+        "Path to folder where the results files and generated meshes will be "
+        "written.")
+
+    OpenSim_DECLARE_PROPERTY(results_file_basename, std::string,
+        "Prefix to each results file name.")
+
+    OpenSim_DECLARE_PROPERTY(start_time, double,
+        "Time to start analysis. Set to -1 to use initial frame in "
+        "states_file. The default value is -1.")
+
+    OpenSim_DECLARE_PROPERTY(stop_time, double,
+        "Time to stop analysis. Set to -1 to use last frame in states_file. "
+        "The default value is -1.")
+
+    OpenSim_DECLARE_LIST_PROPERTY(contacts, std::string,
+        "Paths to the Smith2018ArticularContactForces to evaluate. The meshes "
+        "connected to these forces are refined and coarsened. The default "
+        "value is 'all'.")
+
+    OpenSim_DECLARE_PROPERTY(num_decimation_levels, int,
+        "Number of coarser mesh levels to generate. The default value is 2.")
+
+    OpenSim_DECLARE_PROPERTY(num_subdivision_levels, int,
+        "Number of finer mesh levels to generate by midpoint subdivision. "
+        "The finest level is used as the reference solution. "
+        "The default value is 1.")
+
+    OpenSim_DECLARE_PROPERTY(decimation_factor, double,
+        "Approximate reduction in the number of triangles between each "
+        "coarser mesh level. The default value is 2.0.")
+
+    OpenSim_DECLARE_PROPERTY(force_tolerance, double,
+        "Maximum relative error in the contact force compared to the finest "
+        "level. The default value is 0.02.")
+
+    OpenSim_DECLARE_PROPERTY(center_of_pressure_tolerance, double,
+        "Maximum error in the center of pressure location (meters) compared "
+        "to the finest level. The default value is 0.001.")
+
+    OpenSim_DECLARE_PROPERTY(max_pressure_tolerance, double,
+        "Maximum relative error in the max pressure compared to the finest "
+        "level. The default value is 0.1.")
+
+//=============================================================================
+// METHODS
+//=============================================================================
+public:
+    ContactMeshConvergenceTool();
+    ContactMeshConvergenceTool(std::string settings_file);
+
+    void run();
+
+    /** Split each triangle into four triangles by inserting a vertex at the
+    midpoint of each edge. */
+    static void subdivideMesh(const SimTK::PolygonalMesh& mesh,
+        SimTK::PolygonalMesh& refined_mesh);
+
+    /** Coarsen a mesh by merging all vertices located in the same cell of
+    a uniform grid (vertex clustering) and removing the degenerate triangles.*/
+    static void decimateMesh(const SimTK::PolygonalMesh& mesh,
+        double cell_size, SimTK::PolygonalMesh& coarse_mesh);
+
+    static double computeMeanEdgeLength(const SimTK::PolygonalMesh& mesh);
+
+    static void writeMeshFile(const SimTK::PolygonalMesh& mesh,
+        const std::string& file);
+
+private:
+    void setNull();
+    void constructProperties();
+    void readStatesFromFile(const Model& model);
+    void findContacts(const Model& model);
+    std::string getLevelName(int level) const;
+    void generateMeshes(const Model& model);
+    void evaluateLevel(int level);
+    void computeErrors();
+    void printResults();
+
+//=============================================================================
+// DATA
+//=============================================================================
+private:
+    std::string _directoryOfSetupFile;
+
+    Array<double> _time;
+    int _n_frames;
+    SimTK::Matrix _q_matrix;
+    std::vector<std::string> _coord_paths;
+
+    std::vector<std::string> _contact_force_paths;
+    std::vector<std::string> _contact_mesh_paths;
+
+    std::vector<int> _levels;
+    std::vector<std::vector<std::string>> _level_mesh_files;
+    std::vector<std::vector<int>> _level_mesh_num_faces;
+    std::vector<double> _level_eval_time;
+
+    //[level][contact force] (nFrames)
+    std::vector<std::vector<SimTK::Vector_<SimTK::Vec3>>> _contact_force;
+    std::vector<std::vector<SimTK::Vector_<SimTK::Vec3>>> _center_of_pressure;
+    std::vector<std::vector<SimTK::Vector>> _max_pressure;
+
+    //[level][contact force]
+    std::vector<std::vector<double>> _force_error;
+    std::vector<std::vector<double>> _cop_error;
+    std::vector<std::vector<double>> _max_pressure_error;
+//=============================================================================
+};  // END of class ContactMeshConvergenceTool
+
+}; //namespace
+
+#endif // #ifndef OPENSIM_CONTACT_MESH_CONVERGENCE_TOOL_H_
@@ -28,6 +28,8 @@
 #include <OpenSim/Common/IO.h>
 #include "Smith2018ArticularContactForce.h"
 #include "Blankevoort1991Ligament.h"
+#include "PrescribedActuatorForce.h"
+#include "STOFileStream.h"
 using namespace OpenSim;
 
 ForsimTool::ForsimTool() : Object()
@@ -63,6 +65,7 @@ void ForsimTool::constructProperties()
     constructProperty_report_time_step(0.01);
     constructProperty_integrator_accuracy(1e-6);
     constructProperty_internal_step_limit(-1);
+    constructProperty_use_contact_events(false);
     constructProperty_constant_muscle_control(0.02);
     constructProperty_ignore_activation_dynamics(false);
     constructProperty_ignore_tendon_compliance(false);
@@ -72,6 +75,8 @@ void ForsimTool::constructProperties()
     constructProperty_actuator_input_file("");
     constructProperty_external_loads_file("");
     constructProperty_prescribed_coordinates_file("");
+    constructProperty_stream_results(false);
+    constructProperty_stream_flush_interval(10);
     constructProperty_use_visualizer(false);
     constructProperty_verbose(0);
     constructProperty_AnalysisSet(AnalysisSet());
@@ -110,6 +115,13 @@ void ForsimTool::run()
 
     applyExternalLoads();
 
+    if (get_use_contact_events()) {
+        for (Smith2018ArticularContactForce& cnt : 
+            _model.updComponentList<Smith2018ArticularContactForce>()) {
+            cnt.set_use_contact_events(true);
+        }
+    }
+
     if (get_use_visualizer()) {
         _model.setUseVisualizer(true);
     }
@@ -128,6 +140,19 @@ void ForsimTool::run()
     StatesTrajectory result_states;
     AnalysisSet& analysisSet = _model.updAnalysisSet();
 
+    std::string basefile = get_results_directory() + "/" + get_results_file_basename();
+
+    STOFileStream states_stream;
+    if (get_stream_results()) {
+        Array<std::string> names = _model.getStateVariableNames();
+        std::vector<std::string> labels;
+        for (int i = 0; i < names.size(); ++i) {
+            labels.push_back(names[i]);
+        }
+        states_stream.open(basefile + "_states.sto", "States", labels, false,
+            get_stream_flush_interval());
+    }
+
     if (get_equilibrate_muscles()) {
         _model.equilibrateMuscles(state);
     }
@@ -177,17 +202,8 @@ void ForsimTool::run()
 
         printDebugInfo(state);
 
-        //Set Prescribed Muscle Forces
-        if(_prescribed_frc_actuator_paths.size() > 0){
-            for (int j = 0; j < _prescribed_frc_actuator_paths.size();++j) {
-                std::string actuator_path = _prescribed_frc_actuator_paths[j];
-                ScalarActuator& actuator = _model.updComponent<ScalarActuator>(actuator_path);
-                double value = _frc_functions.get(actuator_path +"_frc").calcValue(SimTK::Vector(1,t));
-                actuator.setOverrideActuation(state, value);
-            }
-            timestepper.initialize(state);
-        }
-            
+        //Prescribed controls and forces are functions of time in the
+        //system, so the integrator steps continuously across report times
         timestepper.stepTo(t);
 
         state = timestepper.updIntegrator().updAdvancedState();
@@ -200,21 +216,38 @@ void ForsimTool::run()
             analysisSet.step(state, i);
         }
 
-        result_states.append(state);
+        if (get_stream_results()) {
+            states_stream.appendRow(state.getTime(),
+                ~_model.getStateVariableValues(state));
+        }
+        else {
+            result_states.append(state);
+        }
+
+        if (get_use_contact_events() && get_verbose() > 0) {
+            for (const Smith2018ArticularContactForce& cnt :
+                _model.getComponentList<Smith2018ArticularContactForce>()) {
+                std::cout << cnt.getName() << " contact events: " 
+                    << cnt.getNumContactEvents(state) << std::endl;
+            }
+        }
     }
 
     //Print Results
-    TimeSeriesTable states_table = result_states.exportToTable(_model);
-    states_table.addTableMetaData("header", std::string("States"));
-    states_table.addTableMetaData("nRows", std::to_string(states_table.getNumRows()));
-    states_table.addTableMetaData("nColumns", std::to_string(states_table.getNumColumns()+1));
-    states_table.addTableMetaData("inDegrees", std::string("no"));
-
-    STOFileAdapter sto;
-    std::string basefile = get_results_directory() + "/" + get_results_file_basename();
+    if (get_stream_results()) {
+        states_stream.close();
+    }
+    else {
+        TimeSeriesTable states_table = result_states.exportToTable(_model);
+        states_table.addTableMetaData("header", std::string("States"));
+        states_table.addTableMetaData("nRows", std::to_string(states_table.getNumRows()));
+        states_table.addTableMetaData("nColumns", std::to_string(states_table.getNumColumns()+1));
+        states_table.addTableMetaData("inDegrees", std::string("no"));
+
+        STOFileAdapter sto;
+        sto.write(states_table, basefile + "_states.sto");
+    }
 
-    sto.write(states_table, basefile + "_states.sto");
-    
     _model.updAnalysisSet().printResults(get_results_file_basename(), get_results_directory());
 
     std::cout << "\nSimulation complete." << std::endl;
@@ -361,12 +394,16 @@ void ForsimTool::initializeActuators(SimTK::State& state) {
 
                 try {
                     ScalarActuator& actuator = _model.updComponent<ScalarActuator>(actuator_path);
-                    actuator.overrideActuation(state, true);
                     _prescribed_frc_actuator_paths.push_back(actuator_path);
                     SimTK::Vector values = _actuator_table.getDependentColumn(labels[i]);
-                    SimmSpline* frc_function = new SimmSpline(nDataPt, &time[0], &values[0], actuator_path + "_frc");
+                    SimmSpline frc_function(nDataPt, &time[0], &values[0], actuator_path + "_frc");
+
+                    //The prescribed force replaces the actuator force
+                    actuator.set_appliesForce(false);
 
-                    _frc_functions.adoptAndAppend(frc_function); 
+                    _model.addForce(new PrescribedActuatorForce(
+                        actuator.getName() + "_prescribed_force",
+                        actuator, frc_function));
                 }
                 catch (ComponentNotFoundOnSpecifiedPath) {
                     
@@ -386,6 +423,8 @@ void ForsimTool::initializeActuators(SimTK::State& state) {
             for (std::string& name : _prescribed_frc_actuator_paths) {
                 std::cout << name << std::endl;
             }
+            std::cout << "(appliesForce set to false, the applied force is "
+                "reported in <actuator>_prescribed_force)" << std::endl;
             std::cout << std::endl;
         }
 
@@ -50,13 +50,28 @@ The following optional input input files can be used to define time varying
 simulation parameters:
 
 actuator_input_file: Define muscle and actuator controls (excitations), 
-activations, or forces vs time.
+activations, or forces vs time. Controls and activations are prescribed with 
+a PrescribedController, and forces with a PrescribedActuatorForce that 
+replaces the force of the actuator. Both are splines of time evaluated in 
+the system, so the integrator is initialized once and steps continuously 
+through the report times. The appliesForce property of force prescribed 
+actuators is set to false, so their own outputs and ForceReporter columns 
+report the force of the actuator model that is no longer applied. The 
+applied force is reported in the <actuator>_prescribed_force column.
 
 external_loads_file: Define the external loads and the model segments
 that they are acting on. 
 
 prescribed_coordinate_file: Define the prescribed coordinates in the 
 model and their values vs time.  
+
+Contact onset and release can be detected by the integrator by setting the 
+use_contact_events property. The Smith2018ArticularContactForces then add 
+witness functions to the system that change sign when the largest signed 
+proximity between the meshes crosses zero, so the integrator steps to the 
+onset of contact and restarts with a small step, rather than overshooting 
+into the stiff contact region and rejecting steps. Only contact onset and 
+release trigger events.
 */
 
 class OSIMPLUGIN_API ForsimTool : public Object {
@@ -103,6 +118,14 @@ public:
         "Limit on the number of internal steps that can be taken by BDF "
         "integrator. If -1, then there is no limit. The Default value is -1")
 
+    OpenSim_DECLARE_PROPERTY(use_contact_events, bool,
+        "Set the use_contact_events property of all "
+        "Smith2018ArticularContactForces in the model so the integrator "
+        "localizes the time when the articular surfaces come into contact or "
+        "separate. This avoids the many rejected steps that occur when a "
+        "large step carries the model deep into contact (e.g. heel strike in "
+        "drop landing and impact simulations). The default value is false.")
+
     OpenSim_DECLARE_PROPERTY(constant_muscle_control, double,
         "Constant value (between 0 and 1) input as control to all muscles not "
         "listed in the actuator_input_file. "
@@ -152,6 +175,18 @@ public:
         "The columns labels must be formatted as 'time' and "
         "'/Path/To/Coordinate'")
 
+    OpenSim_DECLARE_PROPERTY(stream_results, bool, "Write each reported "
+        "state to the _states.sto file as soon as it is computed, instead of "
+        "storing all states in memory and writing the file at the end of the "
+        "simulation. Memory use does not grow with the simulation length and "
+        "the states up to the last flush are kept if the simulation is "
+        "aborted. The AnalysisSet results are still written at the end. "
+        "The default value is false.")
+
+    OpenSim_DECLARE_PROPERTY(stream_flush_interval, int, "Number of reported "
+        "states between flushes of the streamed _states.sto file to disk "
+        "(see stream_results). The default value is 10.")
+
     OpenSim_DECLARE_PROPERTY(use_visualizer, bool, "Use the SimTK visualizer "
         "to display the simulation. The default value is false.")
 
@@ -195,7 +230,6 @@ private:
     std::vector<std::string> _prescribed_act_actuator_paths;
     std::vector<std::string> _prescribed_control_actuator_paths;
 
-    FunctionSet _frc_functions;
     FunctionSet _act_functions;
 
     TimeSeriesTable _actuator_table;
@@ -248,6 +248,64 @@ void H5FileAdapter::writeComponentGroupDataSetVector(std::string group_name,
     }
 }
     
+void H5FileAdapter::writeComponentGroupDataSetSparse(std::string group_name,
+    std::vector<std::string> names,
+	std::vector<std::string> output_vector_names,
+    std::vector<std::vector<SparseRowMatrix>> output_vector_values)
+{
+	createGroup(group_name);
+    
+    int i = 0;
+    for (std::string comp_name : names) {
+        std::string comp_group = group_name + "/" + comp_name;
+		createGroup(comp_group);
+
+        int j = 0;
+        for (std::string data_label : output_vector_names) {
+            writeDataSetSparseMatrix(output_vector_values[i][j], comp_group + "/" + data_label);
+            j++;
+        }
+        i++;
+    }
+}
+
+void H5FileAdapter::writeDataSetSparseMatrix(const SparseRowMatrix& data_matrix, const std::string group_path) {
+	createGroup(group_path);
+	H5::Group group = _file.openGroup(group_path);
+
+	//Dimensions
+	H5::DataSpace attr_dataspace(H5S_SCALAR);
+	int nrow = data_matrix.nrow();
+	int ncol = data_matrix.ncol();
+
+	H5::Attribute nrow_attr = group.createAttribute("num_rows", H5::PredType::NATIVE_INT, attr_dataspace);
+	nrow_attr.write(H5::PredType::NATIVE_INT, &nrow);
+	H5::Attribute ncol_attr = group.createAttribute("num_columns", H5::PredType::NATIVE_INT, attr_dataspace);
+	ncol_attr.write(H5::PredType::NATIVE_INT, &ncol);
+
+	//Row Offsets
+	hsize_t dim_offsets[1];
+	dim_offsets[0] = data_matrix.getRowOffsets().size();
+
+	H5::DataSpace offsets_dataspace(1, dim_offsets, dim_offsets);
+	H5::DataSet offsets_dataset = _file.createDataSet(group_path + "/row_offsets", H5::PredType::NATIVE_INT, offsets_dataspace);
+	offsets_dataset.write(data_matrix.getRowOffsets().data(), H5::PredType::NATIVE_INT);
+
+	//Nonzero Entries
+	hsize_t dim_data[1];
+	dim_data[0] = data_matrix.getNumNonzero();
+
+	H5::DataSpace index_dataspace(1, dim_data, dim_data);
+	H5::DataSet index_dataset = _file.createDataSet(group_path + "/column_index", H5::PredType::NATIVE_INT, index_dataspace);
+	H5::DataSpace values_dataspace(1, dim_data, dim_data);
+	H5::DataSet values_dataset = _file.createDataSet(group_path + "/values", H5::PredType::NATIVE_DOUBLE, values_dataspace);
+
+	if (dim_data[0] > 0) {
+		index_dataset.write(data_matrix.getColumnIndex().data(), H5::PredType::NATIVE_INT);
+		values_dataset.write(data_matrix.getValues().data(), H5::PredType::NATIVE_DOUBLE);
+	}
+}
+
 void H5FileAdapter::writeDataSetSimTKVector(const SimTK::Vector& data_vector, const std::string dataset_path) {
 	hsize_t dim_data[1];
 	dim_data[0] = data_vector.size();
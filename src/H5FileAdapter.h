@@ -37,6 +37,7 @@ of groups
 #include "osimPluginDLL.h"
 #include "OpenSim/Common/TimeSeriesTable.h"
 #include "OpenSim/Common/Array.h"
+#include "SparseRowMatrix.h"
 
 namespace OpenSim {
 
@@ -92,6 +93,16 @@ namespace OpenSim {
            std::vector<std::string> output_vector_names,
            std::vector<std::vector<SimTK::Matrix>> output_vector_values);
 
+       void writeComponentGroupDataSetSparse(std::string group_name,
+           std::vector<std::string> names,
+           std::vector<std::string> output_vector_names,
+           std::vector<std::vector<SparseRowMatrix>> output_vector_values);
+
+       /** Write a SparseRowMatrix as a group containing the datasets 
+       row_offsets, column_index and values (CSR format) and the attributes
+       num_rows and num_columns. */
+       void writeDataSetSparseMatrix(const SparseRowMatrix& data_matrix, const std::string group_path);
+
     protected:
         OutputTables extendRead(const std::string& fileName) const override;
 
@@ -99,6 +99,7 @@ void JointMechanicsTool::constructProperties()
     constructProperty_write_h5_file(true);
     constructProperty_h5_states_data(true);
     constructProperty_h5_kinematics_data(true);
+    constructProperty_h5_sparse_contact_data(false);
 
     constructProperty_AnalysisSet(AnalysisSet());
 }
@@ -443,8 +444,7 @@ void JointMechanicsTool::setupContactStorage(SimTK::State& state) {
                 _contact_output_vec3_names.push_back(output->getName());
             }
             if (output->getTypeName() == "Vector") {
-                _contact_output_vector_double_names.push_back(
-                    output->getName());
+                addContactOutputVectorName(output->getName());
             }
         }
     }
@@ -463,7 +463,7 @@ void JointMechanicsTool::setupContactStorage(SimTK::State& state) {
                     _contact_output_vec3_names.push_back(output_name);
                 }
                 if (output.getTypeName() == "Vector") {
-                    _contact_output_vector_double_names.push_back(output_name);
+                    addContactOutputVectorName(output_name);
                 }
             }
             catch (Exception){
@@ -478,6 +478,7 @@ void JointMechanicsTool::setupContactStorage(SimTK::State& state) {
     int nOutputDouble = _contact_output_double_names.size();
     int nOutputVec3 = _contact_output_vec3_names.size();
     int nOutputVector = _contact_output_vector_double_names.size();
+    int nOutputDenseVector = _contact_output_dense_vector_names.size();
 
     SimTK::Matrix double_data(_n_frames, nOutputDouble,-1);
     SimTK::Matrix_<SimTK::Vec3> vec3_data(_n_frames, nOutputVec3,SimTK::Vec3(-1));    
@@ -488,7 +489,7 @@ void JointMechanicsTool::setupContactStorage(SimTK::State& state) {
         _contact_output_double_values.push_back(double_data);
         _contact_output_vec3_values.push_back(vec3_data);
 
-        std::vector<SimTK::Matrix> def_output_vector;
+        std::vector<SparseRowMatrix> def_output_vector;
 
         for (int i = 0; i < nOutputVector; ++i) {
             
@@ -497,10 +498,21 @@ void JointMechanicsTool::setupContactStorage(SimTK::State& state) {
             const Output<SimTK::Vector>& vector_output = dynamic_cast<const Output<SimTK::Vector>&>(abs_output);
             int output_vector_size = vector_output.getValue(state).size();
             
-            def_output_vector.push_back(SimTK::Matrix(_n_frames, output_vector_size,-1));
+            //Only the contacting triangles are stored for each frame
+            def_output_vector.push_back(SparseRowMatrix(output_vector_size));
         }
         _contact_output_vector_double_values.push_back(def_output_vector);
 
+        std::vector<SimTK::Matrix> def_output_dense_vector;
+
+        for (int i = 0; i < nOutputDenseVector; ++i) {
+            int output_vector_size = frc.getOutputValue<SimTK::Vector>(
+                state, _contact_output_dense_vector_names[i]).size();
+
+            def_output_dense_vector.push_back(
+                SimTK::Matrix(_n_frames, output_vector_size, -1));
+        }
+        _contact_output_dense_vector_values.push_back(def_output_dense_vector);
     }
     
     //Vertex location storage
@@ -868,10 +880,20 @@ int JointMechanicsTool::record(const SimTK::State& s, const int frame_num)
             }
             
             int nVector = 0;
+            std::vector<int> triangle_index;
+            SimTK::Vector triangle_data;
             for (std::string output_name : _contact_output_vector_double_names) {
-                _contact_output_vector_double_values[nFrc][nVector].updRow(frame_num) = ~frc.getOutputValue<SimTK::Vector>(s, output_name);                                
+                frc.getTriangleOutputSparse(s, output_name, triangle_index, triangle_data);
+                _contact_output_vector_double_values[nFrc][nVector].appendRow(triangle_index, triangle_data);
                 nVector++;
             }
+
+            int nDenseVector = 0;
+            for (std::string output_name : _contact_output_dense_vector_names) {
+                _contact_output_dense_vector_values[nFrc][nDenseVector].updRow(frame_num) = 
+                    ~frc.getOutputValue<SimTK::Vector>(s, output_name);
+                nDenseVector++;
+            }
             nFrc++;
         }
     }
@@ -1060,9 +1082,22 @@ int JointMechanicsTool::printResults(const std::string &aBaseName,const std::str
     return(0);
 }
 
+void JointMechanicsTool::addContactOutputVectorName(
+    const std::string& output_name)
+{
+    //Only the per triangle outputs are stored sparsely, the other Vector
+    //outputs (e.g. the regional outputs) are stored dense
+    if (output_name.find("_triangle_") != std::string::npos) {
+        _contact_output_vector_double_names.push_back(output_name);
+    }
+    else {
+        _contact_output_dense_vector_names.push_back(output_name);
+    }
+}
+
 void JointMechanicsTool::collectMeshContactOutputData(
     const std::string& mesh_name,
-    std::vector<SimTK::Matrix>& triData,
+    std::vector<SparseRowMatrix>& triData,
     std::vector<std::string>& triDataNames,
     std::vector<SimTK::Matrix>& vertexData,
     std::vector<std::string>& vertexDataNames) {
@@ -1121,7 +1156,7 @@ void JointMechanicsTool::collectMeshContactOutputData(
                 //Combined data for all contacts visualized on one mesh
                 int data_index;
                 if (contains_string(triDataNames, output_name, data_index)) {
-                    triData[data_index] += _contact_output_vector_double_values[nFrc][nVectorDouble];
+                    triData[data_index].add(_contact_output_vector_double_values[nFrc][nVectorDouble]);
                 }
                 else {
                     triDataNames.push_back(output_name);
@@ -1136,11 +1171,13 @@ void JointMechanicsTool::collectMeshContactOutputData(
             || getProperty_contact_mesh_properties().findIndex("all") != -1)
             && !contains_string(triDataNames, "triangle.thickness")) {
 
-            SimTK::Matrix thickness_matrix(_n_frames, mesh.getNumFaces());
+            SimTK::Vector thickness(mesh.getNumFaces());
+            for (int j = 0; j < mesh.getNumFaces(); ++j) {
+                thickness(j) = mesh.getTriangleThickness(j);
+            }
+            SparseRowMatrix thickness_matrix(mesh.getNumFaces());
             for (int i = 0; i < _n_frames; ++i) {
-                for (int j = 0; j < mesh.getNumFaces(); ++j) {
-                    thickness_matrix(i, j) = mesh.getTriangleThickness(j);
-                }
+                thickness_matrix.appendRow(thickness);
             }
             triDataNames.push_back("triangle.thickness");
             triData.push_back(thickness_matrix);
@@ -1150,11 +1187,13 @@ void JointMechanicsTool::collectMeshContactOutputData(
             || getProperty_contact_mesh_properties().findIndex("all") != -1)
             && !contains_string(triDataNames, "triangle.elastic_modulus")) {
 
-            SimTK::Matrix E_matrix(_n_frames, mesh.getNumFaces());
+            SimTK::Vector E(mesh.getNumFaces());
+            for (int j = 0; j < mesh.getNumFaces(); ++j) {
+                E(j) = mesh.getTriangleElasticModulus(j);
+            }
+            SparseRowMatrix E_matrix(mesh.getNumFaces());
             for (int i = 0; i < _n_frames; ++i) {
-                for (int j = 0; j < mesh.getNumFaces(); ++j) {
-                    E_matrix(i, j) = mesh.getTriangleElasticModulus(j);
-                }
+                E_matrix.appendRow(E);
             }
             triDataNames.push_back("triangle.elastic_modulus");
             triData.push_back(E_matrix);
@@ -1164,11 +1203,13 @@ void JointMechanicsTool::collectMeshContactOutputData(
             || getProperty_contact_mesh_properties().findIndex("all") != -1)
             && !contains_string(triDataNames, "triangle.poissons_ratio")) {
 
-            SimTK::Matrix v_matrix(_n_frames, mesh.getNumFaces());
+            SimTK::Vector v(mesh.getNumFaces());
+            for (int j = 0; j < mesh.getNumFaces(); ++j) {
+                v(j) = mesh.getTrianglePoissonsRatio(j);
+            }
+            SparseRowMatrix v_matrix(mesh.getNumFaces());
             for (int i = 0; i < _n_frames; ++i) {
-                for (int j = 0; j < mesh.getNumFaces(); ++j) {
-                    v_matrix(i, j) = mesh.getTrianglePoissonsRatio(j);
-                }
+                v_matrix.appendRow(v);
             }
             triDataNames.push_back("triangle.poissons_ratio");
             triData.push_back(v_matrix);
@@ -1178,9 +1219,9 @@ void JointMechanicsTool::collectMeshContactOutputData(
             || getProperty_contact_mesh_properties().findIndex("all") != -1)
             && !contains_string(triDataNames, "triangle.area")) {
 
-            SimTK::Matrix area_matrix(_n_frames, mesh.getNumFaces());
+            SparseRowMatrix area_matrix(mesh.getNumFaces());
             for (int i = 0; i < _n_frames; ++i) {
-                area_matrix[i] = ~mesh.getTriangleAreas();
+                area_matrix.appendRow(mesh.getTriangleAreas());
             }
             triDataNames.push_back("triangle.area");
             triData.push_back(area_matrix);
@@ -1202,7 +1243,8 @@ void JointMechanicsTool::writeVTPFile(const std::string& mesh_path,
     std::string origin = split_string(get_output_origin(), "/").back();
 
     //Collect data
-    std::vector<SimTK::Matrix> triData, vertexData;
+    std::vector<SparseRowMatrix> triData;
+    std::vector<SimTK::Matrix> vertexData;
     std::vector<std::string> triDataNames, vertexDataNames;
 
     collectMeshContactOutputData(mesh_name,
@@ -1225,7 +1267,7 @@ void JointMechanicsTool::writeVTPFile(const std::string& mesh_path,
         mesh_vtp->setDataFormat("binary");	
         //mesh_vtp->setDataFormat("ascii");
         for (int i = 0; i < triDataNames.size(); ++i) {
-            mesh_vtp->appendFaceData(triDataNames[i], ~triData[i][frame_num]);
+            mesh_vtp->appendFaceData(triDataNames[i], triData[i].getRowAsDense(frame_num));
         }
 
 
@@ -1377,9 +1419,28 @@ void JointMechanicsTool::writeH5File(
             _contact_force_names, 
             _contact_output_vec3_names, _contact_output_vec3_values);
 
+        if (get_h5_sparse_contact_data()) {
+            h5_adapter.writeComponentGroupDataSetSparse("Smith2018ArticularContactForce",
+                _contact_force_names, 
+                _contact_output_vector_double_names, _contact_output_vector_double_values);
+        }
+        else {
+            std::vector<std::vector<SimTK::Matrix>> dense_values;
+            for (const auto& frc_values : _contact_output_vector_double_values) {
+                std::vector<SimTK::Matrix> frc_dense_values;
+                for (const SparseRowMatrix& values : frc_values) {
+                    frc_dense_values.push_back(values.getAsDense());
+                }
+                dense_values.push_back(frc_dense_values);
+            }
+            h5_adapter.writeComponentGroupDataSetVector("Smith2018ArticularContactForce",
+                _contact_force_names, 
+                _contact_output_vector_double_names, dense_values);
+        }
+
         h5_adapter.writeComponentGroupDataSetVector("Smith2018ArticularContactForce",
             _contact_force_names, 
-            _contact_output_vector_double_names, _contact_output_vector_double_values);
+            _contact_output_dense_vector_names, _contact_output_dense_vector_values);
 
         //h5_adapter.writeComponentGroupDataSet("Smith2018ArticularContactForce",_contact_force_names, _contact_output_double_names, _contact_output_double_values);
         /*std::string contact_path = "/Smith2018ArticularContactForce";
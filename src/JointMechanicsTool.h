@@ -20,6 +20,7 @@
 #include <OpenSim/Simulation/Model/Model.h>
 #include "Smith2018ArticularContactForce.h"
 #include "H5FileAdapter.h"
+#include "SparseRowMatrix.h"
 #include "osimPluginDLL.h"
 #include "H5Cpp.h"
 #include "hdf5_hl.h"
@@ -177,6 +178,12 @@ public:
     OpenSim_DECLARE_PROPERTY(h5_kinematics_data, bool,
         "Write kinematics data to .h5 file")
 
+    OpenSim_DECLARE_PROPERTY(h5_sparse_contact_data, bool,
+        "Write the per triangle contact outputs (e.g. triangle_pressure) to "
+        "the .h5 file in compressed sparse row format (row_offsets, "
+        "column_index, values) rather than as a dense [nFrames x nTriangles] "
+        "matrix. The default value is false.")
+
     OpenSim_DECLARE_UNNAMED_PROPERTY(AnalysisSet,"Analyses to be performed "
         "during forward simulation.")
 
@@ -224,8 +231,9 @@ private:
     std::string findMeshFile(const std::string& file);
 
     void getGeometryPathPoints(const SimTK::State& s, const GeometryPath& geoPath, SimTK::Vector_<SimTK::Vec3>& path_points, int& nPoints);
+    void addContactOutputVectorName(const std::string& output_name);
     void collectMeshContactOutputData(const std::string& mesh_name,
-        std::vector<SimTK::Matrix>& faceData, std::vector<std::string>& faceDataNames,
+        std::vector<SparseRowMatrix>& faceData, std::vector<std::string>& faceDataNames,
         std::vector<SimTK::Matrix>& pointData, std::vector<std::string>& pointDataNames);
 //=============================================================================
 // DATA
@@ -254,7 +262,9 @@ private:
     std::vector<std::string> _contact_output_vector_double_names;
     std::vector<SimTK::Matrix> _contact_output_double_values;
     std::vector<SimTK::Matrix_<SimTK::Vec3>> _contact_output_vec3_values;
-    std::vector<std::vector<SimTK::Matrix>> _contact_output_vector_double_values;
+    std::vector<std::vector<SparseRowMatrix>> _contact_output_vector_double_values;
+    std::vector<std::string> _contact_output_dense_vector_names;
+    std::vector<std::vector<SimTK::Matrix>> _contact_output_dense_vector_values;
 
     std::vector<std::string> _attach_geo_names;
     std::vector<std::string> _attach_geo_frames;
@@ -0,0 +1,398 @@
+/* -------------------------------------------------------------------------- *
+ *                        PolynomialPathSurrogate.cpp                         *
+ * -------------------------------------------------------------------------- *
+ * Author(s): Colin Smith                                                     *
+ *                                                                            *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may    *
+ * not use this file except in compliance with the License. You may obtain a  *
+ * copy of the License at http://www.apache.org/licenses/LICENSE-2.0.         *
+ *                                                                            *
+ * Unless required by applicable law or agreed to in writing, software        *
+ * distributed under the License is distributed on an "AS IS" BASIS,          *
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.   *
+ * See the License for the specific language governing permissions and        *
+ * limitations under the License.                                             *
+ * -------------------------------------------------------------------------- */
+
+#include "PolynomialPathSurrogate.h"
+#include <fstream>
+#include <iomanip>
+#include <random>
+
+using namespace OpenSim;
+
+PolynomialPathSurrogate::PolynomialPathSurrogate() :
+    _fitted(false), _signature(0), _order(0),
+    _rms_error(0.0), _max_error(0.0)
+{
+}
+
+void PolynomialPathSurrogate::generateTerms(int nCoord, int order)
+{
+    _term_offsets.assign(1, 0);
+    _term_vars.clear();
+    _term_exps.clear();
+
+    //Enumerate all exponent combinations with total degree <= order
+    std::vector<int> exps(nCoord, 0);
+    while (true) {
+        for (int i = 0; i < nCoord; ++i) {
+            if (exps[i] > 0) {
+                _term_vars.push_back(i);
+                _term_exps.push_back(exps[i]);
+            }
+        }
+        _term_offsets.push_back(static_cast<int>(_term_vars.size()));
+
+        //Next combination (odometer with a total degree limit)
+        int i = 0;
+        for (; i < nCoord; ++i) {
+            exps[i]++;
+            int degree = 0;
+            for (int e : exps) degree += e;
+            if (degree <= order) break;
+            exps[i] = 0;
+        }
+        if (i == nCoord) break;
+    }
+}
+
+void PolynomialPathSurrogate::fit(const Model& model,
+    const GeometryPath& path, const SimTK::State& state, int order,
+    int num_samples, std::uint64_t signature)
+{
+    const SimTK::MultibodySystem& system = model.getMultibodySystem();
+    SimTK::State s = state;
+
+    std::vector<const Coordinate*> all_coords;
+    std::vector<double> range_min;
+    std::vector<double> range_max;
+    for (const Coordinate& coord : model.getComponentList<Coordinate>()) {
+        all_coords.push_back(&coord);
+
+        //Guard against unbounded ranges
+        double value = coord.getValue(s);
+        double min = coord.getRangeMin();
+        double max = coord.getRangeMax();
+        if (!(max - min < 1e6)) {
+            min = value - 1.0;
+            max = value + 1.0;
+        }
+        range_min.push_back(min);
+        range_max.push_back(max);
+    }
+    int nAllCoord = static_cast<int>(all_coords.size());
+
+    std::mt19937 generator(5489u);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+
+    //Find the spanned coordinates by perturbing each coordinate at the
+    //input pose and a random pose. Locks are ignored, setValue() without
+    //enforcing the constraints moves locked coordinates too, so the result
+    //only depends on the path geometry.
+    std::vector<bool> spanned(nAllCoord, false);
+    std::vector<double> q0(nAllCoord);
+    for (int i = 0; i < nAllCoord; ++i) {
+        q0[i] = all_coords[i]->getValue(s);
+    }
+
+    for (int pose = 0; pose < 2; ++pose) {
+        for (int i = 0; i < nAllCoord; ++i) {
+            double value = q0[i];
+            if (pose > 0) {
+                value = range_min[i] +
+                    uniform(generator) * (range_max[i] - range_min[i]);
+            }
+            all_coords[i]->setValue(s, value, false);
+        }
+        system.realize(s, SimTK::Stage::Position);
+        double length = path.getLength(s);
+
+        for (int i = 0; i < nAllCoord; ++i) {
+            if (spanned[i]) continue;
+
+            double value = all_coords[i]->getValue(s);
+            double delta = 1e-4 * (range_max[i] - range_min[i]);
+            all_coords[i]->setValue(s, value + delta, false);
+            system.realize(s, SimTK::Stage::Position);
+
+            if (std::abs(path.getLength(s) - length) > 1e-10) {
+                spanned[i] = true;
+            }
+            all_coords[i]->setValue(s, value, false);
+        }
+    }
+
+    //Reset the pose
+    for (int i = 0; i < nAllCoord; ++i) {
+        all_coords[i]->setValue(s, q0[i], false);
+    }
+
+    _coord_paths.clear();
+    _center.clear();
+    _inv_half_range.clear();
+    std::vector<int> coord_index;
+    for (int i = 0; i < nAllCoord; ++i) {
+        if (!spanned[i]) continue;
+        coord_index.push_back(i);
+        _coord_paths.push_back(all_coords[i]->getAbsolutePathString());
+        _center.push_back(0.5 * (range_max[i] + range_min[i]));
+        _inv_half_range.push_back(2.0 / (range_max[i] - range_min[i]));
+    }
+    int nCoord = static_cast<int>(_coord_paths.size());
+
+    _order = order;
+    generateTerms(nCoord, order);
+    int nTerms = static_cast<int>(_term_offsets.size()) - 1;
+    _coefficients.assign(nTerms, 0.0);
+    _powers.resize(nCoord * (_order + 1));
+    _dldx.resize(nCoord);
+    _q.resize(nCoord);
+
+    int nSamples = num_samples > 0 ? num_samples : 3 * nTerms;
+    OPENSIM_THROW_IF(nSamples < nTerms, Exception,
+        "PolynomialPathSurrogate: number of samples (" +
+        std::to_string(nSamples) + ") must be at least the number of "
+        "polynomial terms (" + std::to_string(nTerms) + ").")
+
+    int nValidation = std::max(50, nSamples / 5);
+
+    //Sample the exact path length at random poses
+    auto samplePoses = [&](int n, SimTK::Matrix& x, SimTK::Vector& length) {
+        x.resize(n, nCoord);
+        length.resize(n);
+        for (int k = 0; k < n; ++k) {
+            for (int j = 0; j < nCoord; ++j) {
+                int i = coord_index[j];
+                double value = range_min[i] +
+                    uniform(generator) * (range_max[i] - range_min[i]);
+                all_coords[i]->setValue(s, value, false);
+                x(k, j) = value;
+            }
+            system.realize(s, SimTK::Stage::Position);
+            length(k) = path.getLength(s);
+        }
+    };
+
+    SimTK::Matrix fit_q;
+    SimTK::Vector fit_length;
+    samplePoses(nSamples, fit_q, fit_length);
+
+    //Least squares fit of the coefficients
+    SimTK::Matrix A(nSamples, nTerms);
+    SimTK::Vector coefs(nTerms, 0.0);
+    for (int k = 0; k < nSamples; ++k) {
+        SimTK::Vector q = ~fit_q[k];
+        calcPowers(q);
+        for (int t = 0; t < nTerms; ++t) {
+            A(k, t) = calcMonomial(t);
+        }
+    }
+    SimTK::FactorQTZ qtz(A);
+    qtz.solve(fit_length, coefs);
+
+    for (int t = 0; t < nTerms; ++t) {
+        _coefficients[t] = coefs(t);
+    }
+
+    //Fit error against the exact path at new poses
+    SimTK::Matrix val_q;
+    SimTK::Vector val_length;
+    samplePoses(nValidation, val_q, val_length);
+
+    double sum_sq = 0.0;
+    _max_error = 0.0;
+    for (int k = 0; k < nValidation; ++k) {
+        SimTK::Vector q = ~val_q[k];
+        double error = std::abs(calcLength(q, nullptr) - val_length(k));
+        sum_sq += error * error;
+        _max_error = std::max(_max_error, error);
+    }
+    _rms_error = std::sqrt(sum_sq / nValidation);
+
+    _signature = signature;
+    _fitted = true;
+    connectToModel(model);
+}
+
+void PolynomialPathSurrogate::connectToModel(const Model& model)
+{
+    _coords.clear();
+    for (const std::string& path : _coord_paths) {
+        _coords.push_back(SimTK::ReferencePtr<const Coordinate>(
+            model.getComponent<Coordinate>(path)));
+    }
+}
+
+int PolynomialPathSurrogate::findCoordinateIndex(
+    const Coordinate& coord) const
+{
+    for (int i = 0; i < getNumCoordinates(); ++i) {
+        if (_coords[i].get() == &coord) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void PolynomialPathSurrogate::calcPowers(const SimTK::Vector& q) const
+{
+    int nPow = _order + 1;
+
+    for (int i = 0; i < getNumCoordinates(); ++i) {
+        double x = (q(i) - _center[i]) * _inv_half_range[i];
+        double* pow = &_powers[i * nPow];
+        pow[0] = 1.0;
+        for (int e = 1; e < nPow; ++e) {
+            pow[e] = pow[e - 1] * x;
+        }
+    }
+}
+
+double PolynomialPathSurrogate::calcMonomial(int t) const
+{
+    int nPow = _order + 1;
+
+    double value = 1.0;
+    for (int k = _term_offsets[t]; k < _term_offsets[t + 1]; ++k) {
+        value *= _powers[_term_vars[k] * nPow + _term_exps[k]];
+    }
+    return value;
+}
+
+double PolynomialPathSurrogate::calcLength(const SimTK::Vector& q,
+    SimTK::Vector* dldq) const
+{
+    int nCoord = getNumCoordinates();
+    int nPow = _order + 1;
+
+    calcPowers(q);
+    for (int i = 0; i < nCoord; ++i) {
+        _dldx[i] = 0.0;
+    }
+
+    double length = 0.0;
+    int nTerms = static_cast<int>(_coefficients.size());
+
+    for (int t = 0; t < nTerms; ++t) {
+        int begin = _term_offsets[t];
+        int end = _term_offsets[t + 1];
+        double coef = _coefficients[t];
+
+        length += coef * calcMonomial(t);
+
+        if (dldq == nullptr) continue;
+
+        for (int k = begin; k < end; ++k) {
+            double deriv = coef * _term_exps[k] *
+                _powers[_term_vars[k] * nPow + _term_exps[k] - 1];
+            for (int m = begin; m < end; ++m) {
+                if (m == k) continue;
+                deriv *= _powers[_term_vars[m] * nPow + _term_exps[m]];
+            }
+            _dldx[_term_vars[k]] += deriv;
+        }
+    }
+
+    if (dldq != nullptr) {
+        for (int i = 0; i < nCoord; ++i) {
+            (*dldq)(i) = _dldx[i] * _inv_half_range[i];
+        }
+    }
+    return length;
+}
+
+double PolynomialPathSurrogate::calcLength(const SimTK::State& state,
+    SimTK::Vector& dldq) const
+{
+    for (int i = 0; i < getNumCoordinates(); ++i) {
+        _q(i) = _coords[i]->getValue(state);
+    }
+    return calcLength(_q, &dldq);
+}
+
+void PolynomialPathSurrogate::write(const std::string& file) const
+{
+    std::ofstream out(file);
+    OPENSIM_THROW_IF(!out.is_open(), Exception,
+        "PolynomialPathSurrogate: could not open " + file)
+
+    out << std::setprecision(17);
+    out << "PolynomialPathSurrogate" << "\n";
+    out << "signature " << _signature << "\n";
+    out << "order " << _order << "\n";
+    out << "coordinates " << getNumCoordinates() << "\n";
+    for (int i = 0; i < getNumCoordinates(); ++i) {
+        out << _coord_paths[i] << " " << _center[i] << " " <<
+            _inv_half_range[i] << "\n";
+    }
+    out << "terms " << getNumTerms() << "\n";
+    for (int t = 0; t < getNumTerms(); ++t) {
+        out << _coefficients[t] << " " <<
+            _term_offsets[t + 1] - _term_offsets[t];
+        for (int k = _term_offsets[t]; k < _term_offsets[t + 1]; ++k) {
+            out << " " << _term_vars[k] << " " << _term_exps[k];
+        }
+        out << "\n";
+    }
+    out << "rms_error " << _rms_error << "\n";
+    out << "max_error " << _max_error << "\n";
+    out.close();
+}
+
+bool PolynomialPathSurrogate::read(const std::string& file,
+    std::uint64_t signature)
+{
+    std::ifstream in(file);
+    if (!in.is_open()) {
+        return false;
+    }
+
+    std::string header, label;
+    std::uint64_t file_signature;
+    in >> header >> label >> file_signature;
+    if (header != "PolynomialPathSurrogate" || file_signature != signature) {
+        return false;
+    }
+
+    int nCoord, nTerms;
+    in >> label >> _order;
+    in >> label >> nCoord;
+    _coord_paths.resize(nCoord);
+    _center.resize(nCoord);
+    _inv_half_range.resize(nCoord);
+    for (int i = 0; i < nCoord; ++i) {
+        in >> _coord_paths[i] >> _center[i] >> _inv_half_range[i];
+    }
+
+    in >> label >> nTerms;
+    _coefficients.resize(nTerms);
+    _term_offsets.assign(1, 0);
+    _term_vars.clear();
+    _term_exps.clear();
+    for (int t = 0; t < nTerms; ++t) {
+        int nVar;
+        in >> _coefficients[t] >> nVar;
+        for (int k = 0; k < nVar; ++k) {
+            int var, exp;
+            in >> var >> exp;
+            _term_vars.push_back(var);
+            _term_exps.push_back(exp);
+        }
+        _term_offsets.push_back(static_cast<int>(_term_vars.size()));
+    }
+    in >> label >> _rms_error;
+    in >> label >> _max_error;
+
+    if (in.fail()) {
+        _fitted = false;
+        return false;
+    }
+
+    _powers.resize(nCoord * (_order + 1));
+    _dldx.resize(nCoord);
+    _q.resize(nCoord);
+    _signature = signature;
+    _fitted = true;
+    return true;
+}
@@ -0,0 +1,128 @@
+#ifndef OPENSIM_POLYNOMIAL_PATH_SURROGATE_H_
+#define OPENSIM_POLYNOMIAL_PATH_SURROGATE_H_
+/* -------------------------------------------------------------------------- *
+ *                         PolynomialPathSurrogate.h                          *
+ * -------------------------------------------------------------------------- *
+ * Author(s): Colin Smith                                                     *
+ *                                                                            *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may    *
+ * not use this file except in compliance with the License. You may obtain a  *
+ * copy of the License at http://www.apache.org/licenses/LICENSE-2.0.         *
+ *                                                                            *
+ * Unless required by applicable law or agreed to in writing, software        *
+ * distributed under the License is distributed on an "AS IS" BASIS,          *
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.   *
+ * See the License for the specific language governing permissions and        *
+ * limitations under the License.                                             *
+ * -------------------------------------------------------------------------- */
+
+//=============================================================================
+//                         PolynomialPathSurrogate
+//=============================================================================
+/**
+This class approximates the length of a GeometryPath as a multivariate
+polynomial of the coordinates that the path spans. Evaluating the full path
+(including wrapping surfaces) is expensive, while the polynomial and its
+analytical derivatives (dL/dq, i.e. the negative moment arms) can be
+evaluated with a few multiplications.
+
+The spanned coordinates are detected from the path geometry: each coordinate
+in the model is perturbed (whether or not it is locked in the input state)
+and checked for a change in path length. The polynomial contains all
+monomials of the spanned coordinates up to the total degree set by order.
+Each coordinate is normalized to [-1, 1] over its range, and the
+coefficients are fit by least squares to path lengths computed at randomly
+sampled poses within the coordinate ranges. The remaining coordinates are
+held at their values in the input state. The fit error is computed against
+the exact path length at a separate set of random poses.
+
+The fit can be written to and read from a text file. The file stores a
+signature (e.g. a stable hash of the path definition and fit settings) so 
+that a stale file is not used.
+
+@author Colin Smith
+*/
+
+#include <OpenSim/Simulation/Model/Model.h>
+#include <OpenSim/Simulation/Model/GeometryPath.h>
+#include "osimPluginDLL.h"
+#include <cstdint>
+#include <vector>
+
+namespace OpenSim {
+
+    class OSIMPLUGIN_API PolynomialPathSurrogate {
+    public:
+        PolynomialPathSurrogate();
+
+        /** Fit the polynomial to the length of path. state provides the
+        values of the coordinates that are not spanned by the path. */
+        void fit(const Model& model, const GeometryPath& path,
+            const SimTK::State& state, int order, int num_samples,
+            std::uint64_t signature);
+
+        bool isFitted() const { return _fitted; }
+        std::uint64_t getSignature() const { return _signature; }
+
+        /** Write the fit to file. */
+        void write(const std::string& file) const;
+
+        /** Read a fit from file. Returns false if the file does not exist
+        or was generated with a different signature. */
+        bool read(const std::string& file, std::uint64_t signature);
+
+        /** Resolve the spanned coordinates in model, must be called after
+        copying or reading the surrogate. */
+        void connectToModel(const Model& model);
+
+        int getNumCoordinates() const {
+            return static_cast<int>(_coord_paths.size());
+        }
+        const Coordinate& getCoordinate(int i) const { return *_coords[i]; }
+
+        /** Index of the coordinate in the surrogate, -1 if it is not
+        spanned by the path. */
+        int findCoordinateIndex(const Coordinate& coord) const;
+
+        int getNumTerms() const { return static_cast<int>(_coefficients.size()); }
+        double getRMSError() const { return _rms_error; }
+        double getMaxError() const { return _max_error; }
+
+        /** Compute the path length and its derivative with respect to each
+        spanned coordinate (dldq must be sized getNumCoordinates()). */
+        double calcLength(const SimTK::State& state, SimTK::Vector& dldq) const;
+
+    private:
+        void generateTerms(int nCoord, int order);
+        void calcPowers(const SimTK::Vector& q) const;
+        double calcMonomial(int t) const;
+        double calcLength(const SimTK::Vector& q, SimTK::Vector* dldq) const;
+
+        bool _fitted;
+        std::uint64_t _signature;
+        int _order;
+
+        std::vector<std::string> _coord_paths;
+        std::vector<SimTK::ReferencePtr<const Coordinate>> _coords;
+        std::vector<double> _center;
+        std::vector<double> _inv_half_range;
+
+        //Monomials stored sparsely: the variables and exponents of term t are
+        //stored from _term_offsets[t] to _term_offsets[t+1]-1
+        std::vector<int> _term_offsets;
+        std::vector<int> _term_vars;
+        std::vector<int> _term_exps;
+        std::vector<double> _coefficients;
+
+        double _rms_error;
+        double _max_error;
+
+        //Scratch storage so the evaluation does not allocate
+        mutable std::vector<double> _powers;
+        mutable std::vector<double> _dldx;
+        mutable SimTK::Vector _q;
+    };
+
+} // namespace OpenSim
+
+#endif // OPENSIM_POLYNOMIAL_PATH_SURROGATE_H_
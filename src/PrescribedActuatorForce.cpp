@@ -0,0 +1,104 @@
+/* -------------------------------------------------------------------------- *
+ *                        PrescribedActuatorForce.cpp                         *
+ * -------------------------------------------------------------------------- *
+ * Author(s): Colin Smith                                                     *
+ *                                                                            *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may    *
+ * not use this file except in compliance with the License. You may obtain a  *
+ * copy of the License at http://www.apache.org/licenses/LICENSE-2.0.         *
+ *                                                                            *
+ * Unless required by applicable law or agreed to in writing, software        *
+ * distributed under the License is distributed on an "AS IS" BASIS,          *
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.   *
+ * See the License for the specific language governing permissions and        *
+ * limitations under the License.                                             *
+ * -------------------------------------------------------------------------- */
+
+#include "PrescribedActuatorForce.h"
+#include <OpenSim/Simulation/Model/PathActuator.h>
+#include <OpenSim/Actuators/CoordinateActuator.h>
+#include <OpenSim/Common/Constant.h>
+
+using namespace OpenSim;
+
+//=============================================================================
+// CONSTRUCTOR
+//=============================================================================
+PrescribedActuatorForce::PrescribedActuatorForce() : Force(), _time(1, 0.0)
+{
+    constructProperties();
+}
+
+PrescribedActuatorForce::PrescribedActuatorForce(const std::string& name,
+    const ScalarActuator& actuator, const Function& force_function) :
+    Force(), _time(1, 0.0)
+{
+    constructProperties();
+    setName(name);
+    set_force_function(force_function);
+    connectSocket_actuator(actuator);
+}
+
+void PrescribedActuatorForce::constructProperties()
+{
+    constructProperty_force_function(Constant(0.0));
+}
+
+void PrescribedActuatorForce::extendConnectToModel(Model& model)
+{
+    Super::extendConnectToModel(model);
+
+    const ScalarActuator& actuator = getConnectee<ScalarActuator>("actuator");
+    const CoordinateActuator* coord_actuator =
+        dynamic_cast<const CoordinateActuator*>(&actuator);
+
+    OPENSIM_THROW_IF(!dynamic_cast<const PathActuator*>(&actuator) &&
+        !(coord_actuator && coord_actuator->getCoordinate() != nullptr),
+        Exception, getName() + ": actuator " + actuator.getName() +
+        " is not a PathActuator or a CoordinateActuator with a coordinate.");
+}
+
+//=============================================================================
+// COMPUTATION
+//=============================================================================
+double PrescribedActuatorForce::getForce(const SimTK::State& state) const
+{
+    _time[0] = state.getTime();
+    return get_force_function().calcValue(_time);
+}
+
+void PrescribedActuatorForce::computeForce(const SimTK::State& s,
+    SimTK::Vector_<SimTK::SpatialVec>& bodyForces,
+    SimTK::Vector& generalizedForces) const
+{
+    double force = getForce(s);
+    const ScalarActuator& actuator = getConnectee<ScalarActuator>("actuator");
+
+    if (const PathActuator* path_actuator =
+        dynamic_cast<const PathActuator*>(&actuator)) {
+        path_actuator->getGeometryPath().addInEquivalentForces(
+            s, force, bodyForces, generalizedForces);
+    }
+    else {
+        const CoordinateActuator& coord_actuator =
+            static_cast<const CoordinateActuator&>(actuator);
+        applyGeneralizedForce(s, *coord_actuator.getCoordinate(),
+            force, generalizedForces);
+    }
+}
+
+//=============================================================================
+// REPORTING
+//=============================================================================
+OpenSim::Array<std::string> PrescribedActuatorForce::getRecordLabels() const {
+    OpenSim::Array<std::string> labels("");
+    labels.append(getName());
+    return labels;
+}
+
+OpenSim::Array<double> PrescribedActuatorForce::getRecordValues(
+    const SimTK::State& state) const {
+    OpenSim::Array<double> values(1);
+    values.append(getForce(state));
+    return values;
+}
@@ -0,0 +1,104 @@
+#ifndef OPENSIM_PRESCRIBED_ACTUATOR_FORCE_H_
+#define OPENSIM_PRESCRIBED_ACTUATOR_FORCE_H_
+/* -------------------------------------------------------------------------- *
+ *                         PrescribedActuatorForce.h                          *
+ * -------------------------------------------------------------------------- *
+ * Author(s): Colin Smith                                                     *
+ *                                                                            *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may    *
+ * not use this file except in compliance with the License. You may obtain a  *
+ * copy of the License at http://www.apache.org/licenses/LICENSE-2.0.         *
+ *                                                                            *
+ * Unless required by applicable law or agreed to in writing, software        *
+ * distributed under the License is distributed on an "AS IS" BASIS,          *
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.   *
+ * See the License for the specific language governing permissions and        *
+ * limitations under the License.                                             *
+ * -------------------------------------------------------------------------- */
+
+#include "osimPluginDLL.h"
+#include <OpenSim/Simulation/Model/Force.h>
+#include <OpenSim/Simulation/Model/Actuator.h>
+#include <OpenSim/Common/Function.h>
+
+namespace OpenSim {
+
+//=============================================================================
+//                         PrescribedActuatorForce
+//=============================================================================
+/**
+Apply a time varying force through the path of a PathActuator (including
+Muscles) or through the Coordinate of a CoordinateActuator. The force is
+computed from force_function at the time of the state, so it is evaluated
+inside the system like any other Force and the integrator can step
+continuously while the prescribed force changes.
+
+The actuator itself is not disabled by this component, set its appliesForce
+property to false so that only the prescribed force is applied. The outputs
+and record values of the actuator (e.g. actuation, tendon_force and the
+ForceReporter column of a Muscle) still report the force computed by the
+actuator model, not the applied force. The applied force is reported by the
+force output and the record value of this component.
+
+@author Colin Smith
+*/
+
+class OSIMPLUGIN_API PrescribedActuatorForce : public Force {
+OpenSim_DECLARE_CONCRETE_OBJECT(PrescribedActuatorForce, Force)
+
+public:
+//=============================================================================
+// PROPERTIES
+//=============================================================================
+    OpenSim_DECLARE_PROPERTY(force_function, Function,
+        "The actuator force (or torque for a rotational CoordinateActuator) "
+        "as a function of time.")
+
+//=============================================================================
+// SOCKETS
+//=============================================================================
+    OpenSim_DECLARE_SOCKET(actuator, ScalarActuator,
+        "The PathActuator or CoordinateActuator the force is applied through.");
+
+//=============================================================================
+// OUTPUTS
+//=============================================================================
+    OpenSim_DECLARE_OUTPUT(force, double, getForce, SimTK::Stage::Time);
+
+//=============================================================================
+// METHODS
+//=============================================================================
+public:
+    PrescribedActuatorForce();
+
+    PrescribedActuatorForce(const std::string& name,
+        const ScalarActuator& actuator, const Function& force_function);
+
+    double getForce(const SimTK::State& state) const;
+
+    void computeForce(const SimTK::State& s,
+        SimTK::Vector_<SimTK::SpatialVec>& bodyForces,
+        SimTK::Vector& generalizedForces) const override;
+
+    //-------------------------------------------------------------------------
+    // REPORTING
+    //-------------------------------------------------------------------------
+    OpenSim::Array<std::string> getRecordLabels() const override;
+    OpenSim::Array<double> getRecordValues(
+        const SimTK::State& state) const override;
+
+protected:
+    void extendConnectToModel(Model& model) override;
+
+private:
+    void constructProperties();
+
+    // Argument of force_function, reused so getForce() does not allocate
+    mutable SimTK::Vector _time;
+
+//=============================================================================
+};  // END of class PrescribedActuatorForce
+
+}; //namespace
+
+#endif // OPENSIM_PRESCRIBED_ACTUATOR_FORCE_H_
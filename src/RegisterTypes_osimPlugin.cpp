@@ -25,12 +25,16 @@
 #include <OpenSim/Common/Object.h>
 #include "RegisterTypes_osimPlugin.h"
 #include "Blankevoort1991Ligament.h"
+#include "Blankevoort1991LigamentSet.h"
+#include "PrescribedActuatorForce.h"
 #include "Smith2018ContactMesh.h"
 #include "Smith2018ArticularContactForce.h"
 #include "JointMechanicsTool.h"
 #include "ForsimTool.h"
 #include "COMAKTool.h"
+#include "COMAKBatchTool.h"
 #include "COMAKInverseKinematicsTool.h"
+#include "ContactMeshConvergenceTool.h"
 using namespace OpenSim;
 using namespace std;
 
@@ -44,6 +48,8 @@ static dllObjectInstantiator instantiator;
 OSIMPLUGIN_API void RegisterTypes_osimPlugin()
 {
     Object::registerType(Blankevoort1991Ligament());
+    Object::registerType(Blankevoort1991LigamentSet());
+    Object::registerType(PrescribedActuatorForce());
     Object::registerType(Smith2018ContactMesh());
     Object::registerType(Smith2018ArticularContactForce());
     Object::registerType(JointMechanicsTool());
@@ -53,7 +59,9 @@ OSIMPLUGIN_API void RegisterTypes_osimPlugin()
     Object::registerType(COMAKSecondaryCoordinateSet());
     Object::registerType(COMAKCostFunctionParameter());
     Object::registerType(COMAKCostFunctionParameterSet());
+    Object::registerType(COMAKBatchTool());
     Object::registerType(COMAKInverseKinematicsTool());
+    Object::registerType(ContactMeshConvergenceTool());
 }
 
 dllObjectInstantiator::dllObjectInstantiator() 
@@ -0,0 +1,156 @@
+/* -------------------------------------------------------------------------- *
+ *                             STOFileStream.cpp                              *
+ * -------------------------------------------------------------------------- *
+ * Author(s): Colin Smith                                                     *
+ *                                                                            *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may    *
+ * not use this file except in compliance with the License. You may obtain a  *
+ * copy of the License at http://www.apache.org/licenses/LICENSE-2.0.         *
+ *                                                                            *
+ * Unless required by applicable law or agreed to in writing, software        *
+ * distributed under the License is distributed on an "AS IS" BASIS,          *
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.   *
+ * See the License for the specific language governing permissions and        *
+ * limitations under the License.                                             *
+ * -------------------------------------------------------------------------- */
+
+#include "STOFileStream.h"
+#include <OpenSim/Common/Exception.h>
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+using namespace OpenSim;
+
+//Width of the zero padded nRows in the header, so the row count can be
+//updated in place
+static const int NROWS_WIDTH = 10;
+
+STOFileStream::STOFileStream() :
+    _n_columns(0), _n_rows(0), _flush_interval(10)
+{
+}
+
+STOFileStream::~STOFileStream()
+{
+    close();
+}
+
+void STOFileStream::open(const std::string& file, const std::string& header,
+    const std::vector<std::string>& labels, bool in_degrees,
+    int flush_interval)
+{
+    close();
+
+    _out.open(file);
+    OPENSIM_THROW_IF(!_out, Exception,
+        "Could not open streamed results file: " + file);
+
+    _n_columns = static_cast<int>(labels.size());
+    _n_rows = 0;
+    _flush_interval = std::max(1, flush_interval);
+
+    //Same header as the STOFileAdapter, the row count is updated as rows
+    //are written
+    _out << header << std::endl;
+    _out << "version=1" << std::endl;
+    _out << "nRows=";
+    _nrows_pos = _out.tellp();
+    _out << std::setfill('0') << std::setw(NROWS_WIDTH) << 0
+        << std::setfill(' ') << std::endl;
+    _out << "nColumns=" << _n_columns + 1 << std::endl;
+    _out << "inDegrees=" << (in_degrees ? "yes" : "no") << std::endl;
+    _out << "endheader" << std::endl;
+
+    _out << "time";
+    for (const std::string& label : labels) {
+        _out << "\t" << label;
+    }
+    _out << std::endl;
+
+    _out << std::setprecision(16);
+}
+
+void STOFileStream::appendRow(double time,
+    const SimTK::RowVectorBase<double>& values)
+{
+    OPENSIM_THROW_IF(values.size() != _n_columns, Exception,
+        "STOFileStream: row has " + std::to_string(values.size()) +
+        " values, expected " + std::to_string(_n_columns) + ".");
+
+    _out << time;
+    for (int i = 0; i < values.size(); ++i) {
+        _out << "\t" << values[i];
+    }
+    _out << "\n";
+    _n_rows++;
+
+    if (_n_rows % _flush_interval == 0) {
+        updateRowCount();
+    }
+}
+
+void STOFileStream::close()
+{
+    if (!_out.is_open()) {
+        return;
+    }
+    updateRowCount();
+    _out.close();
+}
+
+void STOFileStream::updateRowCount()
+{
+    std::streampos end = _out.tellp();
+    _out.seekp(_nrows_pos);
+    _out << std::setfill('0') << std::setw(NROWS_WIDTH) << _n_rows
+        << std::setfill(' ');
+    _out.seekp(end);
+    _out.flush();
+}
+
+bool STOFileStream::readRows(const std::string& file,
+    std::vector<std::string>& labels, std::vector<double>& time,
+    std::vector<SimTK::RowVector>& rows)
+{
+    std::ifstream in(file);
+    if (!in) {
+        return false;
+    }
+
+    std::string line;
+    while (std::getline(in, line) && line != "endheader") {}
+
+    if (!std::getline(in, line)) {
+        return false;
+    }
+
+    std::istringstream label_line(line);
+    std::string label;
+    labels.clear();
+    std::getline(label_line, label, '\t'); //time
+    while (std::getline(label_line, label, '\t')) {
+        labels.push_back(label);
+    }
+
+    time.clear();
+    rows.clear();
+    int n_columns = static_cast<int>(labels.size());
+    SimTK::RowVector row(n_columns);
+
+    //Only complete rows, the last row may have been partially written
+    while (std::getline(in, line)) {
+        std::istringstream values(line);
+        double t;
+        bool complete = static_cast<bool>(values >> t);
+        for (int i = 0; i < n_columns && complete; ++i) {
+            complete = static_cast<bool>(values >> row[i]);
+        }
+        if (!complete || in.eof()) {
+            break;
+        }
+        time.push_back(t);
+        rows.push_back(row);
+    }
+    return true;
+}
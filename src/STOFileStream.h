@@ -0,0 +1,83 @@
+#ifndef OPENSIM_STO_FILE_STREAM_H_
+#define OPENSIM_STO_FILE_STREAM_H_
+/* -------------------------------------------------------------------------- *
+ *                              STOFileStream.h                               *
+ * -------------------------------------------------------------------------- *
+ * Author(s): Colin Smith                                                     *
+ *                                                                            *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may    *
+ * not use this file except in compliance with the License. You may obtain a  *
+ * copy of the License at http://www.apache.org/licenses/LICENSE-2.0.         *
+ *                                                                            *
+ * Unless required by applicable law or agreed to in writing, software        *
+ * distributed under the License is distributed on an "AS IS" BASIS,          *
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.   *
+ * See the License for the specific language governing permissions and        *
+ * limitations under the License.                                             *
+ * -------------------------------------------------------------------------- */
+
+//=============================================================================
+//                              STOFileStream
+//=============================================================================
+/**
+Write a .sto file one row at a time while the results are computed, instead of
+collecting them in a TimeSeriesTable and writing the file with the
+STOFileAdapter at the end. The header is the same as the STOFileAdapter
+writes. The nRows value is zero padded so it can be rewritten in place, this
+is done (and the file flushed) every flush_interval rows and on close(), so a
+file from an aborted run is readable up to the last flush.
+
+readRows() reads the complete rows of a streamed file, ignoring a partially
+written last row, so a run can be restarted from it.
+
+@author Colin Smith
+*/
+
+#include "osimPluginDLL.h"
+#include "SimTKcommon.h"
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace OpenSim {
+
+class OSIMPLUGIN_API STOFileStream {
+public:
+    STOFileStream();
+    ~STOFileStream();
+
+    /** Create file and write the header and column labels (without time).
+    Throws an Exception if the file cannot be opened. */
+    void open(const std::string& file, const std::string& header,
+        const std::vector<std::string>& labels, bool in_degrees = false,
+        int flush_interval = 10);
+
+    /** Append a row, the number of values must match the labels. */
+    void appendRow(double time, const SimTK::RowVectorBase<double>& values);
+
+    /** Write the final row count and close the file. */
+    void close();
+
+    bool isOpen() const { return _out.is_open(); }
+    int getNumRows() const { return _n_rows; }
+
+    /** Read the column labels (without time) and the complete rows of a .sto
+    file written by STOFileStream or the STOFileAdapter. Returns false if the
+    file cannot be read. */
+    static bool readRows(const std::string& file,
+        std::vector<std::string>& labels, std::vector<double>& time,
+        std::vector<SimTK::RowVector>& rows);
+
+private:
+    void updateRowCount();
+
+    std::ofstream _out;
+    std::streampos _nrows_pos;
+    int _n_columns;
+    int _n_rows;
+    int _flush_interval;
+};
+
+}; //namespace
+
+#endif // OPENSIM_STO_FILE_STREAM_H_
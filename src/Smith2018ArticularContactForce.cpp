@@ -34,6 +34,8 @@
 #include "Smith2018ArticularContactForce.h"
 #include "Smith2018ContactMesh.h"
 #include <cctype>
+#include <algorithm>
+#include <iterator>
 #include <OpenSim/Common/Lmdif.h>
 
 //=============================================================================
@@ -42,6 +44,39 @@
 using namespace OpenSim;
 using namespace SimTK;
 
+//=============================================================================
+// CONTACT EVENT HANDLER
+//=============================================================================
+namespace {
+/* Triggers an event when the casting mesh comes into contact or separates, 
+so the integrator localizes the contact onset/release and restarts with a 
+small step instead of discovering the contact stiffness through repeated 
+Newton failures. Changes in the contact set while the meshes stay in contact
+do not trigger events. */
+class ContactEventHandler : public SimTK::TriggeredEventHandler {
+public:
+    ContactEventHandler(const Smith2018ArticularContactForce& contact) :
+        TriggeredEventHandler(Stage::Position), _contact(contact) {
+        getTriggerInfo().setTriggerOnRisingSignTransition(true);
+        getTriggerInfo().setTriggerOnFallingSignTransition(true);
+    }
+
+    Real getValue(const State& state) const override {
+        return _contact.computeContactEventWitness(state);
+    }
+
+    void handleEvent(State& state, Real accuracy,
+        bool& shouldTerminate) const override {
+        shouldTerminate = false;
+        _contact.setDiscreteVariableValue(state, "num_contact_events",
+            _contact.getDiscreteVariableValue(state, "num_contact_events") + 1);
+    }
+
+private:
+    const Smith2018ArticularContactForce& _contact;
+};
+}
+
 //=============================================================================
 // CONSTRUCTOR(S) 
 //=============================================================================
@@ -81,6 +116,8 @@ void Smith2018ArticularContactForce::constructProperties()
     constructProperty_max_proximity(0.01);
     constructProperty_elastic_foundation_formulation("linear");
     constructProperty_use_lumped_contact_model(true);
+    constructProperty_use_contact_events(false);
+    constructProperty_proximity_cache_size(4);
 }
 
 void Smith2018ArticularContactForce::
@@ -95,12 +132,8 @@ extendAddToSystem(MultibodySystem& system) const
         getSocket<Smith2018ContactMesh>("casting_mesh").
         getConnectee().getNumFaces();
 
-    Vector target_mesh_def_vec(target_mesh_nTri);
-    Vector casting_mesh_def_vec(casting_mesh_nTri);
-    target_mesh_def_vec = -1;
-    casting_mesh_def_vec = -1;
-
-    Vector_<Vec3> casting_mesh_def_vec3(casting_mesh_nTri,Vec3(0.0));
+    //The meshes may have changed, discard the stored proximities
+    _proximity_cache.clear();
 
     std::vector<int> target_mesh_def_vector_int(target_mesh_nTri,-1);
     std::vector<int> casting_mesh_def_vector_int(casting_mesh_nTri,-1);
@@ -117,6 +150,12 @@ extendAddToSystem(MultibodySystem& system) const
         "casting.triangle.previous_contacting_triangle",
         casting_mesh_def_vector_int, Stage::LowestRuntime);
 
+    //Resolution (use_coarse_mesh) of the previous_contacting_triangle hints
+    addCacheVariable<int>("target.triangle.previous_use_coarse_mesh",
+        0, Stage::LowestRuntime);
+    addCacheVariable<int>("casting.triangle.previous_use_coarse_mesh",
+        0, Stage::LowestRuntime);
+
     //Triangles with ray intersections
     addCacheVariable<int>("target.num_active_triangles",
         0, Stage::Position);
@@ -151,25 +190,33 @@ extendAddToSystem(MultibodySystem& system) const
     addCacheVariable<int>("casting.num_contacting_triangles_different",
         0, Stage::Position);
 
-    addCacheVariable<Vector>("target.triangle.proximity",
-        target_mesh_def_vec, Stage::Position);
-    addCacheVariable<Vector>("casting.triangle.proximity",
-        casting_mesh_def_vec, Stage::Position);
+    //Per triangle data is stored sparsely, only the active triangles (those 
+    //with a ray intersection) are listed in triangle.active_index and the 
+    //active_* vectors hold the values for these triangles in the same order
+    addCacheVariable<std::vector<int>>("target.triangle.active_index",
+        std::vector<int>(), Stage::Position);
+    addCacheVariable<std::vector<int>>("casting.triangle.active_index",
+        std::vector<int>(), Stage::Position);
+
+    addCacheVariable<Vector>("target.triangle.active_proximity",
+        Vector(), Stage::Position);
+    addCacheVariable<Vector>("casting.triangle.active_proximity",
+        Vector(), Stage::Position);
     
-    addCacheVariable<Vector>("target.triangle.pressure",
-        target_mesh_def_vec, Stage::Dynamics);
-    addCacheVariable<Vector>("casting.triangle.pressure",
-        casting_mesh_def_vec, Stage::Dynamics);
+    addCacheVariable<Vector>("target.triangle.active_pressure",
+        Vector(), Stage::Dynamics);
+    addCacheVariable<Vector>("casting.triangle.active_pressure",
+        Vector(), Stage::Dynamics);
 
-    addCacheVariable<Vector>("target.triangle.potential_energy",
-        target_mesh_def_vec, Stage::Dynamics);
-    addCacheVariable<Vector>("casting.triangle.potential_energy",
-        casting_mesh_def_vec, Stage::Dynamics);
+    addCacheVariable<Vector>("target.triangle.active_potential_energy",
+        Vector(), Stage::Dynamics);
+    addCacheVariable<Vector>("casting.triangle.active_potential_energy",
+        Vector(), Stage::Dynamics);
 
-    addCacheVariable<Vector_<Vec3>>("target.triangle.force",
-        casting_mesh_def_vec3, Stage::Dynamics);
-    addCacheVariable<Vector_<Vec3>>("casting.triangle.force",
-        casting_mesh_def_vec3, Stage::Dynamics);
+    addCacheVariable<Vector_<Vec3>>("target.triangle.active_force",
+        Vector_<Vec3>(), Stage::Dynamics);
+    addCacheVariable<Vector_<Vec3>>("casting.triangle.active_force",
+        Vector_<Vec3>(), Stage::Dynamics);
 
     addCacheVariable<double>("target.total.contact_area",0, Stage::Dynamics);
     addCacheVariable<double>("target.total.mean_proximity",0, Stage::Dynamics);
@@ -195,62 +242,192 @@ extendAddToSystem(MultibodySystem& system) const
     addCacheVariable<Vec3>("casting.total.contact_force", Vec3(0), Stage::Dynamics);
     addCacheVariable<Vec3>("casting.total.contact_moment", Vec3(0), Stage::Dynamics);
 
+    int target_mesh_nReg = 
+        getSocket<Smith2018ContactMesh>("target_mesh").
+        getConnectee().getNumRegions();
+    int casting_mesh_nReg = 
+        getSocket<Smith2018ContactMesh>("casting_mesh").
+        getConnectee().getNumRegions();
+
     addCacheVariable<Vector>("target.regional.contact_area",
-        Vector(6,0.0), Stage::Dynamics);
+        Vector(target_mesh_nReg,0.0), Stage::Dynamics);
     addCacheVariable<Vector>("target.regional.mean_proximity",
-        Vector(6,0.0), Stage::Dynamics);
+        Vector(target_mesh_nReg,0.0), Stage::Dynamics);
     addCacheVariable<Vector>("target.regional.max_proximity",
-        Vector(6,0.0), Stage::Dynamics);
+        Vector(target_mesh_nReg,0.0), Stage::Dynamics);
     addCacheVariable<Vector_<Vec3>>("target.regional.center_of_proximity",
-        Vector_<Vec3>(6,Vec3(0)), Stage::Dynamics);
+        Vector_<Vec3>(target_mesh_nReg,Vec3(0)), Stage::Dynamics);
     addCacheVariable<Vector>("target.regional.mean_pressure",
-        Vector(6,0.0), Stage::Dynamics);
-    addCacheVariable<Vector>("target.regional.max_pressure",Vector(6,0.0),
-        Stage::Dynamics);    
+        Vector(target_mesh_nReg,0.0), Stage::Dynamics);
+    addCacheVariable<Vector>("target.regional.max_pressure",
+        Vector(target_mesh_nReg,0.0), Stage::Dynamics);    
     addCacheVariable<Vector_<Vec3>>("target.regional.center_of_pressure",
-        Vector_<Vec3>(6,Vec3(0)), Stage::Dynamics);
+        Vector_<Vec3>(target_mesh_nReg,Vec3(0)), Stage::Dynamics);
     addCacheVariable<Vector_<Vec3>>("target.regional.contact_force",
-        Vector_<Vec3>(6,Vec3(0)), Stage::Dynamics);
+        Vector_<Vec3>(target_mesh_nReg,Vec3(0)), Stage::Dynamics);
     addCacheVariable<Vector_<Vec3>>("target.regional.contact_moment",
-        Vector_<Vec3>(6,Vec3(0)), Stage::Dynamics);
-
-    addCacheVariable<Vector>("casting.regional.contact_area",Vector(6,0.0),
-        Stage::Dynamics);
-    addCacheVariable<Vector>("casting.regional.mean_proximity",Vector(6,0.0),
-        Stage::Dynamics);
-    addCacheVariable<Vector>("casting.regional.max_proximity",Vector(6,0.0),
-        Stage::Dynamics);
+        Vector_<Vec3>(target_mesh_nReg,Vec3(0)), Stage::Dynamics);
+
+    addCacheVariable<Vector>("casting.regional.contact_area",
+        Vector(casting_mesh_nReg,0.0), Stage::Dynamics);
+    addCacheVariable<Vector>("casting.regional.mean_proximity",
+        Vector(casting_mesh_nReg,0.0), Stage::Dynamics);
+    addCacheVariable<Vector>("casting.regional.max_proximity",
+        Vector(casting_mesh_nReg,0.0), Stage::Dynamics);
     addCacheVariable<Vector_<Vec3>>("casting.regional.center_of_proximity",
-        Vector_<Vec3>(6,Vec3(0)), Stage::Dynamics);
-    addCacheVariable<Vector>("casting.regional.mean_pressure",Vector(6,0.0),
-        Stage::Dynamics);
-    addCacheVariable<Vector>("casting.regional.max_pressure",Vector(6,0.0),
-        Stage::Dynamics);    
+        Vector_<Vec3>(casting_mesh_nReg,Vec3(0)), Stage::Dynamics);
+    addCacheVariable<Vector>("casting.regional.mean_pressure",
+        Vector(casting_mesh_nReg,0.0), Stage::Dynamics);
+    addCacheVariable<Vector>("casting.regional.max_pressure",
+        Vector(casting_mesh_nReg,0.0), Stage::Dynamics);    
     addCacheVariable<Vector_<Vec3>>("casting.regional.center_of_pressure",
-        Vector_<Vec3>(6,Vec3(0)), Stage::Dynamics);
+        Vector_<Vec3>(casting_mesh_nReg,Vec3(0)), Stage::Dynamics);
     addCacheVariable<Vector_<Vec3>>("casting.regional.contact_force",
-        Vector_<Vec3>(6,Vec3(0)), Stage::Dynamics);
+        Vector_<Vec3>(casting_mesh_nReg,Vec3(0)), Stage::Dynamics);
     addCacheVariable<Vector_<Vec3>>("casting.regional.contact_moment",
-        Vector_<Vec3>(6,Vec3(0)), Stage::Dynamics);
+        Vector_<Vec3>(casting_mesh_nReg,Vec3(0)), Stage::Dynamics);
 
     //Modeling Options
     //----------------
     addModelingOption("flip_meshes", 1);
+    addModelingOption("use_coarse_mesh", 1);
+
+    //Contact Events
+    //--------------
+    addDiscreteVariable("num_contact_events", Stage::Report);
+
+    if (get_use_contact_events()) {
+        system.addEventHandler(new ContactEventHandler(*this));
+    }
 }
 
-void Smith2018ArticularContactForce::computeMeshProximity(
-    const State& state, const Smith2018ContactMesh& casting_mesh,
-    const Smith2018ContactMesh& target_mesh, const std::string& cache_mesh_name) const
+void Smith2018ArticularContactForce::extendConnectToModel(Model& model)
+{
+    Super::extendConnectToModel(model);
+
+    addRegionalOutputChannels("casting", 
+        getConnectee<Smith2018ContactMesh>("casting_mesh"));
+    addRegionalOutputChannels("target", 
+        getConnectee<Smith2018ContactMesh>("target_mesh"));
+}
+
+void Smith2018ArticularContactForce::addRegionalOutputChannels(
+    const std::string& mesh_type, const Smith2018ContactMesh& mesh)
+{
+    std::map<std::string, int>& region_index = mesh_type == "casting" ?
+        _casting_region_index : _target_region_index;
+
+    region_index.clear();
+    for (int r = 0; r < mesh.getNumRegions(); ++r) {
+        region_index[mesh.getRegionNames()[r]] = r;
+    }
+
+    // Each <mesh_type>_region_<metric> list output has one channel per region
+    for (const auto& entry : getOutputs()) {
+        const std::string& output_name = entry.first;
+
+        if (!entry.second->isListOutput() || 
+            output_name.find(mesh_type + "_region_") != 0) {
+            continue;
+        }
+
+        AbstractOutput& output = updOutput(output_name);
+        output.clearChannels();
+        for (const std::string& region_name : mesh.getRegionNames()) {
+            output.addChannel(region_name);
+        }
+    }
+}
+
+int Smith2018ArticularContactForce::getRegionalIndex(
+    const std::string& cache_mesh_name, const std::string& region_name) const
+{
+    const std::map<std::string, int>& region_index = 
+        cache_mesh_name == "casting" ? 
+        _casting_region_index : _target_region_index;
+
+    auto it = region_index.find(region_name);
+    OPENSIM_THROW_IF_FRMOBJ(it == region_index.end(), Exception,
+        "Region: " + region_name + " does not exist in the " + 
+        cache_mesh_name + "_mesh.")
+    return it->second;
+}
+
+double Smith2018ArticularContactForce::getRegionalValue(
+    const SimTK::State& state, const std::string& cache_mesh_name,
+    const std::string& metric, const std::string& region_name) const
+{
+    if (!isCacheVariableValid(state, cache_mesh_name + ".regional." + metric)) {
+        realizeContactMetricCaches(state);
+    }
+    int r = getRegionalIndex(cache_mesh_name, region_name);
+
+    return getCacheVariableValue<Vector>
+        (state, cache_mesh_name + ".regional." + metric)(r);
+}
+
+SimTK::Vec3 Smith2018ArticularContactForce::getRegionalVec3Value(
+    const SimTK::State& state, const std::string& cache_mesh_name,
+    const std::string& metric, const std::string& region_name) const
+{
+    if (!isCacheVariableValid(state, cache_mesh_name + ".regional." + metric)) {
+        realizeContactMetricCaches(state);
+    }
+    int r = getRegionalIndex(cache_mesh_name, region_name);
+
+    return getCacheVariableValue<Vector_<Vec3>>
+        (state, cache_mesh_name + ".regional." + metric)(r);
+}
+
+SimTK::Vector Smith2018ArticularContactForce::getTriangleDataAsDense(
+    const SimTK::State& state, const std::string& cache_mesh_name,
+    const std::string& data_name) const
+{
+    const std::vector<int>& active_tri = 
+        getCacheVariableValue<std::vector<int>>(state,
+        cache_mesh_name + ".triangle.active_index");
+    const Vector& active_data = getCacheVariableValue<Vector>(state,
+        cache_mesh_name + ".triangle.active_" + data_name);
+
+    int nTri = getConnectee<Smith2018ContactMesh>(cache_mesh_name + "_mesh").
+        getNumFaces();
+
+    SimTK::Vector triangle_data(nTri, 0.0);
+    for (int k = 0; k < static_cast<int>(active_tri.size()); ++k) {
+        triangle_data(active_tri[k]) = active_data(k);
+    }
+    return triangle_data;
+}
+
+void Smith2018ArticularContactForce::getTriangleOutputSparse(
+    const SimTK::State& state, const std::string& output_name,
+    std::vector<int>& triangle_index, SimTK::Vector& triangle_data) const
 {
-    SimTK::Vector triangle_proximity;
-    computeMeshProximity(state, casting_mesh, target_mesh,
-        cache_mesh_name, triangle_proximity);
+    std::string cache_mesh_name;
+    if (output_name.find("casting_triangle_") == 0) {
+        cache_mesh_name = "casting";
+    }
+    else if (output_name.find("target_triangle_") == 0) {
+        cache_mesh_name = "target";
+    }
+    else {
+        OPENSIM_THROW_FRMOBJ(Exception, output_name + 
+            " is not a per triangle output.")
+    }
+
+    std::string data_name = 
+        output_name.substr(cache_mesh_name.size() + 10);
+
+    triangle_index = getCacheVariableValue<std::vector<int>>(state,
+        cache_mesh_name + ".triangle.active_index");
+    triangle_data = getCacheVariableValue<Vector>(state,
+        cache_mesh_name + ".triangle.active_" + data_name);
 }
 
 void Smith2018ArticularContactForce::computeMeshProximity(
     const State& state, const Smith2018ContactMesh& casting_mesh,
-    const Smith2018ContactMesh& target_mesh,const std::string& cache_mesh_name,
-    SimTK::Vector& triangle_proximity) const
+    const Smith2018ContactMesh& target_mesh,
+    const std::string& cache_mesh_name) const
 {
     // Get Mesh Properties
     Vector_<SimTK::Vec3> tri_cen = casting_mesh.getTriangleCenters();
@@ -258,6 +435,12 @@ void Smith2018ArticularContactForce::computeMeshProximity(
    
     Transform MeshCtoMeshT = casting_mesh.getMeshFrame().
         findTransformBetween(state,target_mesh.getMeshFrame());
+
+    //Reuse the proximities if this exact pose was evaluated recently
+    if (findProximityCacheEntry(state, cache_mesh_name, MeshCtoMeshT,
+        casting_mesh.get_scale_factors(), target_mesh.get_scale_factors())) {
+        return;
+    }
     
     //Initialize contact variables
     //----------------------------
@@ -269,12 +452,37 @@ void Smith2018ArticularContactForce::computeMeshProximity(
     int nContactingTri = 0;
 
 
-    triangle_proximity.resize(casting_mesh.getNumFaces());
-    triangle_proximity = 0;
+    //Sparse storage of the active triangles, written directly in the cache
+    std::vector<int>& active_tri = updCacheVariableValue<std::vector<int>>
+        (state, cache_mesh_name + ".triangle.active_index");
+    Vector& active_proximity = updCacheVariableValue<Vector>
+        (state, cache_mesh_name + ".triangle.active_proximity");
+
+    active_tri.clear();
+    active_proximity.resize(casting_mesh.getNumFaces());
 
     std::vector<int>& target_tri = updCacheVariableValue<std::vector<int>>
             (state, cache_mesh_name + ".triangle.previous_contacting_triangle");
 
+    bool coarse = getModelingOption(state, "use_coarse_mesh") == 1;
+    const std::vector<int>& coarse_tri =
+        casting_mesh.getCoarseTriangleIndices();
+
+    //The coarse mesh only updates the hints of the triangles representing 
+    //each cluster, the others are stale after switching resolution
+    int previous_coarse = updCacheVariableValue<int>(state, 
+        cache_mesh_name + ".triangle.previous_use_coarse_mesh");
+
+    if (previous_coarse != (coarse ? 1 : 0)) {
+        std::vector<int> representative_tri(target_tri.size(), -1);
+        for (int i : coarse_tri) {
+            representative_tri[i] = target_tri[i];
+        }
+        target_tri.swap(representative_tri);
+    }
+    setCacheVariableValue(state, cache_mesh_name + 
+        ".triangle.previous_use_coarse_mesh", coarse ? 1 : 0);
+
     //Keep track of triangle collision type for debugging
     int nSameTri = 0;
     int nNeighborTri = 0;
@@ -283,8 +491,13 @@ void Smith2018ArticularContactForce::computeMeshProximity(
     //Collision Detection
     //-------------------
 
-    //Loop through all triangles in casting mesh
-    for (int i = 0; i < casting_mesh.getNumFaces(); ++i) {
+    //Loop through all triangles in casting mesh, or only the triangles
+    //representing each cluster of the coarse mesh
+    int nCastingTri = coarse ? static_cast<int>(coarse_tri.size()) :
+        casting_mesh.getNumFaces();
+
+    for (int t = 0; t < nCastingTri; ++t) {
+        int i = coarse ? coarse_tri[t] : t;
         bool contact_detected = false;
         double distance = 0.0;
         SimTK::Vec3 contact_point;
@@ -303,12 +516,13 @@ void Smith2018ArticularContactForce::computeMeshProximity(
                 if (distance >= get_min_proximity() &&
                     distance <= get_max_proximity()) {
                     
-                    triangle_proximity(i) = distance;
+                    active_tri.push_back(i);
+                    active_proximity(nActiveTri) = distance;
                 
                     nActiveTri++;
                     nSameTri++;
 
-                    if (triangle_proximity(i) > 0.0) { nContactingTri++; }
+                    if (distance > 0.0) { nContactingTri++; }
                 }
                 continue;
 
@@ -326,13 +540,14 @@ void Smith2018ArticularContactForce::computeMeshProximity(
                     if (distance >= get_min_proximity() &&
                         distance <= get_max_proximity()) {
 
-                        triangle_proximity(i) = distance;
+                        active_tri.push_back(i);
+                        active_proximity(nActiveTri) = distance;
 
                         target_tri[i] = neighbor_tri;
 
                         nActiveTri++;
                         nNeighborTri++;
-                        if (triangle_proximity(i) > 0.0) { nContactingTri++; }
+                        if (distance > 0.0) { nContactingTri++; }
 
                         contact_detected = true;
                         break;
@@ -353,11 +568,12 @@ void Smith2018ArticularContactForce::computeMeshProximity(
             contact_target_tri,contact_point,distance)){
 
             target_tri[i] = contact_target_tri;
-            triangle_proximity(i) = distance;
+            active_tri.push_back(i);
+            active_proximity(nActiveTri) = distance;
 
             nActiveTri++;
             nDiffTri++;
-            if (triangle_proximity(i) > 0.0) { nContactingTri++;}
+            if (distance > 0.0) { nContactingTri++;}
             continue;
         }
 
@@ -366,8 +582,12 @@ void Smith2018ArticularContactForce::computeMeshProximity(
     }
        
     //Store Contact Info
-    setCacheVariableValue(state, cache_mesh_name + 
-        ".triangle.proximity", triangle_proximity);    
+    active_proximity.resizeKeep(nActiveTri);
+
+    markCacheVariableValid(state, cache_mesh_name + 
+        ".triangle.active_index");
+    markCacheVariableValid(state, cache_mesh_name + 
+        ".triangle.active_proximity");
     setCacheVariableValue(state, cache_mesh_name + 
         ".triangle.previous_contacting_triangle",target_tri);
     setCacheVariableValue(state, cache_mesh_name + 
@@ -380,27 +600,170 @@ void Smith2018ArticularContactForce::computeMeshProximity(
         ".num_contacting_triangles_neighbor", nNeighborTri);
     setCacheVariableValue(state, cache_mesh_name + 
         ".num_contacting_triangles_different", nDiffTri);
+
+    addProximityCacheEntry(state, cache_mesh_name, MeshCtoMeshT,
+        casting_mesh.get_scale_factors(), target_mesh.get_scale_factors());
 }
 
-void Smith2018ArticularContactForce::computeMeshDynamics(
-    const State& state, const Smith2018ContactMesh& casting_mesh,
-    const Smith2018ContactMesh& target_mesh) const
+const SimTK::Vector& Smith2018ArticularContactForce::getTriangleAreas(
+    const State& state, const Smith2018ContactMesh& mesh) const
 {
-    SimTK::Vector_<SimTK::Vec3> triangle_force;
-    SimTK::Vector triangle_pressure;
-    SimTK::Vector triangle_energy;
+    //On the coarse mesh each ray cast triangle carries the area of its
+    //cluster
+    if (getModelingOption(state, "use_coarse_mesh") == 1) {
+        return mesh.getCoarseTriangleAreas();
+    }
+    return mesh.getTriangleAreas();
+}
+
+bool Smith2018ArticularContactForce::findProximityCacheEntry(
+    const State& state, const std::string& cache_mesh_name,
+    const Transform& pose, const Vec3& casting_scale,
+    const Vec3& target_scale) const
+{
+    if (get_proximity_cache_size() <= 0) {
+        return false;
+    }
+
+    std::list<ProximityCacheEntry>& cache = _proximity_cache;
+    bool coarse = getModelingOption(state, "use_coarse_mesh") == 1;
+
+    //Only bit-identical poses are reused, so the results are the same as
+    //repeating the collision detection from the stored pose
+    auto entry = std::find_if(cache.begin(), cache.end(),
+        [&](const ProximityCacheEntry& e) {
+            return e.cache_mesh_name == cache_mesh_name &&
+                e.coarse == coarse &&
+                e.pose.p() == pose.p() &&
+                e.pose.R().asMat33() == pose.R().asMat33() &&
+                e.casting_scale == casting_scale &&
+                e.target_scale == target_scale;
+        });
+
+    if (entry == cache.end()) {
+        _proximity_cache_misses = _proximity_cache_misses + 1;
+        return false;
+    }
+    _proximity_cache_hits = _proximity_cache_hits + 1;
 
-    computeMeshDynamics(
-        state, casting_mesh, target_mesh,
-        triangle_force, triangle_pressure, triangle_energy);
+    //Move to front as the most recently used pose
+    cache.splice(cache.begin(), cache, entry);
+    const ProximityCacheEntry& hit = cache.front();
+
+    int nActiveTri = static_cast<int>(hit.active_index.size());
+
+    updCacheVariableValue<std::vector<int>>(state,
+        cache_mesh_name + ".triangle.active_index") = hit.active_index;
+
+    Vector& active_proximity = updCacheVariableValue<Vector>(state,
+        cache_mesh_name + ".triangle.active_proximity");
+    active_proximity.resize(nActiveTri);
+    for (int i = 0; i < nActiveTri; ++i) {
+        active_proximity(i) = hit.active_proximity[i];
+    }
+
+    std::vector<int>& target_tri = updCacheVariableValue<std::vector<int>>(
+        state, cache_mesh_name + ".triangle.previous_contacting_triangle");
+    std::fill(target_tri.begin(), target_tri.end(), -1);
+    for (int i = 0; i < static_cast<int>(hit.hint_index.size()); ++i) {
+        target_tri[hit.hint_index[i]] = hit.hint_triangle[i];
+    }
+
+    markCacheVariableValid(state, cache_mesh_name +
+        ".triangle.active_index");
+    markCacheVariableValid(state, cache_mesh_name +
+        ".triangle.active_proximity");
+    markCacheVariableValid(state, cache_mesh_name +
+        ".triangle.previous_contacting_triangle");
+    setCacheVariableValue(state, cache_mesh_name +
+        ".triangle.previous_use_coarse_mesh", coarse ? 1 : 0);
+    setCacheVariableValue(state, cache_mesh_name +
+        ".num_active_triangles", nActiveTri);
+    setCacheVariableValue(state, cache_mesh_name +
+        ".num_contacting_triangles", hit.num_contacting_triangles);
+    setCacheVariableValue(state, cache_mesh_name +
+        ".num_contacting_triangles_same", hit.num_contacting_triangles_same);
+    setCacheVariableValue(state, cache_mesh_name +
+        ".num_contacting_triangles_neighbor",
+        hit.num_contacting_triangles_neighbor);
+    setCacheVariableValue(state, cache_mesh_name +
+        ".num_contacting_triangles_different",
+        hit.num_contacting_triangles_different);
+
+    return true;
+}
+
+void Smith2018ArticularContactForce::addProximityCacheEntry(
+    const State& state, const std::string& cache_mesh_name,
+    const Transform& pose, const Vec3& casting_scale,
+    const Vec3& target_scale) const
+{
+    if (get_proximity_cache_size() <= 0) {
+        return;
+    }
+
+    std::list<ProximityCacheEntry>& cache = _proximity_cache;
+
+    //Drop the least recently used poses if the cache size was reduced
+    while (static_cast<int>(cache.size()) > get_proximity_cache_size()) {
+        cache.pop_back();
+    }
+
+    //Recycle the storage of the least recently used pose once the cache is
+    //full, the vectors keep their capacity so steady state misses do not
+    //allocate
+    if (static_cast<int>(cache.size()) == get_proximity_cache_size()) {
+        cache.splice(cache.begin(), cache, std::prev(cache.end()));
+    }
+    else {
+        cache.emplace_front();
+    }
+    ProximityCacheEntry& entry = cache.front();
+
+    entry.cache_mesh_name = cache_mesh_name;
+    entry.coarse = getModelingOption(state, "use_coarse_mesh") == 1;
+    entry.pose = pose;
+    entry.casting_scale = casting_scale;
+    entry.target_scale = target_scale;
+
+    const std::vector<int>& active_tri =
+        getCacheVariableValue<std::vector<int>>(state,
+        cache_mesh_name + ".triangle.active_index");
+    const Vector& active_proximity = getCacheVariableValue<Vector>(state,
+        cache_mesh_name + ".triangle.active_proximity");
+
+    entry.active_index.assign(active_tri.begin(), active_tri.end());
+    entry.active_proximity.resize(active_tri.size());
+    for (int i = 0; i < static_cast<int>(active_tri.size()); ++i) {
+        entry.active_proximity[i] = active_proximity(i);
+    }
+
+    const std::vector<int>& target_tri =
+        getCacheVariableValue<std::vector<int>>(state,
+        cache_mesh_name + ".triangle.previous_contacting_triangle");
+
+    entry.hint_index.clear();
+    entry.hint_triangle.clear();
+    for (int i = 0; i < static_cast<int>(target_tri.size()); ++i) {
+        if (target_tri[i] >= 0) {
+            entry.hint_index.push_back(i);
+            entry.hint_triangle.push_back(target_tri[i]);
+        }
+    }
+
+    entry.num_contacting_triangles = getCacheVariableValue<int>(state,
+        cache_mesh_name + ".num_contacting_triangles");
+    entry.num_contacting_triangles_same = getCacheVariableValue<int>(state,
+        cache_mesh_name + ".num_contacting_triangles_same");
+    entry.num_contacting_triangles_neighbor = getCacheVariableValue<int>(
+        state, cache_mesh_name + ".num_contacting_triangles_neighbor");
+    entry.num_contacting_triangles_different = getCacheVariableValue<int>(
+        state, cache_mesh_name + ".num_contacting_triangles_different");
 }
 
 void Smith2018ArticularContactForce::computeMeshDynamics(
     const State& state, const Smith2018ContactMesh& casting_mesh,
-    const Smith2018ContactMesh& target_mesh,
-    SimTK::Vector_<SimTK::Vec3>& triangle_force,
-    SimTK::Vector& triangle_pressure,
-    SimTK::Vector& triangle_energy) const
+    const Smith2018ContactMesh& target_mesh) const
 {
     std::string casting_path = getConnectee<Smith2018ContactMesh>
         ("casting_mesh").getAbsolutePathString();
@@ -415,18 +778,26 @@ void Smith2018ArticularContactForce::computeMeshDynamics(
         cache_mesh_name = "target";
     }
         
-    const Vector& triangle_proximity = getCacheVariableValue<Vector>(state,
-        cache_mesh_name + ".triangle.proximity");
+    const std::vector<int>& active_tri = 
+        getCacheVariableValue<std::vector<int>>(state,
+        cache_mesh_name + ".triangle.active_index");
+    const Vector& active_proximity = getCacheVariableValue<Vector>(state,
+        cache_mesh_name + ".triangle.active_proximity");
     const std::vector<int>& target_tri = 
         getCacheVariableValue<std::vector<int>>(state,
         cache_mesh_name + ".triangle.previous_contacting_triangle");
 
-    const Vector& triangle_area = casting_mesh.getTriangleAreas();
+    const Vector& triangle_area = getTriangleAreas(state, casting_mesh);
+
+    int nActiveTri = static_cast<int>(active_tri.size());
+
+    Vector& active_pressure = updCacheVariableValue<Vector>(state,
+        cache_mesh_name + ".triangle.active_pressure");
+    Vector& active_energy = updCacheVariableValue<Vector>(state,
+        cache_mesh_name + ".triangle.active_potential_energy");
 
-    triangle_pressure.resize(casting_mesh.getNumFaces());    
-    triangle_pressure = 0;
-    triangle_energy.resize(casting_mesh.getNumFaces());
-    triangle_energy = 0;
+    active_pressure.resize(nActiveTri);
+    active_energy.resize(nActiveTri);
 
     double hT, hC; //thickness
     double ET, EC; //elastic modulus
@@ -434,10 +805,13 @@ void Smith2018ArticularContactForce::computeMeshDynamics(
 
     //Compute Tri Pressure and Potential Energy
     //-----------------------------------------
-    for (int i = 0; i < casting_mesh.getNumFaces(); ++i) {
-        if (triangle_proximity(i) <= 0) {
-            triangle_pressure(i) = 0;
-            triangle_energy(i) = 0;
+    for (int k = 0; k < nActiveTri; ++k) {
+        int i = active_tri[k];
+        double proximity = active_proximity(k);
+
+        if (proximity <= 0) {
+            active_pressure(k) = 0;
+            active_energy(k) = 0;
             continue;
         }
 
@@ -460,16 +834,16 @@ void Smith2018ArticularContactForce::computeMeshDynamics(
 
 
             if (get_elastic_foundation_formulation() == "linear") {
-                triangle_pressure(i) = K * triangle_proximity(i) / h;
-                triangle_energy(i) = 0.5 * triangle_area(i) * K *
-                    SimTK::square(triangle_proximity(i)) / h;                
+                active_pressure(k) = K * proximity / h;
+                active_energy(k) = 0.5 * triangle_area(i) * K *
+                    SimTK::square(proximity) / h;                
                 continue;
             }
 
             if (get_elastic_foundation_formulation() == "nonlinear") {
-                triangle_pressure(i) = -K * log(1 - triangle_proximity(i) / h);
-                triangle_energy(i) = -triangle_area(i)* K * ((triangle_proximity(i) - h) *
-                    log(1 - triangle_proximity(i) / h) - triangle_proximity(i));
+                active_pressure(k) = -K * log(1 - proximity / h);
+                active_energy(k) = -triangle_area(i)* K * ((proximity - h) *
+                    log(1 - proximity / h) - proximity);
                 continue;
             }
         }
@@ -480,17 +854,17 @@ void Smith2018ArticularContactForce::computeMeshDynamics(
         double kT = ((1 - vT)*ET) / ((1 + vT)*(1 - 2 * vT)*hT);
         double kC = ((1 - vC)*EC) / ((1 + vC)*(1 - 2 * vC)*hC);
 
-        double linearPressure = (kT*kC) / (kT + kC)*triangle_proximity(i);
+        double linearPressure = (kT*kC) / (kT + kC)*proximity;
 
         if (get_elastic_foundation_formulation() == "linear") {
-            triangle_pressure(i) = linearPressure;
+            active_pressure(k) = linearPressure;
 
-            double depthT = kC / (kT + kC)*triangle_proximity(i);
-            double depthC = kT / (kT + kC)*triangle_proximity(i);
+            double depthT = kC / (kT + kC)*proximity;
+            double depthC = kT / (kT + kC)*proximity;
 
             double energyC = 0.5 * triangle_area(i) * kC * SimTK::square(depthC);
             double energyT = 0.5 * triangle_area(i) * kT * SimTK::square(depthT);
-            triangle_energy(i) = energyC + energyT;
+            active_energy(k) = energyC + energyT;
             continue;
         }
 
@@ -498,9 +872,9 @@ void Smith2018ArticularContactForce::computeMeshDynamics(
         else{ //(get_elastic_foundation_formulation() == "nonlinear") 
             double nonlinearPressure = 
                 calcTrianglePressureVariableNonlinearModel(
-                    triangle_proximity(i),hC,hT,EC,ET,vC,vT,linearPressure);
+                    proximity,hC,hT,EC,ET,vC,vT,linearPressure);
 
-            triangle_pressure(i) = nonlinearPressure;
+            active_pressure(k) = nonlinearPressure;
 
             double depthC = hC * (1 - exp(-nonlinearPressure / kC));
             double depthT = hT * (1 - exp(-nonlinearPressure / kT));
@@ -509,30 +883,32 @@ void Smith2018ArticularContactForce::computeMeshDynamics(
                 ((depthC - hC)*log(1 - depthC / hC) - depthC);
             double energyT = -triangle_area(i)* kT * 
                 ((depthT - hT)*log(1 - depthT / hT) - depthT);
-            triangle_energy(i) = energyC + energyT;
+            active_energy(k) = energyC + energyT;
             continue;
         }
     }
 
-    setCacheVariableValue(state, cache_mesh_name + 
-        ".triangle.pressure", triangle_pressure);    
-    setCacheVariableValue(state, cache_mesh_name + 
-        ".triangle.potential_energy", triangle_energy);
+    markCacheVariableValid(state, cache_mesh_name + 
+        ".triangle.active_pressure");
+    markCacheVariableValid(state, cache_mesh_name + 
+        ".triangle.active_potential_energy");
 
     //Compute Triangle Forces 
     //-----------------------
     const Vector_<UnitVec3>& triangle_normal = casting_mesh.getTriangleNormals();
 
-    triangle_force.resize(casting_mesh.getNumFaces());
-    triangle_force = Vec3(0.0);
+    Vector_<Vec3>& active_force = updCacheVariableValue<Vector_<Vec3>>(state,
+        cache_mesh_name + ".triangle.active_force");
+    active_force.resize(nActiveTri);
 
-    for (int i = 0; i < casting_mesh.getNumFaces(); ++i) {
+    for (int k = 0; k < nActiveTri; ++k) {
+        int i = active_tri[k];
         for (int j = 0; j < 3; ++j) {
-            triangle_force(i)(j) = 
-                triangle_pressure(i) * triangle_area(i) * -triangle_normal(i)(j);
+            active_force(k)(j) = 
+                active_pressure(k) * triangle_area(i) * -triangle_normal(i)(j);
         }
     }
-    setCacheVariableValue(state, cache_mesh_name + ".triangle.force", triangle_force);
+    markCacheVariableValid(state, cache_mesh_name + ".triangle.active_force");
     return;
 }
 
@@ -612,23 +988,17 @@ void Smith2018ArticularContactForce::computeForce(const State& state,
         getConnectee<Smith2018ContactMesh>("target_mesh");
 
     //Proximity
-    SimTK::Vector casting_triangle_proximity;
-    if (!isCacheVariableValid(state, "casting.triangle.proximity")) {
-        computeMeshProximity(state, casting_mesh, target_mesh,
-            "casting", casting_triangle_proximity);
-    }
-    else {
-        casting_triangle_proximity = getCacheVariableValue<SimTK::Vector>
-            (state, "casting.triangle.proximity");
+    if (!isCacheVariableValid(state, "casting.triangle.active_proximity")) {
+        computeMeshProximity(state, casting_mesh, target_mesh, "casting");
     }
 
-    SimTK::Vector casting_triangle_pressure;
-    SimTK::Vector casting_triangle_energy;
-    SimTK::Vector_<Vec3> casting_triangle_force;
-
     //Pressure
-    computeMeshDynamics(state, casting_mesh, target_mesh, casting_triangle_force,
-        casting_triangle_pressure,casting_triangle_energy);
+    computeMeshDynamics(state, casting_mesh, target_mesh);
+
+    const std::vector<int>& active_tri = getCacheVariableValue
+        <std::vector<int>>(state, "casting.triangle.active_index");
+    const Vector_<Vec3>& casting_triangle_force = getCacheVariableValue
+        <Vector_<Vec3>>(state, "casting.triangle.active_force");
 
     //Force
     const PhysicalFrame& target_frame = target_mesh.getMeshFrame();
@@ -640,9 +1010,11 @@ void Smith2018ArticularContactForce::computeForce(const State& state,
     Transform T_casting_to_target =
         casting_frame.findTransformBetween(state, target_frame);
 
-    for (int i = 0; i < casting_mesh.getNumFaces(); ++i) {
+    //Only the active triangles can have a nonzero force
+    for (int k = 0; k < static_cast<int>(active_tri.size()); ++k) {
+        int i = active_tri[k];
         Vec3 casting_force_ground =
-            T_casting_to_ground.xformFrameVecToBase(casting_triangle_force(i));
+            T_casting_to_ground.xformFrameVecToBase(casting_triangle_force(k));
 
         applyForceToPoint(state, casting_frame, triangle_center(i),
             casting_force_ground, bodyForces);
@@ -665,188 +1037,139 @@ void Smith2018ArticularContactForce::realizeContactMetricCaches(const SimTK::Sta
     const Smith2018ContactMesh& target_mesh =
         getConnectee<Smith2018ContactMesh>("target_mesh");
 
-    const SimTK::Vector& casting_triangle_proximity = getCacheVariableValue<SimTK::Vector>
-        (state, "casting.triangle.proximity");
+    ContactStats stats;
+    std::vector<ContactStats> regional_stats;
 
-    const SimTK::Vector& casting_triangle_pressure = getCacheVariableValue<SimTK::Vector>
-        (state, "casting.triangle.pressure");
+    computeContactStats(state, casting_mesh, "casting", stats, regional_stats);
 
-    std::vector<int> casting_faces;
-    for (int i = 0; i < casting_mesh.getNumFaces(); ++i) {
-        casting_faces.push_back(i);
-    }
-
-    auto stats = computeContactStats(casting_mesh, casting_triangle_proximity,
-        casting_triangle_pressure,casting_faces);
-    
-    setCacheVariableValue(state, 
-        "casting.total.contact_area", stats.contact_area);
-    setCacheVariableValue(state, 
-        "casting.total.mean_proximity", stats.mean_proximity);
-    setCacheVariableValue(state, 
-        "casting.total.max_proximity", stats.max_proximity);
-    setCacheVariableValue(state, 
-        "casting.total.center_of_proximity", stats.center_of_proximity);
-    setCacheVariableValue(state, 
-        "casting.total.mean_pressure", stats.mean_pressure);
-    setCacheVariableValue(state, 
-        "casting.total.max_pressure", stats.max_pressure);
-    setCacheVariableValue(state, 
-        "casting.total.center_of_pressure", stats.center_of_pressure);
-    setCacheVariableValue(state, 
-        "casting.total.contact_force", stats.contact_force);
-    setCacheVariableValue(state, 
-        "casting.total.contact_moment", stats.contact_moment);
- 
+    setContactStatsCaches(state, "casting", stats, regional_stats);
 
     //Target mesh computations (not used in applied contact force calculation)
-    SimTK::Vector target_triangle_proximity;
-    SimTK::Vector target_triangle_pressure;
     if (getModelingOption(state, "flip_meshes")) {
         //target proximity
-        
-        if (!isCacheVariableValid(state, "target.triangle.proximity")) {
-            computeMeshProximity(state, target_mesh, casting_mesh,
-                "target", target_triangle_proximity);
-        }
-        else {
-            target_triangle_proximity = getCacheVariableValue<SimTK::Vector>
-                (state, "target.triangle.proximity");
+        if (!isCacheVariableValid(state, "target.triangle.active_proximity")) {
+            computeMeshProximity(state, target_mesh, casting_mesh, "target");
         }
 
         //target pressure        
-        SimTK::Vector_<SimTK::Vec3> target_triangle_force;
-        SimTK::Vector target_triangle_energy;
-        computeMeshDynamics(state, target_mesh, casting_mesh,
-            target_triangle_force, target_triangle_pressure,target_triangle_energy);
+        computeMeshDynamics(state, target_mesh, casting_mesh);
 
         //target contact stats
-        std::vector<int> casting_faces;
-        for (int i = 0; i < target_mesh.getNumFaces(); ++i) {
-            casting_faces.push_back(i);
-        }
+        computeContactStats(state, target_mesh, "target", 
+            stats, regional_stats);
 
-        auto stats = computeContactStats(target_mesh, target_triangle_proximity,
-            target_triangle_pressure,casting_faces);
-    
-        setCacheVariableValue(state,
-            "target.total.contact_area", stats.contact_area);
-        setCacheVariableValue(state,
-            "target.total.mean_proximity", stats.mean_proximity);
-        setCacheVariableValue(state,
-            "target.total.max_proximity", stats.max_proximity);
-        setCacheVariableValue(state,
-            "target.total.center_of_proximity", stats.center_of_proximity);
-        setCacheVariableValue(state,
-            "target.total.mean_pressure", stats.mean_pressure);
-        setCacheVariableValue(state,
-            "target.total.max_pressure", stats.max_pressure);
-        setCacheVariableValue(state,
-            "target.total.center_of_pressure", stats.center_of_pressure);
-        setCacheVariableValue(state,
-            "target.total.contact_force", stats.contact_force);
-        setCacheVariableValue(state,
-            "target.total.contact_moment", stats.contact_moment);
+        setContactStatsCaches(state, "target", stats, regional_stats);
     }
+}
 
-    //regional casting stats
-    std::vector<std::vector<int>> casting_region_tri_ind = 
-        casting_mesh.getRegionalTriangleIndices();
-
-    SimTK::Vector reg_contact_area(6, 0.0);
-    SimTK::Vector reg_mean_proximity(6, 0.0);
-    SimTK::Vector reg_max_proximity(6, 0.0);
-    SimTK::Vector_<SimTK::Vec3> reg_COPrx(6, SimTK::Vec3(0));
-    SimTK::Vector reg_mean_pressure(6, 0.0);
-    SimTK::Vector reg_max_pressure(6, 0.0);
-    SimTK::Vector_<SimTK::Vec3> reg_COP(6, SimTK::Vec3(0));
-    SimTK::Vector_<SimTK::Vec3> reg_contact_force(6, SimTK::Vec3(0));
-    SimTK::Vector_<SimTK::Vec3> reg_contact_moment(6, SimTK::Vec3(0));
-
-    for (int i = 0; i < 6; ++i) {
-        auto stats = computeContactStats(casting_mesh, 
-            casting_triangle_proximity, casting_triangle_pressure,
-            casting_region_tri_ind[i]);
-
-        reg_contact_area(i) = stats.contact_area;
-        reg_mean_proximity(i) = stats.mean_proximity;
-        reg_max_proximity(i) = stats.max_proximity;
-        reg_COPrx(i) = stats.center_of_proximity;
-        reg_mean_pressure(i) = stats.mean_pressure;
-        reg_max_pressure(i) = stats.max_pressure;
-        reg_COP(i) = stats.center_of_pressure;
-        reg_contact_force(i) = stats.contact_force;
-        reg_contact_moment(i) = stats.contact_moment;
+void Smith2018ArticularContactForce::setContactStatsCaches(
+    const SimTK::State& state, const std::string& cache_mesh_name,
+    const ContactStats& stats,
+    const std::vector<ContactStats>& regional_stats) const
+{
+    setCacheVariableValue(state, 
+        cache_mesh_name + ".total.contact_area", stats.contact_area);
+    setCacheVariableValue(state, 
+        cache_mesh_name + ".total.mean_proximity", stats.mean_proximity);
+    setCacheVariableValue(state, 
+        cache_mesh_name + ".total.max_proximity", stats.max_proximity);
+    setCacheVariableValue(state, cache_mesh_name + 
+        ".total.center_of_proximity", stats.center_of_proximity);
+    setCacheVariableValue(state, 
+        cache_mesh_name + ".total.mean_pressure", stats.mean_pressure);
+    setCacheVariableValue(state, 
+        cache_mesh_name + ".total.max_pressure", stats.max_pressure);
+    setCacheVariableValue(state, cache_mesh_name + 
+        ".total.center_of_pressure", stats.center_of_pressure);
+    setCacheVariableValue(state, 
+        cache_mesh_name + ".total.contact_force", stats.contact_force);
+    setCacheVariableValue(state, 
+        cache_mesh_name + ".total.contact_moment", stats.contact_moment);
+
+    int nRegions = static_cast<int>(regional_stats.size());
+
+    SimTK::Vector reg_contact_area(nRegions, 0.0);
+    SimTK::Vector reg_mean_proximity(nRegions, 0.0);
+    SimTK::Vector reg_max_proximity(nRegions, 0.0);
+    SimTK::Vector_<SimTK::Vec3> reg_COPrx(nRegions, SimTK::Vec3(0));
+    SimTK::Vector reg_mean_pressure(nRegions, 0.0);
+    SimTK::Vector reg_max_pressure(nRegions, 0.0);
+    SimTK::Vector_<SimTK::Vec3> reg_COP(nRegions, SimTK::Vec3(0));
+    SimTK::Vector_<SimTK::Vec3> reg_contact_force(nRegions, SimTK::Vec3(0));
+    SimTK::Vector_<SimTK::Vec3> reg_contact_moment(nRegions, SimTK::Vec3(0));
+
+    for (int i = 0; i < nRegions; ++i) {
+        reg_contact_area(i) = regional_stats[i].contact_area;
+        reg_mean_proximity(i) = regional_stats[i].mean_proximity;
+        reg_max_proximity(i) = regional_stats[i].max_proximity;
+        reg_COPrx(i) = regional_stats[i].center_of_proximity;
+        reg_mean_pressure(i) = regional_stats[i].mean_pressure;
+        reg_max_pressure(i) = regional_stats[i].max_pressure;
+        reg_COP(i) = regional_stats[i].center_of_pressure;
+        reg_contact_force(i) = regional_stats[i].contact_force;
+        reg_contact_moment(i) = regional_stats[i].contact_moment;
     }
+
     setCacheVariableValue(state,
-        "casting.regional.contact_area", reg_contact_area);
+        cache_mesh_name + ".regional.contact_area", reg_contact_area);
     setCacheVariableValue(state,
-        "casting.regional.mean_proximity", reg_mean_proximity);
+        cache_mesh_name + ".regional.mean_proximity", reg_mean_proximity);
     setCacheVariableValue(state,
-        "casting.regional.max_proximity", reg_max_proximity);
+        cache_mesh_name + ".regional.max_proximity", reg_max_proximity);
     setCacheVariableValue(state,
-        "casting.regional.center_of_proximity", reg_COPrx);
+        cache_mesh_name + ".regional.center_of_proximity", reg_COPrx);
     setCacheVariableValue(state,
-        "casting.regional.mean_pressure", reg_mean_pressure);
+        cache_mesh_name + ".regional.mean_pressure", reg_mean_pressure);
     setCacheVariableValue(state,
-        "casting.regional.max_pressure", reg_max_pressure);
+        cache_mesh_name + ".regional.max_pressure", reg_max_pressure);
     setCacheVariableValue(state,
-        "casting.regional.center_of_pressure", reg_COP);
+        cache_mesh_name + ".regional.center_of_pressure", reg_COP);
     setCacheVariableValue(state,
-        "casting.regional.contact_force", reg_contact_force);
+        cache_mesh_name + ".regional.contact_force", reg_contact_force);
     setCacheVariableValue(state,
-        "casting.regional.contact_moment", reg_contact_moment);
-
-    //target
-    if (getModelingOption(state, "flip_meshes")) {
-
-        std::vector<std::vector<int>> target_region_tri_ind =
-            target_mesh.getRegionalTriangleIndices();
-
-        for (int i = 0; i < 6; ++i) {
-            auto stats = computeContactStats(target_mesh, 
-                target_triangle_proximity, target_triangle_pressure, target_region_tri_ind[i]);
-
-            reg_contact_area(i) = stats.contact_area;
-            reg_mean_proximity(i) = stats.mean_proximity;
-            reg_max_proximity(i) = stats.max_proximity;
-            reg_COPrx(i) = stats.center_of_proximity;
-            reg_mean_pressure(i) = stats.mean_pressure;
-            reg_max_pressure(i) = stats.max_pressure;
-            reg_COP(i) = stats.center_of_pressure;
-            reg_contact_force(i) = stats.contact_force;
-            reg_contact_moment(i) = stats.contact_moment;
-        }
+        cache_mesh_name + ".regional.contact_moment", reg_contact_moment);
+}
 
-        setCacheVariableValue(state,
-            "target.regional.contact_area", reg_contact_area);
-        setCacheVariableValue(state,
-            "target.regional.mean_proximity", reg_mean_proximity);
-        setCacheVariableValue(state,
-            "target.regional.max_proximity", reg_max_proximity);
-        setCacheVariableValue(state,
-            "target.regional.center_of_proximity", reg_COPrx);
-        setCacheVariableValue(state,
-            "target.regional.mean_pressure", reg_mean_pressure);
-        setCacheVariableValue(state,
-            "target.regional.max_pressure", reg_max_pressure);
-        setCacheVariableValue(state,
-            "target.regional.center_of_pressure", reg_COP);
-        setCacheVariableValue(state,
-            "target.regional.contact_force", reg_contact_force);
-        setCacheVariableValue(state,
-            "target.regional.contact_moment", reg_contact_moment);
+double Smith2018ArticularContactForce::computeContactEventWitness(
+    const SimTK::State& state) const
+{
+    if (!isCacheVariableValid(state, "casting.triangle.active_proximity")) {
+        computeMeshProximity(state,
+            getConnectee<Smith2018ContactMesh>("casting_mesh"),
+            getConnectee<Smith2018ContactMesh>("target_mesh"), "casting");
+    }
+    //Largest signed proximity of the active casting triangles. It crosses
+    //zero when the first triangle penetrates or the last one separates, and
+    //changes continuously in between so the integrator can localize it. If
+    //no triangle is within [min_proximity, max_proximity], the surfaces are
+    //at least min_proximity apart.
+    const Vector& active_proximity = getCacheVariableValue<Vector>
+        (state, "casting.triangle.active_proximity");
+
+    double witness =
+        std::min(get_min_proximity(), 0.0) - SimTK::SignificantReal;
+    for (int i = 0; i < active_proximity.size(); ++i) {
+        witness = std::max(witness, active_proximity(i));
     }
+    return witness;
+}
+
+int Smith2018ArticularContactForce::getNumContactEvents(
+    const SimTK::State& state) const
+{
+    return static_cast<int>(
+        getDiscreteVariableValue(state, "num_contact_events"));
 }
 
 double Smith2018ArticularContactForce::
 computePotentialEnergy(const SimTK::State& state) const
 {
-    if (!isCacheVariableValid(state, "casting.triangle.potential_energy")) {
+    if (!isCacheVariableValid(state, 
+        "casting.triangle.active_potential_energy")) {
         _model->realizeDynamics(state);
     }
-    SimTK::Vector triangle_energy = getCacheVariableValue<SimTK::Vector>(
-        state, "casting.triangle.potential_energy");
+    const SimTK::Vector& triangle_energy = getCacheVariableValue<SimTK::Vector>(
+        state, "casting.triangle.active_potential_energy");
     return triangle_energy.sum();
 }
 
@@ -878,127 +1201,103 @@ extendRealizeReport(const State & state) const
 }
 
 
-Smith2018ArticularContactForce::ContactStats
-Smith2018ArticularContactForce::computeContactStats(
-    const Smith2018ContactMesh& mesh,
-    const SimTK::Vector& total_triangle_proximity,
-    const SimTK::Vector& total_triangle_pressure,
-    const std::vector<int>& triIndices) const
+void Smith2018ArticularContactForce::computeContactStats(
+    const SimTK::State& state, const Smith2018ContactMesh& mesh,
+    const std::string& cache_mesh_name, ContactStats& total_stats,
+    std::vector<ContactStats>& regional_stats) const
 {
-    Smith2018ArticularContactForce::ContactStats stats;
-
-    int nTri = static_cast<int>(triIndices.size());
-
-    SimTK::Vector triangle_proximity(nTri);
-    SimTK::Vector triangle_pressure(nTri);
-
-    const SimTK::Vector& total_triangle_area = mesh.getTriangleAreas();
-    SimTK::Vector triangle_area(nTri);
-
-    const SimTK::Vector_<UnitVec3>& total_triangle_normal = mesh.getTriangleNormals();
-    SimTK::Vector_<UnitVec3> triangle_normal(nTri);
-
-    const SimTK::Vector_<Vec3>& total_triangle_center = mesh.getTriangleCenters();
-    SimTK::Vector_<Vec3> triangle_center(nTri);
-    int nContactingTri = 0;
-
-    for (int i = 0; i < nTri; ++i) {
-        triangle_area(i) = total_triangle_area(triIndices[i]);
-        triangle_normal(i) = total_triangle_normal(triIndices[i]);
-        triangle_proximity(i) = total_triangle_proximity(triIndices[i]);
-        triangle_pressure(i) = total_triangle_pressure(triIndices[i]);
-        triangle_center(i) = total_triangle_center(triIndices[i]);
-
-        if(triangle_pressure(i) > 0.0){
-            nContactingTri++;
+    const std::vector<int>& active_tri = 
+        getCacheVariableValue<std::vector<int>>(state,
+        cache_mesh_name + ".triangle.active_index");
+    const SimTK::Vector& active_proximity = getCacheVariableValue<Vector>(
+        state, cache_mesh_name + ".triangle.active_proximity");
+    const SimTK::Vector& active_pressure = getCacheVariableValue<Vector>(
+        state, cache_mesh_name + ".triangle.active_pressure");
+
+    const SimTK::Vector& triangle_area = getTriangleAreas(state, mesh);
+    const SimTK::Vector_<UnitVec3>& triangle_normal = mesh.getTriangleNormals();
+    const SimTK::Vector_<Vec3>& triangle_center = mesh.getTriangleCenters();
+    const std::vector<int>& tri_region_offset = mesh.getTriangleRegionOffsets();
+    const std::vector<int>& tri_region = mesh.getTriangleRegions();
+
+    int nRegions = mesh.getNumRegions();
+
+    //Accumulate all regions and the total (last entry) in one sweep over
+    //the active triangles, all other triangles have zero proximity/pressure
+    std::vector<ContactStatsSums> sums(nRegions + 1);
+
+    for (int k = 0; k < static_cast<int>(active_tri.size()); ++k) {
+        int i = active_tri[k];
+        double proximity = active_proximity(k);
+        double pressure = active_pressure(k);
+
+        if (proximity == 0.0 && pressure == 0.0) {
+            continue;
         }
-    }
-    
-    SimTK::Vector triangle_cenX(nTri);
-    SimTK::Vector triangle_cenY(nTri);
-    SimTK::Vector triangle_cenZ(nTri);
-
-    for (int i = 0; i < nTri; ++i) {
-        triangle_cenX(i) = triangle_center(i)(0);
-        triangle_cenY(i) = triangle_center(i)(1);
-        triangle_cenZ(i) = triangle_center(i)(2);
-    }
 
-    //Mean Pressure
-    stats.mean_pressure = triangle_pressure.sum() / nContactingTri;
-    stats.mean_proximity = triangle_proximity.sum() / nContactingTri;
+        double area = triangle_area(i);
+        const Vec3& center = triangle_center(i);
 
-    //Max Pressure
-    stats.max_pressure = triangle_pressure.normInf();
-    stats.max_proximity = triangle_proximity.normInf();
+        Vec3 force = computeContactForceVector(
+            pressure, area, -triangle_normal(i));
+        Vec3 moment = computeContactMomentVector(
+            pressure, area, -triangle_normal(i), center);
 
-    //Contact Area
-    double contact_area = 0.0;
+        sums[nRegions].add(proximity, pressure, area, center, force, moment);
 
-    for (int i = 0; i < nTri; i++) {
-        if (triangle_pressure(i) > 0.0) {
-            contact_area += triangle_area(i);
+        for (int m = tri_region_offset[i]; m < tri_region_offset[i+1]; ++m) {
+            sums[tri_region[m]].add(
+                proximity, pressure, area, center, force, moment);
         }
     }
 
-    stats.contact_area = contact_area;
-
-    //Center of Proximity
-    SimTK::Vector num_prx = triangle_proximity.elementwiseMultiply(triangle_area);
-    SimTK::Vector den_prx = triangle_proximity.elementwiseMultiply(triangle_area);
-    double denVal_prx = den_prx.sum();
-
-    SimTK::Vector xNum_prx = num_prx.elementwiseMultiply(triangle_cenX);
-    double xNumVal_prx = xNum_prx.sum();
-    double COPrx_x = xNumVal_prx / denVal_prx;
+    total_stats = sums[nRegions].getStats();
 
-    SimTK::Vector yNum_prx = num_prx.elementwiseMultiply(triangle_cenY);
-    double yNumVal_prx = yNum_prx.sum();
-    double COPrx_y = yNumVal_prx / denVal_prx;
-
-    SimTK::Vector zNum_prx = num_prx.elementwiseMultiply(triangle_cenZ);
-    double zNumVal_prx = zNum_prx.sum();
-    double COPrx_z = zNumVal_prx / denVal_prx;
-
-    stats.center_of_proximity(0) = COPrx_x;
-    stats.center_of_proximity(1) = COPrx_y;
-    stats.center_of_proximity(2) = COPrx_z;
-
-    //Center of Pressure
-    SimTK::Vector num = triangle_pressure.elementwiseMultiply(triangle_area);
-    SimTK::Vector den = triangle_pressure.elementwiseMultiply(triangle_area);
-    double denVal = den.sum();
+    regional_stats.resize(nRegions);
+    for (int r = 0; r < nRegions; ++r) {
+        regional_stats[r] = sums[r].getStats();
+    }
+}
 
-    SimTK::Vector xNum = num.elementwiseMultiply(triangle_cenX);
-    double xNumVal = xNum.sum();
-    double COPx = xNumVal / denVal;
+void Smith2018ArticularContactForce::ContactStatsSums::add(
+    double proximity, double pressure, double area, const Vec3& center,
+    const Vec3& force, const Vec3& moment)
+{
+    if (pressure > 0.0) {
+        nContactingTri++;
+        contact_area += area;
+    }
 
-    SimTK::Vector yNum = num.elementwiseMultiply(triangle_cenY);
-    double yNumVal = yNum.sum();
-    double COPy = yNumVal / denVal;
+    proximity_sum += proximity;
+    max_proximity = std::max(max_proximity, std::abs(proximity));
+    proximity_area_sum += proximity * area;
+    proximity_area_center_sum += proximity * area * center;
 
-    SimTK::Vector zNum = num.elementwiseMultiply(triangle_cenZ);
-    double zNumVal = zNum.sum();
-    double COPz = zNumVal / denVal;
+    pressure_sum += pressure;
+    max_pressure = std::max(max_pressure, std::abs(pressure));
+    pressure_area_sum += pressure * area;
+    pressure_area_center_sum += pressure * area * center;
 
-    stats.center_of_pressure(0) = COPx;
-    stats.center_of_pressure(1) = COPy;
-    stats.center_of_pressure(2) = COPz;
+    contact_force += force;
+    contact_moment += moment;
+}
 
-    //Contact Force
-    stats.contact_force = 0.0;
-    stats.contact_moment = 0.0;
-    
+Smith2018ArticularContactForce::ContactStats
+Smith2018ArticularContactForce::ContactStatsSums::getStats() const
+{
+    ContactStats stats;
 
-    for (int i = 0; i < nTri; ++i) {
-        stats.contact_force += computeContactForceVector(
-            triangle_pressure(i), triangle_area(i), -triangle_normal(i));
-        stats.contact_moment += computeContactMomentVector(
-            triangle_pressure(i), triangle_area(i), -triangle_normal(i), triangle_center(i));
-    }
+    stats.contact_area = contact_area;
+    stats.mean_proximity = proximity_sum / nContactingTri;
+    stats.max_proximity = max_proximity;
+    stats.center_of_proximity = proximity_area_center_sum / proximity_area_sum;
+    stats.mean_pressure = pressure_sum / nContactingTri;
+    stats.max_pressure = max_pressure;
+    stats.center_of_pressure = pressure_area_center_sum / pressure_area_sum;
+    stats.contact_force = contact_force;
+    stats.contact_moment = contact_moment;
 
     return stats;
-
 }
 
 OpenSim::Array<std::string> Smith2018ArticularContactForce::
@@ -1026,24 +1325,22 @@ getRecordLabels() const {
     labels.append(getName() + ".casting.total.contact_moment_x");
     labels.append(getName() + ".casting.total.contact_moment_y");
     labels.append(getName() + ".casting.total.contact_moment_z");
-    labels.append(getName() + ".casting.regional.contact_force_0_x");
-    labels.append(getName() + ".casting.regional.contact_force_0_y");
-    labels.append(getName() + ".casting.regional.contact_force_0_z");
-    labels.append(getName() + ".casting.regional.contact_force_1_x");
-    labels.append(getName() + ".casting.regional.contact_force_1_y");
-    labels.append(getName() + ".casting.regional.contact_force_1_z");
-    labels.append(getName() + ".casting.regional.contact_force_2_x");
-    labels.append(getName() + ".casting.regional.contact_force_2_y");
-    labels.append(getName() + ".casting.regional.contact_force_2_z");
-    labels.append(getName() + ".casting.regional.contact_force_3_x");
-    labels.append(getName() + ".casting.regional.contact_force_3_y");
-    labels.append(getName() + ".casting.regional.contact_force_3_z");
-    labels.append(getName() + ".casting.regional.contact_force_4_x");
-    labels.append(getName() + ".casting.regional.contact_force_4_y");
-    labels.append(getName() + ".casting.regional.contact_force_4_z");
-    labels.append(getName() + ".casting.regional.contact_force_5_x");
-    labels.append(getName() + ".casting.regional.contact_force_5_y");
-    labels.append(getName() + ".casting.regional.contact_force_5_z");
+
+    // Regions are labeled by their index in getRegionNames() so the column
+    // headers of existing results files are unchanged, user defined regions
+    // only change the number of columns
+    int nRegions = getConnectee<Smith2018ContactMesh>("casting_mesh").
+        getNumRegions();
+
+    for (int i = 0; i < nRegions; ++i) {
+        std::string region = std::to_string(i);
+        labels.append(getName() + ".casting.regional.contact_force_" + 
+            region + "_x");
+        labels.append(getName() + ".casting.regional.contact_force_" + 
+            region + "_y");
+        labels.append(getName() + ".casting.regional.contact_force_" + 
+            region + "_z");
+    }
 
     return labels;
 }
@@ -1101,24 +1398,12 @@ getRecordValues(const SimTK::State& state) const {
     values.append(contact_moment(0));
     values.append(contact_moment(1));
     values.append(contact_moment(2));
-    values.append(reg_contact_force(0)(0));
-    values.append(reg_contact_force(0)(1));
-    values.append(reg_contact_force(0)(2));
-    values.append(reg_contact_force(1)(0));
-    values.append(reg_contact_force(1)(1));
-    values.append(reg_contact_force(1)(2));
-    values.append(reg_contact_force(2)(0));
-    values.append(reg_contact_force(2)(1));
-    values.append(reg_contact_force(2)(2));
-    values.append(reg_contact_force(3)(0));
-    values.append(reg_contact_force(3)(1));
-    values.append(reg_contact_force(3)(2));
-    values.append(reg_contact_force(4)(0));
-    values.append(reg_contact_force(4)(1));
-    values.append(reg_contact_force(4)(2));
-    values.append(reg_contact_force(5)(0));
-    values.append(reg_contact_force(5)(1));
-    values.append(reg_contact_force(5)(2));
+
+    for (int i = 0; i < reg_contact_force.size(); ++i) {
+        values.append(reg_contact_force(i)(0));
+        values.append(reg_contact_force(i)(1));
+        values.append(reg_contact_force(i)(2));
+    }
     return values;
 }
 
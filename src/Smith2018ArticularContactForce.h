@@ -26,6 +26,8 @@
 #include "osimPluginDLL.h"
 #include "OpenSim/Simulation/Model/Force.h"
 #include "Smith2018ContactMesh.h"
+#include <list>
+#include <map>
 
 
 namespace OpenSim {
@@ -119,6 +121,14 @@ casting to also be performed from the target_mesh to calculate triangle
 proximity and pressure values. Note the applied contact force in this case is
 still only that calculated for the casting_mesh.
 
+The ModelingOption "use_coarse_mesh" limits the ray casting to a clustered
+subset of the casting_mesh triangles (see the coarse_mesh_face_ratio property
+of Smith2018ContactMesh), each of which carries the area of its cluster. This
+is a cheaper, lower resolution approximation of the contact force that is
+useful during the early iterations of an optimization. The contact triangle
+hints of the triangles that are not ray cast on the coarse mesh are reset
+when the resolution changes, so they are not reused from an older state.
+
 # Potential Pitfalls
 \image html fig_Smith2018ArticularContactForce_pitfalls.png width=600px
 
@@ -235,22 +245,35 @@ system of equations is solved using a numerical solver.
 This component has some outputs such as triangle_proximity, triangle_pressure,
 and triangle_potential_energy that return a SimTK::Vector (size = number of 
 triangles) with a value corresponding to each triangle face in the respective 
-target or casting mesh.
+target or casting mesh. Internally, the per triangle values are only stored 
+for the active triangles (those with a ray intersection), which are typically 
+a small fraction of the mesh. The dense vectors are assembled when these 
+outputs are requested, and getTriangleOutputSparse() provides direct access 
+to the sparse values (used by the JointMechanicsTool to reduce the size of 
+the stored results).
 There are also "summary" outputs that return values associated with the entire 
 mesh such as contact area, mean/max proximity/pressure, center of
 proximity/pressure etc. Finally, there are regional summary outputs which
-return a SimTK::Vector (size = 6). Here, the entries in the vector reflect the
-summary metrics corresponding to subset of mesh triangles located in six 
-specific regions. These six regions are defined as the subset of mesh triangles 
-whose center is located in the half space [+x, -x, +y, -y, +z, -z] in the 
-local mesh coordinate system. If the mesh coordinate system is aligned with 
-anatomical axes, then this enables simulation results to be more readily 
+return a SimTK::Vector with one entry per region defined in the 
+Smith2018ContactMesh (see the region_labels_file, region_labels_array and 
+region_names properties). By default, the six regions are the subsets of mesh 
+triangles whose center is located in the half space [-x, +x, -y, +y, -z, +z] 
+in the local mesh coordinate system. If the mesh coordinate system is aligned 
+with anatomical axes, then this enables simulation results to be more readily 
 interpreted. For example, when performing simulations of the knee, if the 
 z axis is aligned to the medial-lateral axis, points medially, and the origin 
 is located between the femoral condyles, then the regional outputs 
 corresponding to +z and -z will summarize the mesh triangles located on the 
 medial and lateral condyles and thus enable comparisons of the loading in the 
-medial and lateral compartments.
+medial and lateral compartments. User defined labels enable the same 
+comparison for arbitrary compartments or implant zones. The statistics of 
+every region are accumulated in a single pass over the mesh triangles. 
+
+Additionally, the list outputs <casting/target>_region_<metric> 
+(e.g. casting_region_contact_force) have a channel for each region, which is 
+created when the model is connected and named after the region (e.g. 
+casting_region_contact_force:medial). These channels can be connected 
+directly to the inputs of reporters or other components.
 
 All outputs are reported in the local mesh reference frame (ie the reference
 frame of the mesh_file. The ContactForce and ContactMoment outputs are 
@@ -311,6 +334,27 @@ public:
         "the Smith2018ContactMeshes for both meshes and use Bei & Fregly 2003 "
         "lumped parameter Elastic Foundation model.")
 
+    OpenSim_DECLARE_PROPERTY(use_contact_events, bool,
+        "Add a witness function to the system that triggers an event at "
+        "contact onset and release only, when the largest signed proximity "
+        "of the casting_mesh triangles crosses zero. This enables variable "
+        "step integrators to localize contact onset and release rather than "
+        "stepping into the stiff contact region. Changes in the set of "
+        "contacting triangles do not trigger events. Set min_proximity to a "
+        "negative value so the witness also varies smoothly as the meshes "
+        "approach. Default value set to false.")
+
+    OpenSim_DECLARE_PROPERTY(proximity_cache_size, int,
+        "Number of recent relative poses between the casting_mesh and "
+        "target_mesh for which the triangle proximities are stored. If the "
+        "meshes are realized at a pose that is bit-identical to a stored "
+        "pose (e.g. muscle perturbations in COMAK or repeated realizations), "
+        "the stored proximities are reused instead of repeating the "
+        "collision detection. Only the active and contacting triangles are "
+        "stored, so a miss costs a copy of the contacting triangles. "
+        "Set to 0 to disable. "
+        "Default value set to 4.")
+
     //=========================================================================
     // Connectors
     //=========================================================================
@@ -455,6 +499,44 @@ public:
         SimTK::Vector_<SimTK::Vec3>, getCastingRegionalContactMoment,
         SimTK::Stage::Dynamics)
 
+    // region channels (one channel per Smith2018ContactMesh region)
+    OpenSim_DECLARE_LIST_OUTPUT(target_region_contact_area, double,
+        getTargetRegionContactArea, SimTK::Stage::Position)
+    OpenSim_DECLARE_LIST_OUTPUT(casting_region_contact_area, double,
+        getCastingRegionContactArea, SimTK::Stage::Position)
+    OpenSim_DECLARE_LIST_OUTPUT(target_region_mean_proximity, double,
+        getTargetRegionMeanProximity, SimTK::Stage::Position)
+    OpenSim_DECLARE_LIST_OUTPUT(casting_region_mean_proximity, double,
+        getCastingRegionMeanProximity, SimTK::Stage::Position)
+    OpenSim_DECLARE_LIST_OUTPUT(target_region_max_proximity, double,
+        getTargetRegionMaxProximity, SimTK::Stage::Position)
+    OpenSim_DECLARE_LIST_OUTPUT(casting_region_max_proximity, double,
+        getCastingRegionMaxProximity, SimTK::Stage::Position)
+    OpenSim_DECLARE_LIST_OUTPUT(target_region_center_of_proximity, SimTK::Vec3,
+        getTargetRegionCenterOfProximity, SimTK::Stage::Position)
+    OpenSim_DECLARE_LIST_OUTPUT(casting_region_center_of_proximity, SimTK::Vec3,
+        getCastingRegionCenterOfProximity, SimTK::Stage::Position)
+    OpenSim_DECLARE_LIST_OUTPUT(target_region_mean_pressure, double,
+        getTargetRegionMeanPressure, SimTK::Stage::Dynamics)
+    OpenSim_DECLARE_LIST_OUTPUT(casting_region_mean_pressure, double,
+        getCastingRegionMeanPressure, SimTK::Stage::Dynamics)
+    OpenSim_DECLARE_LIST_OUTPUT(target_region_max_pressure, double,
+        getTargetRegionMaxPressure, SimTK::Stage::Dynamics)
+    OpenSim_DECLARE_LIST_OUTPUT(casting_region_max_pressure, double,
+        getCastingRegionMaxPressure, SimTK::Stage::Dynamics)
+    OpenSim_DECLARE_LIST_OUTPUT(target_region_center_of_pressure, SimTK::Vec3,
+        getTargetRegionCenterOfPressure, SimTK::Stage::Dynamics)
+    OpenSim_DECLARE_LIST_OUTPUT(casting_region_center_of_pressure, SimTK::Vec3,
+        getCastingRegionCenterOfPressure, SimTK::Stage::Dynamics)
+    OpenSim_DECLARE_LIST_OUTPUT(target_region_contact_force, SimTK::Vec3,
+        getTargetRegionContactForce, SimTK::Stage::Dynamics)
+    OpenSim_DECLARE_LIST_OUTPUT(casting_region_contact_force, SimTK::Vec3,
+        getCastingRegionContactForce, SimTK::Stage::Dynamics)
+    OpenSim_DECLARE_LIST_OUTPUT(target_region_contact_moment, SimTK::Vec3,
+        getTargetRegionContactMoment, SimTK::Stage::Dynamics)
+    OpenSim_DECLARE_LIST_OUTPUT(casting_region_contact_moment, SimTK::Vec3,
+        getCastingRegionContactMoment, SimTK::Stage::Dynamics)
+
     //=========================================================================
     // METHODS
     //=========================================================================
@@ -483,34 +565,59 @@ public:
 
     //tri proximity
     SimTK::Vector getTargetTriangleProximity(const SimTK::State& state) const {
-        return getCacheVariableValue<SimTK::Vector>
-            (state, "target.triangle.proximity");
+        return getTriangleDataAsDense(state, "target", "proximity");
     }
     SimTK::Vector getCastingTriangleProximity(const SimTK::State& state) const {
-        return getCacheVariableValue<SimTK::Vector>
-            (state, "casting.triangle.proximity");
+        return getTriangleDataAsDense(state, "casting", "proximity");
     }
 
     //tri pressure
     SimTK::Vector getTargetTrianglePressure(const SimTK::State& state) const {
-        return getCacheVariableValue<SimTK::Vector>
-            (state, "target.triangle.pressure");
+        return getTriangleDataAsDense(state, "target", "pressure");
     }
     SimTK::Vector getCastingTrianglePressure(const SimTK::State& state) const {
-        return getCacheVariableValue<SimTK::Vector>
-            (state, "casting.triangle.pressure");
+        return getTriangleDataAsDense(state, "casting", "pressure");
     }
 
     //tri potential energy
     SimTK::Vector getTargetTrianglePotentialEnergy(
         const SimTK::State& state) const {
-        return getCacheVariableValue<SimTK::Vector>
-            (state, "target.triangle.potential_energy");
+        return getTriangleDataAsDense(state, "target", "potential_energy");
     }
     SimTK::Vector getCastingTrianglePotentialEnergy(
         const SimTK::State& state) const {
-        return getCacheVariableValue<SimTK::Vector>
-            (state, "casting.triangle.potential_energy");
+        return getTriangleDataAsDense(state, "casting", "potential_energy");
+    }
+
+    /** Get the values of a per triangle output (e.g. 
+    casting_triangle_pressure) for the active triangles only. triangle_index 
+    lists the mesh triangles with a ray intersection and triangle_data holds 
+    the corresponding values, all other triangles have a value of zero. */
+    void getTriangleOutputSparse(const SimTK::State& state,
+        const std::string& output_name, std::vector<int>& triangle_index,
+        SimTK::Vector& triangle_data) const;
+
+    /** The value of the contact event witness function, the largest signed
+    proximity of the active casting_mesh triangles. The sign changes when the
+    meshes come into contact or separate. */
+    double computeContactEventWitness(const SimTK::State& state) const;
+
+    /** The number of contact onset and release events that have been 
+    handled during the simulation (requires use_contact_events). */
+    int getNumContactEvents(const SimTK::State& state) const;
+
+    /** The number of computeMeshProximity() calls that reused the stored
+    proximities of an identical relative mesh pose (see 
+    proximity_cache_size). */
+    int getProximityCacheHits() const { return _proximity_cache_hits; }
+
+    /** The number of computeMeshProximity() calls that performed the full
+    collision detection. */
+    int getProximityCacheMisses() const { return _proximity_cache_misses; }
+
+    void resetProximityCacheCounters() const {
+        _proximity_cache_hits = 0;
+        _proximity_cache_misses = 0;
     }
 
     //contact_area
@@ -702,6 +809,80 @@ public:
             (state, "casting.regional.contact_moment");
     }
 
+    //region channels
+    double getTargetRegionContactArea(const SimTK::State& state,
+        const std::string& region) const {
+        return getRegionalValue(state, "target", "contact_area", region);
+    }
+    double getCastingRegionContactArea(const SimTK::State& state,
+        const std::string& region) const {
+        return getRegionalValue(state, "casting", "contact_area", region);
+    }
+    double getTargetRegionMeanProximity(const SimTK::State& state,
+        const std::string& region) const {
+        return getRegionalValue(state, "target", "mean_proximity", region);
+    }
+    double getCastingRegionMeanProximity(const SimTK::State& state,
+        const std::string& region) const {
+        return getRegionalValue(state, "casting", "mean_proximity", region);
+    }
+    double getTargetRegionMaxProximity(const SimTK::State& state,
+        const std::string& region) const {
+        return getRegionalValue(state, "target", "max_proximity", region);
+    }
+    double getCastingRegionMaxProximity(const SimTK::State& state,
+        const std::string& region) const {
+        return getRegionalValue(state, "casting", "max_proximity", region);
+    }
+    SimTK::Vec3 getTargetRegionCenterOfProximity(const SimTK::State& state,
+        const std::string& region) const {
+        return getRegionalVec3Value(state, "target", "center_of_proximity", region);
+    }
+    SimTK::Vec3 getCastingRegionCenterOfProximity(const SimTK::State& state,
+        const std::string& region) const {
+        return getRegionalVec3Value(state, "casting", "center_of_proximity", region);
+    }
+    double getTargetRegionMeanPressure(const SimTK::State& state,
+        const std::string& region) const {
+        return getRegionalValue(state, "target", "mean_pressure", region);
+    }
+    double getCastingRegionMeanPressure(const SimTK::State& state,
+        const std::string& region) const {
+        return getRegionalValue(state, "casting", "mean_pressure", region);
+    }
+    double getTargetRegionMaxPressure(const SimTK::State& state,
+        const std::string& region) const {
+        return getRegionalValue(state, "target", "max_pressure", region);
+    }
+    double getCastingRegionMaxPressure(const SimTK::State& state,
+        const std::string& region) const {
+        return getRegionalValue(state, "casting", "max_pressure", region);
+    }
+    SimTK::Vec3 getTargetRegionCenterOfPressure(const SimTK::State& state,
+        const std::string& region) const {
+        return getRegionalVec3Value(state, "target", "center_of_pressure", region);
+    }
+    SimTK::Vec3 getCastingRegionCenterOfPressure(const SimTK::State& state,
+        const std::string& region) const {
+        return getRegionalVec3Value(state, "casting", "center_of_pressure", region);
+    }
+    SimTK::Vec3 getTargetRegionContactForce(const SimTK::State& state,
+        const std::string& region) const {
+        return getRegionalVec3Value(state, "target", "contact_force", region);
+    }
+    SimTK::Vec3 getCastingRegionContactForce(const SimTK::State& state,
+        const std::string& region) const {
+        return getRegionalVec3Value(state, "casting", "contact_force", region);
+    }
+    SimTK::Vec3 getTargetRegionContactMoment(const SimTK::State& state,
+        const std::string& region) const {
+        return getRegionalVec3Value(state, "target", "contact_moment", region);
+    }
+    SimTK::Vec3 getCastingRegionContactMoment(const SimTK::State& state,
+        const std::string& region) const {
+        return getRegionalVec3Value(state, "casting", "contact_moment", region);
+    }
+
     double computePotentialEnergy(
         const SimTK::State& state) const override;
 
@@ -713,6 +894,7 @@ public:
     OpenSim::Array<std::string> getRecordLabels() const;
 
 protected:
+    void extendConnectToModel(Model& model) override;
     void extendAddToSystem(SimTK::MultibodySystem& system) const override;
     void extendRealizeReport(const SimTK::State & state) const override;
 
@@ -721,22 +903,10 @@ protected:
         const Smith2018ContactMesh& target_mesh,
         const std::string& cache_mesh_name) const;
 
-    void computeMeshProximity(const SimTK::State& state,
-        const Smith2018ContactMesh& casting_mesh,
-        const Smith2018ContactMesh& target_mesh,
-        const std::string& cache_mesh_name,
-        SimTK::Vector& triangle_proximity) const;
-
     void computeMeshDynamics(const SimTK::State& state,
         const Smith2018ContactMesh& casting_mesh,
         const Smith2018ContactMesh& target_mesh) const;
 
-    void computeMeshDynamics(const SimTK::State& state,
-        const Smith2018ContactMesh& casting_mesh,
-        const Smith2018ContactMesh& target_mesh,
-        SimTK::Vector_<SimTK::Vec3>& triangle_force,
-        SimTK::Vector& triangle_pressure,SimTK::Vector& triangle_energy) const;
-
     SimTK::Vec3 computeContactForceVector(
         double pressure, double area, SimTK::Vec3 normal) const;
 
@@ -744,12 +914,16 @@ protected:
         double pressure, double area, SimTK::Vec3 normal,
         SimTK::Vec3 center) const;
 
-    ContactStats computeContactStats(const Smith2018ContactMesh& mesh,
-        const SimTK::Vector& total_triangle_proximity,
-        const SimTK::Vector& total_triangle_pressure,
-        const std::vector<int>& triIndices) const;
+    void computeContactStats(const SimTK::State& state,
+        const Smith2018ContactMesh& mesh, const std::string& cache_mesh_name,
+        ContactStats& total_stats,
+        std::vector<ContactStats>& regional_stats) const;
 
     void realizeContactMetricCaches(const SimTK::State& state) const;
+
+    void setContactStatsCaches(const SimTK::State& state,
+        const std::string& cache_mesh_name, const ContactStats& stats,
+        const std::vector<ContactStats>& regional_stats) const;
     
     //void computeRegionalContactStats(const SimTK::State& state) const;
 
@@ -757,6 +931,37 @@ private:
     void setNull();
     void constructProperties();
 
+    void addRegionalOutputChannels(const std::string& mesh_type,
+        const Smith2018ContactMesh& mesh);
+
+    int getRegionalIndex(const std::string& cache_mesh_name,
+        const std::string& region_name) const;
+
+    double getRegionalValue(const SimTK::State& state,
+        const std::string& cache_mesh_name, const std::string& metric,
+        const std::string& region_name) const;
+
+    SimTK::Vec3 getRegionalVec3Value(const SimTK::State& state,
+        const std::string& cache_mesh_name, const std::string& metric,
+        const std::string& region_name) const;
+
+    SimTK::Vector getTriangleDataAsDense(const SimTK::State& state,
+        const std::string& cache_mesh_name,
+        const std::string& data_name) const;
+
+    const SimTK::Vector& getTriangleAreas(const SimTK::State& state,
+        const Smith2018ContactMesh& mesh) const;
+
+    bool findProximityCacheEntry(const SimTK::State& state,
+        const std::string& cache_mesh_name, const SimTK::Transform& pose,
+        const SimTK::Vec3& casting_scale,
+        const SimTK::Vec3& target_scale) const;
+
+    void addProximityCacheEntry(const SimTK::State& state,
+        const std::string& cache_mesh_name, const SimTK::Transform& pose,
+        const SimTK::Vec3& casting_scale,
+        const SimTK::Vec3& target_scale) const;
+
     double calcTrianglePressureVariableNonlinearModel(double proximity,
         double casting_thickness, double target_thickness,
         double casting_E, double target_E,
@@ -799,7 +1004,59 @@ private:
         SimTK::Vec3 contact_moment;
     };
 
+    struct ContactStatsSums
+    {
+        int nContactingTri = 0;
+        double contact_area = 0.0;
+        double proximity_sum = 0.0;
+        double max_proximity = 0.0;
+        double proximity_area_sum = 0.0;
+        SimTK::Vec3 proximity_area_center_sum{0.0};
+        double pressure_sum = 0.0;
+        double max_pressure = 0.0;
+        double pressure_area_sum = 0.0;
+        SimTK::Vec3 pressure_area_center_sum{0.0};
+        SimTK::Vec3 contact_force{0.0};
+        SimTK::Vec3 contact_moment{0.0};
+
+        void add(double proximity, double pressure, double area,
+            const SimTK::Vec3& center, const SimTK::Vec3& force,
+            const SimTK::Vec3& moment);
+        ContactStats getStats() const;
+    };
+
+    struct ProximityCacheEntry
+    {
+        std::string cache_mesh_name;
+        bool coarse;
+        SimTK::Transform pose;
+        SimTK::Vec3 casting_scale;
+        SimTK::Vec3 target_scale;
+        std::vector<int> active_index;
+        std::vector<double> active_proximity;
+        //Only the casting triangles with a contacting target triangle, all
+        //other previous_contacting_triangle entries are -1
+        std::vector<int> hint_index;
+        std::vector<int> hint_triangle;
+        int num_contacting_triangles;
+        int num_contacting_triangles_same;
+        int num_contacting_triangles_neighbor;
+        int num_contacting_triangles_different;
+    };
+
+    //Most recently used pose first, the least recently used entry is
+    //recycled once the cache is full so a miss does not allocate
+    mutable SimTK::ResetOnCopy<std::list<ProximityCacheEntry>>
+        _proximity_cache;
+    mutable SimTK::ResetOnCopy<int> _proximity_cache_hits;
+    mutable SimTK::ResetOnCopy<int> _proximity_cache_misses;
+
     std::vector<std::string> _region_names;
+
+    //Index of each region (output channel) of the meshes, set in 
+    //extendConnectToModel
+    std::map<std::string, int> _casting_region_index;
+    std::map<std::string, int> _target_region_index;
     std::vector<std::string> _stat_names;
     std::vector<std::string> _stat_names_vec3;
     std::vector<std::string> _mesh_data_names;
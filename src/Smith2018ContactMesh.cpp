@@ -29,8 +29,14 @@
 #include "simmath/internal/ContactGeometry.h"
 #include "simmath/internal/OrientedBoundingBox.h"
 #include "simmath/internal/OBBTree.h"
+#include "base64.h"
 #include <set>
+#include <map>
+#include <tuple>
 #include <cmath>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
 
 using namespace OpenSim;
 
@@ -103,7 +109,11 @@ void Smith2018ContactMesh::constructProperties()
     constructProperty_mesh_back_file("");
     constructProperty_min_thickness(0.001);
     constructProperty_max_thickness(0.01);
+    constructProperty_region_labels_file("");
+    constructProperty_region_labels_array("");
+    constructProperty_region_names();
     constructProperty_scale_factors(SimTK::Vec3(1.0));
+    constructProperty_coarse_mesh_face_ratio(0.25);
 }
 
 void Smith2018ContactMesh::extendScale(
@@ -170,6 +180,17 @@ std::string Smith2018ContactMesh::findMeshFile(const std::string& file)
         OPENSIM_THROW(Exception,"Smith2018ContactMesh: Bad file type.");
     }
 
+    return findFile(file);
+}
+
+std::string Smith2018ContactMesh::findFile(const std::string& file)
+{
+    bool isAbsolutePath; 
+    std::string directory, fileName, extension;
+    
+    SimTK::Pathname::deconstructPathname(file, isAbsolutePath, directory,
+        fileName, extension);
+
     // Find OpenSim modelDir
     const Component* rootModel = nullptr;
     if (!hasOwner()) {
@@ -255,9 +276,6 @@ void Smith2018ContactMesh::initializeMesh()
     _vertex_locations.resize(_mesh.getNumVertices());
     _face_vertex_locations.resize(_mesh.getNumFaces(), 3);
         
-    _regional_tri_ind.resize(6);    
-    _regional_n_tri.assign(6,0);
-
     // Compute Mesh Properties
     //========================
 
@@ -307,20 +325,14 @@ void Smith2018ContactMesh::initializeMesh()
         // Now employ Heron's formula
         double s = (s1 + s2 + s3) / 2.0;
         _tri_area[i] = sqrt(s*(s - s1)*(s - s2)*(s - s3));
-        
-        //Determine regional triangle indices
-        for (int j = 0; j < 3; ++j) {
-            if (_tri_center(i)(j) < 0.0) {
-                _regional_tri_ind[j*2].push_back(i);
-                _regional_n_tri[j * 2]++;
-            }
-            else {
-                _regional_tri_ind[j * 2 + 1].push_back(i);
-                _regional_n_tri[j * 2 +1]++;
-            }
-        }  
     }
 
+    //Determine regional triangle indices
+    initializeRegions(file);
+
+    //Cluster the triangles for the coarse mesh
+    computeCoarseMesh();
+
     //Vertex Locations
     for (int i = 0; i < _mesh.getNumVertices(); ++i) {
         _vertex_locations(i) = _mesh.getVertexPosition(i);
@@ -390,6 +402,316 @@ void Smith2018ContactMesh::initializeMesh()
     _tri_poissons_ratio = get_poissons_ratio();
 }
 
+void Smith2018ContactMesh::initializeRegions(const std::string& mesh_file)
+{
+    int nTri = _mesh.getNumFaces();
+
+    _region_names.clear();
+    _tri_region.clear();
+    _tri_region_offset.assign(nTri + 1, 0);
+
+    bool use_labels = true;
+    std::vector<int> labels;
+    if (get_region_labels_file() != "") {
+        labels = readRegionLabelsFile(findFile(get_region_labels_file()));
+    }
+    else if (get_region_labels_array() != "") {
+        labels = readRegionLabelsVTP(mesh_file, get_region_labels_array());
+    }
+    else {
+        use_labels = false;
+    }
+
+    //No labels, use the half space regions of the mesh coordinate system
+    if (!use_labels) {
+        _region_names = {"x_neg", "x_pos", "y_neg", "y_pos", "z_neg", "z_pos"};
+
+        for (int i = 0; i < nTri; ++i) {
+            for (int j = 0; j < 3; ++j) {
+                if (_tri_center(i)(j) < 0.0) {
+                    _tri_region.push_back(j * 2);
+                }
+                else {
+                    _tri_region.push_back(j * 2 + 1);
+                }
+            }
+            _tri_region_offset[i + 1] = static_cast<int>(_tri_region.size());
+        }
+    }
+    else {
+        OPENSIM_THROW_IF_FRMOBJ(static_cast<int>(labels.size()) != nTri,
+            Exception, "Number of region labels (" + 
+            std::to_string(labels.size()) + ") does not match the number of "
+            "triangles in mesh_file (" + std::to_string(nTri) + ").")
+
+        //Map each distinct label to a compact region index
+        std::map<int, int> label_region;
+        for (int label : labels) {
+            if (label >= 0) {
+                label_region[label] = 0;
+            }
+        }
+
+        int nRegions = static_cast<int>(label_region.size());
+        int nNames = getProperty_region_names().size();
+
+        OPENSIM_THROW_IF_FRMOBJ(nNames != 0 && nNames != nRegions, Exception,
+            "region_names lists " + std::to_string(nNames) + " names, but "
+            "the region labels define " + std::to_string(nRegions) + 
+            " regions.")
+
+        int r = 0;
+        for (auto& entry : label_region) {
+            entry.second = r;
+            if (nNames == 0) {
+                _region_names.push_back(
+                    "region_" + std::to_string(entry.first));
+            }
+            else {
+                _region_names.push_back(get_region_names(r));
+            }
+            r++;
+        }
+
+        for (int i = 0; i < nTri; ++i) {
+            if (labels[i] >= 0) {
+                _tri_region.push_back(label_region[labels[i]]);
+            }
+            _tri_region_offset[i + 1] = static_cast<int>(_tri_region.size());
+        }
+    }
+
+    _regional_tri_ind.assign(_region_names.size(), std::vector<int>());
+    for (int i = 0; i < nTri; ++i) {
+        for (int k = _tri_region_offset[i]; k < _tri_region_offset[i+1]; ++k){
+            _regional_tri_ind[_tri_region[k]].push_back(i);
+        }
+    }
+}
+
+int Smith2018ContactMesh::getRegionIndex(
+    const std::string& region_name) const
+{
+    for (int r = 0; r < getNumRegions(); ++r) {
+        if (_region_names[r] == region_name) {
+            return r;
+        }
+    }
+    OPENSIM_THROW_FRMOBJ(Exception, "Region: " + region_name + 
+        " does not exist.")
+}
+
+std::vector<int> Smith2018ContactMesh::readRegionLabelsFile(
+    const std::string& file) const
+{
+    std::ifstream in(file);
+    OPENSIM_THROW_IF_FRMOBJ(!in.good(), Exception,
+        "Could not open region_labels_file: " + file)
+
+    std::vector<int> labels;
+    std::string line;
+    while (std::getline(in, line)) {
+        //Skip comment lines
+        std::size_t first = line.find_first_not_of(" \t\r");
+        if (first == std::string::npos || line[first] == '#') {
+            continue;
+        }
+
+        std::istringstream line_stream(line);
+        double value;
+        while (line_stream >> value) {
+            labels.push_back(static_cast<int>(std::floor(value + 0.5)));
+        }
+    }
+    return labels;
+}
+
+std::vector<int> Smith2018ContactMesh::readRegionLabelsVTP(
+    const std::string& file, const std::string& array_name) const
+{
+    bool isAbsolutePath;
+    std::string directory, fileName, extension;
+    SimTK::Pathname::deconstructPathname(file, isAbsolutePath, directory,
+        fileName, extension);
+
+    OPENSIM_THROW_IF_FRMOBJ(SimTK::String::toLower(extension) != ".vtp",
+        Exception, "region_labels_array can only be used with a .vtp "
+        "mesh_file.")
+
+    SimTK::Xml::Document doc(file);
+    SimTK::Xml::Element root = doc.getRootElement();
+
+    std::string header_type = root.getOptionalAttributeValue(
+        "header_type", "UInt32");
+
+    SimTK::Xml::Element piece = root.getRequiredElement("PolyData").
+        getRequiredElement("Piece");
+
+    SimTK::Xml::element_iterator cell_data = piece.element_begin("CellData");
+    OPENSIM_THROW_IF_FRMOBJ(cell_data == piece.element_end(), Exception,
+        "mesh_file: " + file + " does not contain CellData.")
+
+    std::vector<int> labels;
+    for (SimTK::Xml::element_iterator array = 
+        cell_data->element_begin("DataArray");
+        array != cell_data->element_end(); ++array) {
+
+        if (array->getOptionalAttributeValue("Name", "") != array_name) {
+            continue;
+        }
+
+        std::string format = array->getOptionalAttributeValue(
+            "format", "ascii");
+        std::string type = array->getRequiredAttributeValue("type");
+
+        if (format == "ascii") {
+            std::istringstream values(array->getValue());
+            double value;
+            while (values >> value) {
+                labels.push_back(static_cast<int>(std::floor(value + 0.5)));
+            }
+            return labels;
+        }
+
+        OPENSIM_THROW_IF_FRMOBJ(format != "binary" ||
+            array->hasAttribute("compressor") ||
+            root.hasAttribute("compressor"), Exception,
+            "region_labels_array: " + array_name + " must be stored in "
+            "uncompressed ascii or binary format.")
+
+        std::string value = array->getValue();
+        value.erase(std::remove_if(value.begin(), value.end(), ::isspace),
+            value.end());
+        std::string bytes = base64_decode(value);
+
+        std::size_t header_size = (header_type == "UInt64") ? 8 : 4;
+        std::size_t type_size;
+        if (type == "Int8" || type == "UInt8") type_size = 1;
+        else if (type == "Int16" || type == "UInt16") type_size = 2;
+        else if (type == "Int32" || type == "UInt32" || 
+            type == "Float32") type_size = 4;
+        else type_size = 8;
+
+        const char* data = bytes.data() + header_size;
+        std::size_t n = (bytes.size() - header_size) / type_size;
+
+        for (std::size_t i = 0; i < n; ++i) {
+            const char* ptr = data + i * type_size;
+            double value;
+            if (type == "Int8") value = *reinterpret_cast<const int8_t*>(ptr);
+            else if (type == "UInt8") value = *reinterpret_cast<const uint8_t*>(ptr);
+            else if (type == "Int16") value = *reinterpret_cast<const int16_t*>(ptr);
+            else if (type == "UInt16") value = *reinterpret_cast<const uint16_t*>(ptr);
+            else if (type == "Int32") value = *reinterpret_cast<const int32_t*>(ptr);
+            else if (type == "UInt32") value = *reinterpret_cast<const uint32_t*>(ptr);
+            else if (type == "Int64") value = static_cast<double>(*reinterpret_cast<const int64_t*>(ptr));
+            else if (type == "UInt64") value = static_cast<double>(*reinterpret_cast<const uint64_t*>(ptr));
+            else if (type == "Float32") value = *reinterpret_cast<const float*>(ptr);
+            else value = *reinterpret_cast<const double*>(ptr);
+
+            labels.push_back(static_cast<int>(std::floor(value + 0.5)));
+        }
+        return labels;
+    }
+
+    OPENSIM_THROW_FRMOBJ(Exception, "region_labels_array: " + array_name + 
+        " was not found in the CellData of mesh_file: " + file)
+}
+
+void Smith2018ContactMesh::computeCoarseMesh()
+{
+    int nTri = _mesh.getNumFaces();
+    double ratio = get_coarse_mesh_face_ratio();
+
+    _coarse_tri_ind.clear();
+    _coarse_tri_area.resize(nTri);
+    _coarse_tri_area = 0;
+
+    if (ratio >= 1.0 || nTri == 0) {
+        for (int i = 0; i < nTri; ++i) {
+            _coarse_tri_ind.push_back(i);
+        }
+        _coarse_tri_area = _tri_area;
+        return;
+    }
+
+    // Group the triangles in a voxel grid over the triangle centers,
+    // within a voxel triangles are only grouped if their normals agree
+    auto clusterTriangles = [&](double voxel,
+        std::vector<std::vector<int>>& clusters)
+    {
+        clusters.clear();
+        std::map<std::tuple<int, int, int>, std::vector<int>> voxel_clusters;
+
+        for (int i = 0; i < nTri; ++i) {
+            const SimTK::Vec3& c = _tri_center(i);
+            std::tuple<int, int, int> key(
+                (int)std::floor(c(0) / voxel),
+                (int)std::floor(c(1) / voxel),
+                (int)std::floor(c(2) / voxel));
+
+            std::vector<int>& candidates = voxel_clusters[key];
+            bool found = false;
+            for (int k : candidates) {
+                int first = clusters[k][0];
+                if (SimTK::dot(_tri_normal(i), _tri_normal(first)) > 0.7) {
+                    clusters[k].push_back(i);
+                    found = true;
+                    break;
+                }
+            }
+            if (!found) {
+                candidates.push_back((int)clusters.size());
+                clusters.push_back(std::vector<int>(1, i));
+            }
+        }
+    };
+
+    int target_nTri = std::max(1, (int)(ratio * nTri));
+    double voxel = std::sqrt(_tri_area.sum() / target_nTri);
+
+    std::vector<std::vector<int>> clusters;
+    for (int pass = 0; pass < 5; ++pass) {
+        clusterTriangles(voxel, clusters);
+
+        double n = (double)clusters.size();
+        if (std::abs(n - target_nTri) < 0.1 * target_nTri) {
+            break;
+        }
+        voxel *= std::sqrt(n / target_nTri);
+    }
+
+    // Each cluster is represented by the triangle closest to its area
+    // weighted center, which carries the area of the whole cluster
+    for (const std::vector<int>& cluster : clusters) {
+        double area = 0.0;
+        SimTK::Vec3 center(0.0);
+        for (int i : cluster) {
+            area += _tri_area(i);
+            center += _tri_area(i) * _tri_center(i);
+        }
+        if (area > 0.0) {
+            center /= area;
+        }
+        else {
+            center = _tri_center(cluster[0]);
+        }
+
+        int rep = cluster[0];
+        double min_dist = SimTK::Infinity;
+        for (int i : cluster) {
+            double dist = (_tri_center(i) - center).normSqr();
+            if (dist < min_dist) {
+                min_dist = dist;
+                rep = i;
+            }
+        }
+        _coarse_tri_ind.push_back(rep);
+        _coarse_tri_area(rep) = area;
+    }
+    std::sort(_coarse_tri_ind.begin(), _coarse_tri_ind.end());
+}
+
 void Smith2018ContactMesh::computeVariableThickness() {
 
     // Get Mesh Properties
@@ -82,6 +82,19 @@ number of triangles in the mesh. For details on a convergence study based on
 triangle area see [1]. Note that the GPU implementation described in the paper 
 is not implemented here.
 
+# Regions
+The triangles of the mesh can be grouped into regions (e.g. the medial and 
+lateral compartments of the tibial plateau, or the zones of an implant) and the 
+Smith2018ArticularContactForce reports contact metrics for each region. The 
+region of each triangle is defined by an integer label, which is read either 
+from a per-triangle scalar array (CellData) in a .vtp mesh_file 
+(region_labels_array) or from a sidecar text file listing one label per 
+triangle in face order (region_labels_file). Triangles with a negative label 
+do not belong to any region. The region_names property assigns a name to each 
+distinct label value. If no labels are provided, the six half-space regions 
+[-x, +x, -y, +y, -z, +z] of the mesh coordinate system are used, in which case
+each triangle belongs to three regions.
+
 # Collison Detection
 The collision detection algorithm is described in the Smith2018ArticularContact
 class description. The Smith2018ContactMesh stores all geometric mesh data and
@@ -139,10 +152,36 @@ public:
         "Maximum thickness threshold for elastic layer [m] when calculating "
         "variable thickness for each triangle.")
 
+    OpenSim_DECLARE_OPTIONAL_PROPERTY(region_labels_file, std::string,
+        "Path to text file containing an integer region label for each "
+        "triangle in mesh_file, listed in face order. Negative labels mark "
+        "triangles that do not belong to any region.")
+
+    OpenSim_DECLARE_OPTIONAL_PROPERTY(region_labels_array, std::string,
+        "Name of the per-triangle scalar array (CellData) in the .vtp "
+        "mesh_file that contains the integer region labels. Not used if "
+        "region_labels_file is defined.")
+
+    OpenSim_DECLARE_LIST_PROPERTY(region_names, std::string,
+        "Names of the labeled regions, listed in order of increasing label "
+        "value. If empty, the regions are named region_<label>.")
+
     OpenSim_DECLARE_PROPERTY(scale_factors, SimTK::Vec3,
         "[x,y,z] scale factors applied to vertex locations of the mesh_file "
         "and mesh_back_file meshes.")
 
+    OpenSim_DECLARE_PROPERTY(coarse_mesh_face_ratio, double,
+        "Approximate ratio of the number of triangles in the coarse mesh to "
+        "the number of triangles in mesh_file. The coarse mesh is not a "
+        "decimated mesh: the mesh_file triangles are grouped by a voxel grid "
+        "over their centers (only triangles with similar normals share a "
+        "cluster) and the triangle nearest each cluster center represents "
+        "it, carrying the area of the whole cluster. The voxel size is "
+        "adjusted until the number of clusters approximates this ratio. The "
+        "coarse mesh is used when the use_coarse_mesh ModelingOption of the "
+        "Smith2018ArticularContactForce is set. A value >= 1 uses every "
+        "triangle. The default value is 0.25.")
+
     //=========================================================================
     // SOCKETS
     //=========================================================================
@@ -197,6 +236,26 @@ public:
         return _regional_tri_ind;
     }
 
+    int getNumRegions() const {
+        return static_cast<int>(_region_names.size());
+    }
+
+    const std::vector<std::string>& getRegionNames() const {
+        return _region_names;
+    }
+
+    int getRegionIndex(const std::string& region_name) const;
+
+    /** The regions of triangle i are stored in getTriangleRegions() between
+    getTriangleRegionOffsets()[i] and getTriangleRegionOffsets()[i+1]. */
+    const std::vector<int>& getTriangleRegionOffsets() const {
+        return _tri_region_offset;
+    }
+
+    const std::vector<int>& getTriangleRegions() const {
+        return _tri_region;
+    }
+
     const double& getTriangleThickness(int i) const {
         return _tri_thickness(i);
     }
@@ -213,6 +272,19 @@ public:
         return _tri_area;
     }
 
+    /** Triangles that are ray cast from when the coarse mesh is used. Each
+    is the triangle nearest the center of a voxel cluster of neighboring 
+    triangles with similar normals (see coarse_mesh_face_ratio). */
+    const std::vector<int>& getCoarseTriangleIndices() const {
+        return _coarse_tri_ind;
+    }
+
+    /** Area of the cluster represented by each coarse triangle, zero for
+    triangles that are not in getCoarseTriangleIndices(). */
+    const SimTK::Vector& getCoarseTriangleAreas() const {
+        return _coarse_tri_area;
+    }
+
     const SimTK::Vector_<SimTK::Vec3>& getTriangleCenters() const {
         return _tri_center;
     }
@@ -263,6 +335,12 @@ private:
 
     void initializeMesh();
     std::string findMeshFile(const std::string& file);
+    std::string findFile(const std::string& file);
+
+    void initializeRegions(const std::string& mesh_file);
+    std::vector<int> readRegionLabelsFile(const std::string& file) const;
+    std::vector<int> readRegionLabelsVTP(const std::string& file,
+        const std::string& array_name) const;
 
     void createObbTree
         (OBBTreeNode& node, const SimTK::PolygonalMesh& mesh,
@@ -274,6 +352,7 @@ private:
         SimTK::Array_<int>& child2Indices, int axis);
 
     void computeVariableThickness();
+    void computeCoarseMesh();
 
     // Member Variables
     SimTK::PolygonalMesh _mesh;
@@ -282,8 +361,12 @@ private:
     SimTK::Vector_<SimTK::UnitVec3> _tri_normal;
     SimTK::Vector _tri_area;
     std::vector<std::vector<int>> _regional_tri_ind;
-    std::vector<int> _regional_n_tri;
+    std::vector<std::string> _region_names;
+    std::vector<int> _tri_region_offset;
+    std::vector<int> _tri_region;
     std::vector<std::set<int>> _tri_neighbors;
+    std::vector<int> _coarse_tri_ind;
+    SimTK::Vector _coarse_tri_area;
     SimTK::Vector_<SimTK::Vec3> _vertex_locations;
     SimTK::Matrix_<SimTK::Vec3> _face_vertex_locations;
     SimTK::Vector _tri_thickness;
@@ -0,0 +1,116 @@
+/* -------------------------------------------------------------------------- *
+ *                            SparseRowMatrix.cpp                             *
+ * -------------------------------------------------------------------------- *
+ * Author(s): Colin Smith                                                     *
+ *                                                                            *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may    *
+ * not use this file except in compliance with the License. You may obtain a  *
+ * copy of the License at http://www.apache.org/licenses/LICENSE-2.0.         *
+ *                                                                            *
+ * Unless required by applicable law or agreed to in writing, software        *
+ * distributed under the License is distributed on an "AS IS" BASIS,          *
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.   *
+ * See the License for the specific language governing permissions and        *
+ * limitations under the License.                                             *
+ * -------------------------------------------------------------------------- */
+
+#include "SparseRowMatrix.h"
+#include "OpenSim/Common/Exception.h"
+
+using namespace OpenSim;
+
+SparseRowMatrix::SparseRowMatrix() : SparseRowMatrix(0)
+{
+}
+
+SparseRowMatrix::SparseRowMatrix(int ncol) : _ncol(ncol)
+{
+    _row_offsets.push_back(0);
+}
+
+void SparseRowMatrix::appendRow(const std::vector<int>& column_index,
+    const SimTK::Vector& values)
+{
+    OPENSIM_THROW_IF(static_cast<int>(column_index.size()) != values.size(),
+        Exception, "SparseRowMatrix: number of column indices and values "
+        "must be equal.")
+
+    for (int k = 0; k < values.size(); ++k) {
+        if (values(k) == 0.0) {
+            continue;
+        }
+        OPENSIM_THROW_IF(column_index[k] < 0 || column_index[k] >= _ncol,
+            Exception, "SparseRowMatrix: column index " +
+            std::to_string(column_index[k]) + " is out of range.")
+
+        _column_index.push_back(column_index[k]);
+        _values.push_back(values(k));
+    }
+    _row_offsets.push_back(static_cast<int>(_values.size()));
+}
+
+void SparseRowMatrix::appendRow(const SimTK::Vector& dense_row)
+{
+    OPENSIM_THROW_IF(dense_row.size() != _ncol, Exception,
+        "SparseRowMatrix: row size does not match the number of columns.")
+
+    for (int j = 0; j < _ncol; ++j) {
+        if (dense_row(j) == 0.0) {
+            continue;
+        }
+        _column_index.push_back(j);
+        _values.push_back(dense_row(j));
+    }
+    _row_offsets.push_back(static_cast<int>(_values.size()));
+}
+
+void SparseRowMatrix::add(const SparseRowMatrix& other)
+{
+    OPENSIM_THROW_IF(other.nrow() != nrow() || other.ncol() != ncol(),
+        Exception, "SparseRowMatrix: matrix dimensions must agree.")
+
+    SparseRowMatrix sum(_ncol);
+    SimTK::Vector row(_ncol, 0.0);
+
+    for (int i = 0; i < nrow(); ++i) {
+        for (int k = _row_offsets[i]; k < _row_offsets[i + 1]; ++k) {
+            row(_column_index[k]) += _values[k];
+        }
+        for (int k = other._row_offsets[i]; k < other._row_offsets[i + 1]; ++k) {
+            row(other._column_index[k]) += other._values[k];
+        }
+
+        sum.appendRow(row);
+
+        //reset only the touched entries
+        for (int k = _row_offsets[i]; k < _row_offsets[i + 1]; ++k) {
+            row(_column_index[k]) = 0.0;
+        }
+        for (int k = other._row_offsets[i]; k < other._row_offsets[i + 1]; ++k) {
+            row(other._column_index[k]) = 0.0;
+        }
+    }
+    *this = sum;
+}
+
+SimTK::Vector SparseRowMatrix::getRowAsDense(int row) const
+{
+    SimTK::Vector dense_row(_ncol, 0.0);
+
+    for (int k = _row_offsets[row]; k < _row_offsets[row + 1]; ++k) {
+        dense_row(_column_index[k]) = _values[k];
+    }
+    return dense_row;
+}
+
+SimTK::Matrix SparseRowMatrix::getAsDense() const
+{
+    SimTK::Matrix dense(nrow(), _ncol, 0.0);
+
+    for (int i = 0; i < nrow(); ++i) {
+        for (int k = _row_offsets[i]; k < _row_offsets[i + 1]; ++k) {
+            dense(i, _column_index[k]) = _values[k];
+        }
+    }
+    return dense;
+}
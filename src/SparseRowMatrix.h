@@ -0,0 +1,80 @@
+#ifndef OPENSIM_SPARSE_ROW_MATRIX_H_
+#define OPENSIM_SPARSE_ROW_MATRIX_H_
+/* -------------------------------------------------------------------------- *
+ *                            SparseRowMatrix.h                               *
+ * -------------------------------------------------------------------------- *
+ * Author(s): Colin Smith                                                     *
+ *                                                                            *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may    *
+ * not use this file except in compliance with the License. You may obtain a  *
+ * copy of the License at http://www.apache.org/licenses/LICENSE-2.0.         *
+ *                                                                            *
+ * Unless required by applicable law or agreed to in writing, software        *
+ * distributed under the License is distributed on an "AS IS" BASIS,          *
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.   *
+ * See the License for the specific language governing permissions and        *
+ * limitations under the License.                                             *
+ * -------------------------------------------------------------------------- */
+
+//=============================================================================
+//                         SparseRowMatrix
+//=============================================================================
+/**
+This class stores a matrix in compressed sparse row (CSR) format. It is used
+to store per triangle contact data (e.g. triangle pressure) over the frames
+of a simulation, where each row is a frame and each column is a triangle.
+Typically, only a small fraction of the triangles in a contact mesh are in
+contact, so only the nonzero values are stored. Rows are appended in order.
+
+row_offsets has size nrow+1, the column indices and values of row i are
+stored in column_index and values from row_offsets[i] to row_offsets[i+1]-1.
+
+@author Colin Smith
+
+*/
+
+#include "SimTKcommon.h"
+#include "osimPluginDLL.h"
+#include <vector>
+
+namespace OpenSim {
+
+    class OSIMPLUGIN_API SparseRowMatrix {
+    public:
+        SparseRowMatrix();
+        SparseRowMatrix(int ncol);
+
+        int nrow() const { return static_cast<int>(_row_offsets.size()) - 1; }
+        int ncol() const { return _ncol; }
+        int getNumNonzero() const { return static_cast<int>(_values.size()); }
+
+        /** Append a row given the column indices and values of the entries,
+        zero values are not stored. */
+        void appendRow(const std::vector<int>& column_index,
+            const SimTK::Vector& values);
+
+        /** Append a row given as a dense vector, only the nonzero entries are
+        stored. */
+        void appendRow(const SimTK::Vector& dense_row);
+
+        /** Add the rows of another SparseRowMatrix with the same dimensions
+        to the rows of this matrix. */
+        void add(const SparseRowMatrix& other);
+
+        SimTK::Vector getRowAsDense(int row) const;
+        SimTK::Matrix getAsDense() const;
+
+        const std::vector<int>& getRowOffsets() const { return _row_offsets; }
+        const std::vector<int>& getColumnIndex() const { return _column_index; }
+        const std::vector<double>& getValues() const { return _values; }
+
+    private:
+        int _ncol;
+        std::vector<int> _row_offsets;
+        std::vector<int> _column_index;
+        std::vector<double> _values;
+    };
+
+} // namespace OpenSim
+
+#endif // OPENSIM_SPARSE_ROW_MATRIX_H_
@@ -16,14 +16,15 @@
 
 #include <OpenSim/OpenSim.h>
 #include "COMAKTool.h"
+#include "COMAKBatchTool.h"
 
 using namespace OpenSim;
 using SimTK::Vec3;
 
 /** 
 *
-*arg1: Settings File
-*
+*arg1: Plugin File
+*arg2: Settings File (COMAKTool, or COMAKBatchTool to run a list of trials)
 *
 *
 *
@@ -45,9 +46,17 @@ int main(int argc, char *argv[])
 
         LoadOpenSimLibrary(plugin_file, true);
 
-        COMAKTool comak = COMAKTool(settings_file);
+        std::unique_ptr<Object> settings(
+            Object::makeObjectFromFile(settings_file));
 
-        comak.run();
+        if (dynamic_cast<COMAKBatchTool*>(settings.get())) {
+            COMAKBatchTool batch = COMAKBatchTool(settings_file);
+            batch.run();
+        }
+        else {
+            COMAKTool comak = COMAKTool(settings_file);
+            comak.run();
+        }
 
         std::cout << "\n\nTotal Computation Time: "
             << watch.getElapsedTimeFormatted() << std::endl;
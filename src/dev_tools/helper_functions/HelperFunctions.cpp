@@ -109,6 +109,28 @@ int find_nearest(std::vector<double> in_vec, double value)
 	return int(low - in_vec.begin());
 }
 
+//=============================================================================
+// Hash Tools
+//=============================================================================
+void hash_bytes(std::uint64_t& hash, const void* data, std::size_t size)
+{
+	const unsigned char* bytes = static_cast<const unsigned char*>(data);
+	for (std::size_t i = 0; i < size; ++i) {
+		hash ^= bytes[i];
+		hash *= 1099511628211ULL;
+	}
+}
+
+void hash_string(std::uint64_t& hash, const std::string& str)
+{
+	hash_bytes(hash, str.data(), str.size() + 1);
+}
+
+void hash_double(std::uint64_t& hash, double value)
+{
+	hash_bytes(hash, &value, sizeof(value));
+}
+
 /*SimTK::Matrix sort_matrix_by_column(SimTK::Matrix& matrix, int col) {
 	std::vector<std::vector<double>> sort_matrix;
 	sort_matrix.resize(matrix.ncol());
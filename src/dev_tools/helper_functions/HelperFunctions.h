@@ -21,6 +21,7 @@
 // INCLUDES
 //=============================================================================
 #include <OpenSim/Simulation/Model/Analysis.h>
+#include <cstdint>
 
 //=============================================================================
 //=============================================================================
@@ -52,5 +53,18 @@ int find_nearest(std::vector<double> in_vec, double value);
 std::string erase_sub_string(std::string mainStr, const std::string & toErase);
 //SimTK::Matrix sort_matrix_by_column(SimTK::Matrix& matrix, int col);
 
+//=============================================================================
+//HASH TOOLS
+//=============================================================================
+
+/** 64 bit FNV-1a hash, stable across platforms, builds and runs (unlike
+std::hash) so it can be used as a key for files cached on disk. Start from
+FNV_OFFSET_BASIS and hash each value in turn.
+*/
+const std::uint64_t FNV_OFFSET_BASIS = 14695981039346656037ULL;
+void hash_bytes(std::uint64_t& hash, const void* data, std::size_t size);
+void hash_string(std::uint64_t& hash, const std::string& str);
+void hash_double(std::uint64_t& hash, double value);
+
 //}; //namespace
 #endif // #ifndef OPENSIM_HELPER_FUNCTIONS_H_
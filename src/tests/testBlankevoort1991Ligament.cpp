@@ -0,0 +1,351 @@
+/* -------------------------------------------------------------------------- *
+ *                     testBlankevoort1991Ligament.cpp                        *
+ * -------------------------------------------------------------------------- *
+ * Author(s): Colin Smith                                                     *
+ *                                                                            *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may    *
+ * not use this file except in compliance with the License. You may obtain a  *
+ * copy of the License at http://www.apache.org/licenses/LICENSE-2.0.         *
+ *                                                                            *
+ * Unless required by applicable law or agreed to in writing, software        *
+ * distributed under the License is distributed on an "AS IS" BASIS,          *
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.   *
+ * See the License for the specific language governing permissions and        *
+ * limitations under the License.                                             *
+ * -------------------------------------------------------------------------- */
+
+#include <OpenSim/OpenSim.h>
+#include "SimTKcommon/Testing.h"
+#include "Blankevoort1991Ligament.h"
+#include "Blankevoort1991LigamentSet.h"
+#include "RegisterTypes_osimPlugin.h"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+using namespace OpenSim;
+
+// Count every heap allocation made while counting is enabled.
+static std::atomic<bool> count_allocations(false);
+static std::atomic<int> num_allocations(0);
+
+void* operator new(std::size_t size) {
+    if (count_allocations) num_allocations++;
+    if (void* ptr = std::malloc(size == 0 ? 1 : size)) return ptr;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+static const double slack_length = 0.1;
+static const double linear_stiffness = 2000.0;
+static const double transition_strain = 0.06;
+static const double damping_coefficient = 0.003;
+
+// The ligament spans from the ground origin to a body that slides along the
+// ground x axis, so the ligament length and lengthening speed are the slider
+// coordinate value and speed.
+static void createSliderModel(Model& model)
+{
+    model.setName("ligament_slider");
+
+    Body* body = new Body("body", 1.0, SimTK::Vec3(0),
+        SimTK::Inertia(0.01));
+    model.addBody(body);
+
+    SliderJoint* slider = new SliderJoint("slider", model.getGround(), *body);
+    slider->updCoordinate().setName("x");
+    slider->updCoordinate().setDefaultValue(slack_length);
+    model.addJoint(slider);
+
+    Blankevoort1991Ligament* lig = new Blankevoort1991Ligament("lig",
+        model.getGround(), SimTK::Vec3(0), *body, SimTK::Vec3(0),
+        linear_stiffness, slack_length);
+    lig->set_transition_strain(transition_strain);
+    lig->set_damping_coefficient(damping_coefficient);
+    model.addForce(lig);
+}
+
+static double expectedSpringForce(double strain)
+{
+    if (strain <= 0) {
+        return 0.0;
+    }
+    else if (strain < transition_strain) {
+        return 0.5 * linear_stiffness / transition_strain * strain * strain;
+    }
+    return linear_stiffness * (strain - transition_strain / 2);
+}
+
+// The damping law as it was evaluated before the closed form stepUp().
+static double expectedDampingForce(double strain, double strain_rate)
+{
+    if (strain <= 0 || strain_rate <= 0) {
+        return 0.0;
+    }
+    SimTK::Function::Step step(0, 1, 0, 0.01);
+    return damping_coefficient * strain_rate *
+        step.calcValue(SimTK::Vector(1, strain));
+}
+
+// Check the spring and damping forces against the piecewise closed form
+// law, across the slack, damping phase-out, toe and linear regions, and
+// check that evaluating them does not allocate.
+void testForceEvaluation()
+{
+    Model model;
+    createSliderModel(model);
+    SimTK::State& state = model.initSystem();
+
+    const Coordinate& x = model.getCoordinateSet().get("x");
+    const Blankevoort1991Ligament& lig =
+        model.getComponent<Blankevoort1991Ligament>("/forceset/lig");
+
+    for (double strain : { -0.02, 0.004, 0.03, 0.1 }) {
+        for (double strain_rate : { -0.5, 0.5 }) {
+            x.setValue(state, slack_length * (1 + strain));
+            x.setSpeedValue(state, slack_length * strain_rate);
+            model.realizeVelocity(state);
+
+            SimTK_TEST_EQ_TOL(lig.getStrain(state), strain, 1e-12);
+            SimTK_TEST_EQ_TOL(lig.getStrainRate(state), strain_rate, 1e-12);
+
+            num_allocations = 0;
+            count_allocations = true;
+            double spring_force = lig.getSpringForce(state);
+            double damping_force = lig.getDampingForce(state);
+            count_allocations = false;
+
+            SimTK_TEST(num_allocations == 0);
+            SimTK_TEST_EQ_TOL(spring_force,
+                expectedSpringForce(strain), 1e-9);
+            SimTK_TEST_EQ_TOL(damping_force,
+                expectedDampingForce(strain, strain_rate), 1e-12);
+        }
+    }
+}
+
+// Several ligaments from offset ground points to the slider body, so over
+// the motion they pass through the slack, damping phase-out, toe and linear
+// regions at different times.
+static void createSliderLigamentsModel(Model& model, bool use_set)
+{
+    createSliderModel(model);
+
+    int i = 0;
+    for (double offset : { -0.004, 0.0005, 0.003, 0.008 }) {
+        Blankevoort1991Ligament* lig = new Blankevoort1991Ligament(
+            "lig" + std::to_string(i++), model.getGround(),
+            SimTK::Vec3(-offset, 0, 0), model.getBodySet().get("body"),
+            SimTK::Vec3(0), linear_stiffness * (1 + offset), slack_length);
+        lig->set_transition_strain(transition_strain);
+        lig->set_damping_coefficient(damping_coefficient);
+        model.addForce(lig);
+    }
+
+    if (use_set) {
+        Blankevoort1991LigamentSet* set = new Blankevoort1991LigamentSet();
+        set->setName("ligament_set");
+        model.addForce(set);
+    }
+}
+
+// The Blankevoort1991LigamentSet must reproduce the length, strain and force
+// outputs and the applied forces (accelerations) of the ligaments evaluated
+// individually, over a stretching and shortening motion.
+void testLigamentSet()
+{
+    Model model;
+    createSliderLigamentsModel(model, false);
+    SimTK::State& state = model.initSystem();
+
+    Model set_model;
+    createSliderLigamentsModel(set_model, true);
+    SimTK::State& set_state = set_model.initSystem();
+
+    const Blankevoort1991LigamentSet& set =
+        set_model.getComponent<Blankevoort1991LigamentSet>(
+            "/forceset/ligament_set");
+    SimTK_TEST(set.getNumLigaments() == 5);
+
+    const Coordinate& x = model.getCoordinateSet().get("x");
+    const Coordinate& set_x = set_model.getCoordinateSet().get("x");
+
+    const std::vector<std::string> outputs = { "length", "lengthening_speed",
+        "strain", "strain_rate", "spring_force", "damping_force",
+        "total_force" };
+
+    int n = 50;
+    for (int k = 0; k <= n; ++k) {
+        double phase = SimTK::Pi * k / n;
+        double value = slack_length * (0.99 + 0.08 * std::sin(phase));
+        double speed = slack_length * 0.08 * std::cos(phase) * 5.0;
+
+        x.setValue(state, value);
+        x.setSpeedValue(state, speed);
+        set_x.setValue(set_state, value);
+        set_x.setSpeedValue(set_state, speed);
+
+        model.realizeAcceleration(state);
+        set_model.realizeAcceleration(set_state);
+
+        for (const Blankevoort1991Ligament& lig :
+            model.getComponentList<Blankevoort1991Ligament>()) {
+            const Blankevoort1991Ligament& set_lig =
+                set_model.getComponent<Blankevoort1991Ligament>(
+                    lig.getAbsolutePathString());
+
+            for (const std::string& output : outputs) {
+                SimTK_TEST_EQ_TOL(set_lig.getOutputValue<double>(set_state, output),
+                    lig.getOutputValue<double>(state, output), 1e-10);
+            }
+        }
+
+        SimTK_TEST_EQ_TOL(set_state.getUDot(), state.getUDot(), 1e-10);
+    }
+}
+
+// A ligament from the ground over a via point on the first link of a double
+// pendulum to the second link, so the moment arms change with the pose.
+static void createPendulumModel(Model& model, double slack)
+{
+    model.setName("ligament_pendulum");
+
+    Body* link1 = new Body("link1", 1.0, SimTK::Vec3(0, -0.2, 0),
+        SimTK::Inertia(0.01));
+    Body* link2 = new Body("link2", 1.0, SimTK::Vec3(0, -0.2, 0),
+        SimTK::Inertia(0.01));
+    model.addBody(link1);
+    model.addBody(link2);
+
+    PinJoint* pin1 = new PinJoint("pin1", model.getGround(), *link1);
+    pin1->updCoordinate().setName("q1");
+    model.addJoint(pin1);
+
+    PinJoint* pin2 = new PinJoint("pin2",
+        *link1, SimTK::Vec3(0, -0.4, 0), SimTK::Vec3(0),
+        *link2, SimTK::Vec3(0), SimTK::Vec3(0));
+    pin2->updCoordinate().setName("q2");
+    model.addJoint(pin2);
+
+    Blankevoort1991Ligament* lig = new Blankevoort1991Ligament();
+    lig->setName("lig");
+    lig->upd_GeometryPath().appendNewPathPoint("origin",
+        model.updGround(), SimTK::Vec3(0.05, 0.1, 0));
+    lig->upd_GeometryPath().appendNewPathPoint("via",
+        *link1, SimTK::Vec3(0.05, -0.2, 0));
+    lig->upd_GeometryPath().appendNewPathPoint("insertion",
+        *link2, SimTK::Vec3(0.05, -0.2, 0));
+    lig->set_linear_stiffness(linear_stiffness);
+    lig->set_transition_strain(transition_strain);
+    lig->set_damping_coefficient(50.0);
+    lig->set_slack_length(slack);
+    model.addForce(lig);
+}
+
+// Generalized forces of the ligament on q1 and q2 (moment arm * tension)
+static SimTK::Vec2 calcGeneralizedForces(const Model& model,
+    const SimTK::State& state)
+{
+    const Blankevoort1991Ligament& lig =
+        model.getComponent<Blankevoort1991Ligament>("/forceset/lig");
+    double force = lig.getTotalForce(state);
+
+    return SimTK::Vec2(
+        lig.get_GeometryPath().computeMomentArm(state,
+            model.getCoordinateSet().get("q1")) * force,
+        lig.get_GeometryPath().computeMomentArm(state,
+            model.getCoordinateSet().get("q2")) * force);
+}
+
+// The generalized force derivatives, including the change in moment arm
+// with pose, must match central finite differences of the generalized
+// forces, in the toe and linear regions and while lengthening.
+void testGeneralizedForceDerivatives()
+{
+    double q1 = 0.3;
+    double q2 = 0.5;
+
+    //Slack length from the path length at the test pose
+    Model length_model;
+    createPendulumModel(length_model, 1.0);
+    SimTK::State& length_state = length_model.initSystem();
+    length_model.getCoordinateSet().get("q1").setValue(length_state, q1);
+    length_model.getCoordinateSet().get("q2").setValue(length_state, q2);
+    double length = length_model.getComponent<Blankevoort1991Ligament>(
+        "/forceset/lig").getLength(length_state);
+
+    for (double strain : { 0.03, 0.1 }) {
+        Model model;
+        createPendulumModel(model, length / (1 + strain));
+        SimTK::State& state = model.initSystem();
+
+        const Blankevoort1991Ligament& lig =
+            model.getComponent<Blankevoort1991Ligament>("/forceset/lig");
+
+        std::vector<SimTK::ReferencePtr<const Coordinate>> coords;
+        coords.emplace_back(model.getCoordinateSet().get("q1"));
+        coords.emplace_back(model.getCoordinateSet().get("q2"));
+
+        coords[0]->setValue(state, q1);
+        coords[1]->setValue(state, q2);
+        coords[0]->setSpeedValue(state, 0.4);
+        coords[1]->setSpeedValue(state, 0.8);
+        model.realizeVelocity(state);
+
+        //Lengthening, so the damping force contributes
+        if (lig.getStrainRate(state) < 0) {
+            coords[0]->setSpeedValue(state, -0.4);
+            coords[1]->setSpeedValue(state, -0.8);
+            model.realizeVelocity(state);
+        }
+        SimTK_TEST(lig.getStrainRate(state) > 0);
+
+        SimTK::Matrix dfdq, dfdu;
+        lig.computeGeneralizedForceDerivatives(state, coords, dfdq, dfdu);
+
+        double h = 1e-6;
+        for (int j = 0; j < 2; ++j) {
+            SimTK::State s = state;
+
+            double value = coords[j]->getValue(state);
+            coords[j]->setValue(s, value + h, false);
+            model.realizeVelocity(s);
+            SimTK::Vec2 tau_plus = calcGeneralizedForces(model, s);
+            coords[j]->setValue(s, value - h, false);
+            model.realizeVelocity(s);
+            SimTK::Vec2 tau_minus = calcGeneralizedForces(model, s);
+            coords[j]->setValue(s, value, false);
+
+            double speed = coords[j]->getSpeedValue(state);
+            coords[j]->setSpeedValue(s, speed + h);
+            model.realizeVelocity(s);
+            SimTK::Vec2 tau_u_plus = calcGeneralizedForces(model, s);
+            coords[j]->setSpeedValue(s, speed - h);
+            model.realizeVelocity(s);
+            SimTK::Vec2 tau_u_minus = calcGeneralizedForces(model, s);
+
+            for (int i = 0; i < 2; ++i) {
+                double fd_dfdq = (tau_plus[i] - tau_minus[i]) / (2 * h);
+                double fd_dfdu = (tau_u_plus[i] - tau_u_minus[i]) / (2 * h);
+
+                SimTK_TEST_EQ_TOL(dfdq(i, j), fd_dfdq,
+                    1e-4 * std::abs(fd_dfdq) + 1e-4);
+                SimTK_TEST_EQ_TOL(dfdu(i, j), fd_dfdu,
+                    1e-4 * std::abs(fd_dfdu) + 1e-4);
+            }
+        }
+    }
+}
+
+int main()
+{
+    SimTK_START_TEST("testBlankevoort1991Ligament");
+        RegisterTypes_osimPlugin();
+        SimTK_SUBTEST(testForceEvaluation);
+        SimTK_SUBTEST(testLigamentSet);
+        SimTK_SUBTEST(testGeneralizedForceDerivatives);
+    SimTK_END_TEST();
+}
@@ -0,0 +1,127 @@
+/* -------------------------------------------------------------------------- *
+ *                          testCOMAKBatchTool.cpp                            *
+ * -------------------------------------------------------------------------- *
+ * Author(s): Colin Smith                                                     *
+ *                                                                            *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may    *
+ * not use this file except in compliance with the License. You may obtain a  *
+ * copy of the License at http://www.apache.org/licenses/LICENSE-2.0.         *
+ *                                                                            *
+ * Unless required by applicable law or agreed to in writing, software        *
+ * distributed under the License is distributed on an "AS IS" BASIS,          *
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.   *
+ * See the License for the specific language governing permissions and        *
+ * limitations under the License.                                             *
+ * -------------------------------------------------------------------------- */
+
+#include <OpenSim/OpenSim.h>
+#include "SimTKcommon/Testing.h"
+#include "COMAKTool.h"
+#include "COMAKBatchTool.h"
+#include "RegisterTypes_osimPlugin.h"
+
+using namespace OpenSim;
+
+static const std::string settings_file = std::string(JAM_EXAMPLES_DIR) +
+    "/walking/inputs/comak_settings_test.xml";
+
+// Write a copy of the walking example settings with absolute input paths,
+// so it can be run from any directory. The COMAKTool constructor changes
+// the working directory to the directory of the settings file.
+static void writeTrialSettings(const std::string& file,
+    const std::string& settle_cache_dir)
+{
+    std::string cwd = IO::getCwd();
+    COMAKTool comak(settings_file);
+
+    auto absolute = [](const std::string& path) {
+        if (path.empty() || path == "Unassigned") return path;
+        return SimTK::Pathname::getAbsolutePathname(path);
+    };
+
+    comak.set_model_file(absolute(comak.get_model_file()));
+    comak.set_coordinates_file(absolute(comak.get_coordinates_file()));
+    comak.set_external_loads_file(absolute(comak.get_external_loads_file()));
+    comak.set_initial_guess_file(absolute(comak.get_initial_guess_file()));
+    comak.set_force_set_file(absolute(comak.get_force_set_file()));
+    comak.set_results_prefix("walking");
+    comak.set_print_settle_sim_results(false);
+    comak.set_use_settle_cache(true);
+    comak.set_settle_cache_directory(settle_cache_dir);
+    IO::chDir(cwd);
+
+    comak.print(file);
+}
+
+// Two trials with the same model and settle settings share a settle cache
+// file and are solved concurrently. Each must predict the same results as
+// running its settings with a separate COMAKTool.
+void testTwoTrialBatch()
+{
+    std::string cwd = IO::getCwd();
+    std::string test_dir = cwd + "/testCOMAKBatchTool";
+    std::string settle_cache_dir = test_dir + "/settle_cache";
+    IO::makeDir(test_dir);
+
+    std::vector<std::string> trials = { "trial_a", "trial_b" };
+    for (const std::string& trial : trials) {
+        writeTrialSettings(test_dir + "/" + trial + ".xml", settle_cache_dir);
+    }
+
+    COMAKBatchTool batch;
+    for (const std::string& trial : trials) {
+        batch.append_trial_settings_files(test_dir + "/" + trial + ".xml");
+    }
+    batch.set_results_directory(test_dir + "/batch");
+    batch.set_num_parallel_trials(2);
+    batch.run();
+    IO::chDir(cwd);
+
+    for (const std::string& trial : trials) {
+        std::string separate_dir = test_dir + "/separate_" + trial;
+
+        COMAKTool comak(test_dir + "/" + trial + ".xml");
+        comak.set_results_directory(separate_dir);
+        comak.set_use_settle_cache(false);
+        comak.run();
+        IO::chDir(cwd);
+
+        TimeSeriesTable batch_values(
+            test_dir + "/batch/" + trial + "/walking_values.sto");
+        TimeSeriesTable separate_values(separate_dir + "/walking_values.sto");
+
+        SimTK_TEST(batch_values.getNumRows() > 0);
+        SimTK_TEST(batch_values.getNumRows() == separate_values.getNumRows());
+        SimTK_TEST(batch_values.getColumnLabels() ==
+            separate_values.getColumnLabels());
+
+        for (size_t i = 0; i < batch_values.getNumRows(); ++i) {
+            SimTK_TEST_EQ_TOL(batch_values.getRowAtIndex(i),
+                separate_values.getRowAtIndex(i), 1e-6);
+        }
+    }
+
+    // The shared settle cache file is complete and is reused by a new run
+    COMAKTool comak(test_dir + "/" + trials[0] + ".xml");
+    comak.set_results_directory(test_dir + "/cached");
+    comak.run();
+    IO::chDir(cwd);
+
+    TimeSeriesTable cached_values(test_dir + "/cached/walking_values.sto");
+    TimeSeriesTable batch_values(
+        test_dir + "/batch/" + trials[0] + "/walking_values.sto");
+
+    SimTK_TEST(cached_values.getNumRows() == batch_values.getNumRows());
+    for (size_t i = 0; i < cached_values.getNumRows(); ++i) {
+        SimTK_TEST_EQ_TOL(cached_values.getRowAtIndex(i),
+            batch_values.getRowAtIndex(i), 1e-6);
+    }
+}
+
+int main()
+{
+    SimTK_START_TEST("testCOMAKBatchTool");
+        RegisterTypes_osimPlugin();
+        SimTK_SUBTEST(testTwoTrialBatch);
+    SimTK_END_TEST();
+}
@@ -0,0 +1,143 @@
+/* -------------------------------------------------------------------------- *
+ *                            testCOMAKTarget.cpp                             *
+ * -------------------------------------------------------------------------- *
+ * Author(s): Colin Smith                                                     *
+ *                                                                            *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may    *
+ * not use this file except in compliance with the License. You may obtain a  *
+ * copy of the License at http://www.apache.org/licenses/LICENSE-2.0.         *
+ *                                                                            *
+ * Unless required by applicable law or agreed to in writing, software        *
+ * distributed under the License is distributed on an "AS IS" BASIS,          *
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.   *
+ * See the License for the specific language governing permissions and        *
+ * limitations under the License.                                             *
+ * -------------------------------------------------------------------------- */
+
+#include <OpenSim/OpenSim.h>
+#include "SimTKcommon/Testing.h"
+#include "COMAKTarget.h"
+#include "RegisterTypes_osimPlugin.h"
+
+using namespace OpenSim;
+
+static const double dt = 0.01;
+
+// A primary pin joint (flex) carrying a secondary slider (trans) held by a
+// nonlinear spring, so the secondary coordinate unit udots change with the
+// slider position. As in COMAKTool, the secondary coordinate has a COMAK
+// damping actuator that is overridden to zero in the state.
+static void createModel(Model& model)
+{
+    model.setName("comak_target");
+
+    Body* thigh = new Body("thigh", 1.0, SimTK::Vec3(0, -0.2, 0),
+        SimTK::Inertia(0.01));
+    Body* shank = new Body("shank", 1.0, SimTK::Vec3(0, -0.2, 0),
+        SimTK::Inertia(0.01));
+    model.addBody(thigh);
+    model.addBody(shank);
+
+    PinJoint* flex = new PinJoint("flex", model.getGround(), *thigh);
+    flex->updCoordinate().setName("flex");
+    model.addJoint(flex);
+
+    SliderJoint* trans = new SliderJoint("trans",
+        *thigh, SimTK::Vec3(0, -0.4, 0), SimTK::Vec3(0),
+        *shank, SimTK::Vec3(0), SimTK::Vec3(0));
+    trans->updCoordinate().setName("trans");
+    model.addJoint(trans);
+
+    model.addForce(new ExpressionBasedCoordinateForce("trans",
+        "-2000*q-500000*q^3"));
+
+    CoordinateActuator* flex_act = new CoordinateActuator("flex");
+    flex_act->setName("flex_act");
+    flex_act->setOptimalForce(100.0);
+    flex_act->setMinControl(-1.0);
+    flex_act->setMaxControl(1.0);
+    model.addForce(flex_act);
+
+    CoordinateActuator* damping = new CoordinateActuator("trans");
+    damping->setName("trans__COMAK_DAMPING__");
+    model.addForce(damping);
+}
+
+static void setupTarget(ComakTarget& target, int max_broyden_updates)
+{
+    SimTK::Vector damping(1, 1.0);
+
+    target.setUnitUdotEpsilon(1e-7);
+    target.setDT(dt);
+    target.setOptimalForces(SimTK::Vector(1, 100.0));
+    target.setSecondaryCoordinateDamping(damping);
+    target.setMaxChange(SimTK::Vector(1, 0.05));
+    target.setContactEnergyWeight(0.0);
+    target.setMaxBroydenUpdates(max_broyden_updates);
+    target.initialize();
+}
+
+// After a small step of the secondary coordinate (and the actuator), the
+// Broyden updated secondary columns of the constraint Jacobian must match
+// the columns recomputed by finite differences at the new parameters.
+void testBroydenUpdate()
+{
+    Model model;
+    createModel(model);
+    SimTK::State& state = model.initSystem();
+
+    const CoordinateActuator& damping =
+        model.getComponent<CoordinateActuator>("/forceset/trans__COMAK_DAMPING__");
+    damping.overrideActuation(state, true);
+    damping.setOverrideActuation(state, 0.0);
+
+    Array<std::string> primary, secondary, muscles, actuators, dampers;
+    primary.append("/jointset/flex/flex");
+    secondary.append("/jointset/trans/trans");
+    actuators.append("/forceset/flex_act");
+    dampers.append("/forceset/trans__COMAK_DAMPING__");
+
+    Array<std::string> names;
+    names.append("flex_act");
+    names.append("trans");
+
+    SimTK::Vector observed_udot(2, 0.0);
+
+    SimTK::Vector p0(2);
+    p0[0] = 0.1;
+    p0[1] = 0.01;
+
+    SimTK::Vector p1 = p0;
+    p1[0] = 0.2;
+    p1[1] = 0.01 + 1e-5;
+
+    ComakTarget broyden(state, &model, observed_udot, p0, names, primary,
+        secondary, muscles, actuators, dampers);
+    setupTarget(broyden, 1);
+    broyden.update(state, observed_udot, p0);
+    broyden.update(state, observed_udot, p1);
+
+    ComakTarget fresh(state, &model, observed_udot, p1, names, primary,
+        secondary, muscles, actuators, dampers);
+    setupTarget(fresh, 0);
+    fresh.update(state, observed_udot, p1);
+
+    SimTK::Matrix broyden_jac(2, 2), fresh_jac(2, 2);
+    broyden.constraintJacobian(p1, true, broyden_jac);
+    fresh.constraintJacobian(p1, true, fresh_jac);
+
+    //The damping column (1/dt) is large compared to the change of the
+    //secondary column over the step, so folding it into the update fails
+    for (int i = 0; i < 2; ++i) {
+        SimTK_TEST_EQ_TOL(broyden_jac(i, 1), fresh_jac(i, 1),
+            1e-3 * std::abs(fresh_jac(i, 1)) + 1e-3);
+    }
+}
+
+int main()
+{
+    SimTK_START_TEST("testCOMAKTarget");
+        RegisterTypes_osimPlugin();
+        SimTK_SUBTEST(testBroydenUpdate);
+    SimTK_END_TEST();
+}
@@ -0,0 +1,166 @@
+/* -------------------------------------------------------------------------- *
+ *                             testCOMAKTool.cpp                              *
+ * -------------------------------------------------------------------------- *
+ * Author(s): Colin Smith                                                     *
+ *                                                                            *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may    *
+ * not use this file except in compliance with the License. You may obtain a  *
+ * copy of the License at http://www.apache.org/licenses/LICENSE-2.0.         *
+ *                                                                            *
+ * Unless required by applicable law or agreed to in writing, software        *
+ * distributed under the License is distributed on an "AS IS" BASIS,          *
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.   *
+ * See the License for the specific language governing permissions and        *
+ * limitations under the License.                                             *
+ * -------------------------------------------------------------------------- */
+
+#include <OpenSim/OpenSim.h>
+#include "SimTKcommon/Testing.h"
+#include "COMAKTool.h"
+#include "RegisterTypes_osimPlugin.h"
+
+using namespace OpenSim;
+
+static const std::string settings_file = std::string(JAM_EXAMPLES_DIR) +
+    "/walking/inputs/comak_settings_test.xml";
+
+// Run the short walking example and return the values table. The tool is
+// constructed from the settings file, which changes the working directory,
+// so the results directory is passed as an absolute path.
+static TimeSeriesTable runCOMAK(const std::string& results_dir,
+    int num_windows, bool stream_results = false, bool restart = false)
+{
+    COMAKTool comak(settings_file);
+    comak.set_results_directory(results_dir);
+    comak.set_results_prefix("walking");
+    comak.set_num_windows(num_windows);
+    comak.set_window_overlap_frames(1);
+    comak.set_use_settle_cache(false);
+    comak.set_print_settle_sim_results(false);
+    comak.set_stream_results(stream_results);
+    comak.set_restart_from_checkpoint(restart);
+    comak.run();
+
+    return TimeSeriesTable(results_dir + "/walking_values.sto");
+}
+
+// Solving the frames in two windows must predict the same secondary
+// kinematics as solving them in one pass. Each window after the first
+// starts from a settled pose, so the values agree to a tolerance rather
+// than exactly.
+void testWindowedCOMAK()
+{
+    std::string cwd = IO::getCwd();
+
+    TimeSeriesTable single = runCOMAK(cwd + "/testCOMAKTool_single", 1);
+    TimeSeriesTable windowed = runCOMAK(cwd + "/testCOMAKTool_windowed", 2);
+
+    SimTK_TEST(single.getNumRows() == windowed.getNumRows());
+    SimTK_TEST(single.getNumColumns() == windowed.getNumColumns());
+
+    const std::vector<double>& single_time = single.getIndependentColumn();
+    const std::vector<double>& windowed_time = windowed.getIndependentColumn();
+    for (size_t i = 0; i < single_time.size(); ++i) {
+        SimTK_TEST_EQ_TOL(single_time[i], windowed_time[i], 1e-8);
+    }
+
+    COMAKTool settings(settings_file);
+    Model model(settings.get_model_file());
+
+    const COMAKSecondaryCoordinateSet& secondary_coords =
+        settings.get_COMAKSecondaryCoordinateSet();
+
+    for (int c = 0; c < secondary_coords.getSize(); ++c) {
+        const Coordinate& coord = model.getComponent<Coordinate>(
+            secondary_coords.get(c).get_coordinate());
+
+        //Translations in m, rotations in degrees
+        double tol = coord.getMotionType() == Coordinate::Translational ?
+            1e-3 : 0.5;
+
+        const auto& single_values =
+            single.getDependentColumn(coord.getName());
+        const auto& windowed_values =
+            windowed.getDependentColumn(coord.getName());
+
+        for (int i = 0; i < single_values.size(); ++i) {
+            SimTK_TEST_EQ_TOL(single_values[i], windowed_values[i], tol);
+        }
+    }
+}
+
+// The streamed results files must hold every frame, and restarting from
+// them must restore the frames rather than solve them again.
+void testStreamedResults()
+{
+    std::string results_dir = IO::getCwd() + "/testCOMAKTool_streamed";
+
+    TimeSeriesTable streamed = runCOMAK(results_dir, 1, true);
+    TimeSeriesTable restarted = runCOMAK(results_dir, 1, true, true);
+
+    SimTK_TEST(streamed.getNumRows() > 0);
+    SimTK_TEST(streamed.getNumRows() == restarted.getNumRows());
+    SimTK_TEST(streamed.getNumColumns() == restarted.getNumColumns());
+
+    for (size_t i = 0; i < streamed.getNumRows(); ++i) {
+        SimTK_TEST_EQ_TOL(streamed.getRowAtIndex(i),
+            restarted.getRowAtIndex(i), 1e-8);
+    }
+}
+
+// Restarting is not supported with windows, the streamed files of the
+// previous run must be left untouched.
+void testWindowedRestartThrows()
+{
+    std::string results_dir = IO::getCwd() + "/testCOMAKTool_streamed";
+    TimeSeriesTable before(results_dir + "/walking_values.sto");
+
+    SimTK_TEST_MUST_THROW(runCOMAK(results_dir, 2, true, true));
+
+    TimeSeriesTable after(results_dir + "/walking_values.sto");
+    SimTK_TEST(before.getNumRows() == after.getNumRows());
+}
+
+// The windows must solve the model passed to setModel() rather than 
+// reloading model_file, which is made invalid here.
+void testWindowedSetModel()
+{
+    std::string cwd = IO::getCwd();
+    std::string results_dir = cwd + "/testCOMAKTool_windowed_set_model";
+
+    COMAKTool comak(settings_file);
+    Model model(comak.get_model_file());
+    comak.set_model_file("model_file_not_used.osim");
+    comak.setModel(model);
+
+    comak.set_results_directory(results_dir);
+    comak.set_results_prefix("walking");
+    comak.set_num_windows(2);
+    comak.set_window_overlap_frames(1);
+    comak.set_num_threads(4);
+    comak.set_use_settle_cache(false);
+    comak.set_print_settle_sim_results(false);
+    comak.run();
+    IO::chDir(cwd);
+
+    TimeSeriesTable windowed(results_dir + "/walking_values.sto");
+    TimeSeriesTable reference(cwd + "/testCOMAKTool_windowed/walking_values.sto");
+
+    SimTK_TEST(comak.get_num_threads() == 4);
+    SimTK_TEST(windowed.getNumRows() == reference.getNumRows());
+    for (size_t i = 0; i < windowed.getNumRows(); ++i) {
+        SimTK_TEST_EQ_TOL(windowed.getRowAtIndex(i),
+            reference.getRowAtIndex(i), 1e-6);
+    }
+}
+
+int main()
+{
+    SimTK_START_TEST("testCOMAKTool");
+        RegisterTypes_osimPlugin();
+        SimTK_SUBTEST(testWindowedCOMAK);
+        SimTK_SUBTEST(testWindowedSetModel);
+        SimTK_SUBTEST(testStreamedResults);
+        SimTK_SUBTEST(testWindowedRestartThrows);
+    SimTK_END_TEST();
+}
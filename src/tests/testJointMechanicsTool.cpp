@@ -0,0 +1,195 @@
+/* -------------------------------------------------------------------------- *
+ *                         testJointMechanicsTool.cpp                         *
+ * -------------------------------------------------------------------------- *
+ * Author(s): Colin Smith                                                     *
+ *                                                                            *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may    *
+ * not use this file except in compliance with the License. You may obtain a  *
+ * copy of the License at http://www.apache.org/licenses/LICENSE-2.0.         *
+ *                                                                            *
+ * Unless required by applicable law or agreed to in writing, software        *
+ * distributed under the License is distributed on an "AS IS" BASIS,          *
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.   *
+ * See the License for the specific language governing permissions and        *
+ * limitations under the License.                                             *
+ * -------------------------------------------------------------------------- */
+
+#include <OpenSim/OpenSim.h>
+#include "SimTKcommon/Testing.h"
+#include "JointMechanicsTool.h"
+#include "RegisterTypes_osimPlugin.h"
+#include "H5Cpp.h"
+
+using namespace OpenSim;
+
+static const std::string model_file =
+    std::string(JAM_MODELS_DIR) + "/lenhart2015/lenhart2015.osim";
+
+// Write a short passive knee flexion states file for the model.
+static void writeFlexionStatesFile(Model& model, const std::string& file)
+{
+    SimTK::State state = model.initSystem();
+    const Coordinate& knee_flex =
+        model.getComponent<Coordinate>("/jointset/knee_r/knee_flex_r");
+
+    Array<std::string> labels;
+    labels.append("time");
+    Array<std::string> state_names = model.getStateVariableNames();
+    for (int i = 0; i < state_names.getSize(); ++i) {
+        labels.append(state_names[i]);
+    }
+
+    Storage states;
+    states.setName("states");
+    states.setInDegrees(false);
+    states.setColumnLabels(labels);
+
+    int n_frames = 4;
+    for (int i = 0; i < n_frames; ++i) {
+        double time = 0.1 * i;
+        knee_flex.setValue(state,
+            i * SimTK::convertDegreesToRadians(20.0) / (n_frames - 1));
+        SimTK::Vector values = model.getStateVariableValues(state);
+        states.append(time, values);
+    }
+    states.print(file);
+}
+
+static const std::string results_dir = "testJointMechanicsTool_results";
+static const std::string contact_group =
+    "/Smith2018ArticularContactForce/tf_contact/";
+
+// Run the tool with the default contact_outputs ("all"), which collects both
+// the per triangle Vector outputs and the regional Vector outputs.
+static void runJointMechanicsTool(Model& model,
+    const std::string& states_file, const std::string& basename,
+    bool sparse_contact_data)
+{
+    JointMechanicsTool jnt_mech(&model, states_file, results_dir);
+    jnt_mech.set_results_file_basename(basename);
+    jnt_mech.set_contact_outputs(0, "all");
+    jnt_mech.set_write_vtp_files(false);
+    jnt_mech.set_write_h5_file(true);
+    jnt_mech.set_h5_sparse_contact_data(sparse_contact_data);
+
+    jnt_mech.run();
+}
+
+static SimTK::Matrix readDenseDataSet(H5::H5File& file,
+    const std::string& path)
+{
+    H5::DataSet dataset = file.openDataSet(path);
+    hsize_t dims[2];
+    dataset.getSpace().getSimpleExtentDims(dims);
+
+    std::vector<double> data(dims[0] * dims[1]);
+    if (!data.empty()) {
+        dataset.read(data.data(), H5::PredType::NATIVE_DOUBLE);
+    }
+
+    SimTK::Matrix matrix((int)dims[0], (int)dims[1]);
+    for (int r = 0; r < matrix.nrow(); ++r) {
+        for (int c = 0; c < matrix.ncol(); ++c) {
+            matrix(r, c) = data[r * dims[1] + c];
+        }
+    }
+    return matrix;
+}
+
+static std::vector<int> readIntDataSet(H5::H5File& file,
+    const std::string& path)
+{
+    H5::DataSet dataset = file.openDataSet(path);
+    hsize_t dim;
+    dataset.getSpace().getSimpleExtentDims(&dim);
+
+    std::vector<int> data(dim);
+    if (!data.empty()) {
+        dataset.read(data.data(), H5::PredType::NATIVE_INT);
+    }
+    return data;
+}
+
+// Expand a compressed sparse row group (num_rows, num_columns, row_offsets, 
+// column_index, values) to a dense matrix, zero where no value is stored.
+static SimTK::Matrix readSparseDataSet(H5::H5File& file,
+    const std::string& path)
+{
+    H5::Group group = file.openGroup(path);
+    int nrow, ncol;
+    group.openAttribute("num_rows").read(H5::PredType::NATIVE_INT, &nrow);
+    group.openAttribute("num_columns").read(H5::PredType::NATIVE_INT, &ncol);
+
+    std::vector<int> row_offsets = readIntDataSet(file, path + "/row_offsets");
+    std::vector<int> column_index = 
+        readIntDataSet(file, path + "/column_index");
+
+    H5::DataSet values_dataset = file.openDataSet(path + "/values");
+    std::vector<double> values(column_index.size());
+    if (!values.empty()) {
+        values_dataset.read(values.data(), H5::PredType::NATIVE_DOUBLE);
+    }
+
+    SimTK_TEST((int)row_offsets.size() == nrow + 1);
+    SimTK_TEST(row_offsets.back() == (int)values.size());
+
+    SimTK::Matrix matrix(nrow, ncol, 0.0);
+    for (int r = 0; r < nrow; ++r) {
+        for (int k = row_offsets[r]; k < row_offsets[r + 1]; ++k) {
+            matrix(r, column_index[k]) = values[k];
+        }
+    }
+    return matrix;
+}
+
+// The per triangle outputs read back from the sparse .h5 file must match the
+// dense .h5 file of an identical run, and the regional outputs must be 
+// stored dense in both.
+void testSparseContactOutputs()
+{
+    Model model(model_file);
+    std::string states_file = "testJointMechanicsTool_states.sto";
+    writeFlexionStatesFile(model, states_file);
+
+    runJointMechanicsTool(model, states_file, "sparse_contact_outputs", true);
+    runJointMechanicsTool(model, states_file, "dense_contact_outputs", false);
+
+    H5::H5File sparse_file(results_dir + "/sparse_contact_outputs.h5",
+        H5F_ACC_RDONLY);
+    H5::H5File dense_file(results_dir + "/dense_contact_outputs.h5",
+        H5F_ACC_RDONLY);
+
+    for (std::string name : { "casting_triangle_pressure",
+        "target_triangle_proximity" }) {
+        SimTK::Matrix sparse = readSparseDataSet(sparse_file, 
+            contact_group + name);
+        SimTK::Matrix dense = readDenseDataSet(dense_file, 
+            contact_group + name);
+
+        SimTK_TEST(sparse.nrow() == 4);
+        SimTK_TEST(sparse.nrow() == dense.nrow());
+        SimTK_TEST(sparse.ncol() == dense.ncol());
+        SimTK_TEST(dense.norm() > 0.0);
+        SimTK_TEST_EQ(sparse, dense);
+    }
+
+    for (std::string name : { "casting_regional_mean_pressure",
+        "target_regional_contact_area" }) {
+        SimTK::Matrix from_sparse_run = readDenseDataSet(sparse_file,
+            contact_group + name);
+        SimTK::Matrix from_dense_run = readDenseDataSet(dense_file,
+            contact_group + name);
+
+        SimTK_TEST(from_sparse_run.nrow() == 4);
+        SimTK_TEST(from_sparse_run.ncol() > 0);
+        SimTK_TEST_EQ(from_sparse_run, from_dense_run);
+    }
+}
+
+int main()
+{
+    SimTK_START_TEST("testJointMechanicsTool");
+        RegisterTypes_osimPlugin();
+        SimTK_SUBTEST(testSparseContactOutputs);
+    SimTK_END_TEST();
+}
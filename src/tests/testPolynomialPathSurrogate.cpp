@@ -0,0 +1,121 @@
+/* -------------------------------------------------------------------------- *
+ *                      testPolynomialPathSurrogate.cpp                       *
+ * -------------------------------------------------------------------------- *
+ * Author(s): Colin Smith                                                     *
+ *                                                                            *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may    *
+ * not use this file except in compliance with the License. You may obtain a  *
+ * copy of the License at http://www.apache.org/licenses/LICENSE-2.0.         *
+ *                                                                            *
+ * Unless required by applicable law or agreed to in writing, software        *
+ * distributed under the License is distributed on an "AS IS" BASIS,          *
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.   *
+ * See the License for the specific language governing permissions and        *
+ * limitations under the License.                                             *
+ * -------------------------------------------------------------------------- */
+
+#include <OpenSim/OpenSim.h>
+#include "SimTKcommon/Testing.h"
+#include "Blankevoort1991Ligament.h"
+#include "RegisterTypes_osimPlugin.h"
+
+using namespace OpenSim;
+
+static const double range = 0.5;
+
+// Two pin joints in series, with a ligament from the ground over a via point
+// on the first body to the second body, so the path spans both coordinates.
+// The first coordinate is locked by default, as primary coordinates are
+// during the COMAK and inverse kinematics settle simulations.
+static void createDoublePendulumModel(Model& model)
+{
+    model.setName("double_pendulum");
+
+    Body* link1 = new Body("link1", 1.0, SimTK::Vec3(0, -0.2, 0),
+        SimTK::Inertia(0.01));
+    Body* link2 = new Body("link2", 1.0, SimTK::Vec3(0, -0.2, 0),
+        SimTK::Inertia(0.01));
+    model.addBody(link1);
+    model.addBody(link2);
+
+    double q_range[2] = { -range, range };
+
+    PinJoint* pin1 = new PinJoint("pin1", model.getGround(), *link1);
+    pin1->updCoordinate().setName("q1");
+    pin1->updCoordinate().setRange(q_range);
+    pin1->updCoordinate().setDefaultLocked(true);
+    model.addJoint(pin1);
+
+    PinJoint* pin2 = new PinJoint("pin2",
+        *link1, SimTK::Vec3(0, -0.4, 0), SimTK::Vec3(0),
+        *link2, SimTK::Vec3(0), SimTK::Vec3(0));
+    pin2->updCoordinate().setName("q2");
+    pin2->updCoordinate().setRange(q_range);
+    model.addJoint(pin2);
+
+    Blankevoort1991Ligament* lig = new Blankevoort1991Ligament();
+    lig->setName("lig");
+    lig->upd_GeometryPath().appendNewPathPoint("origin",
+        model.updGround(), SimTK::Vec3(0.05, 0.1, 0));
+    lig->upd_GeometryPath().appendNewPathPoint("via",
+        *link1, SimTK::Vec3(0.05, -0.2, 0));
+    lig->upd_GeometryPath().appendNewPathPoint("insertion",
+        *link2, SimTK::Vec3(0.05, -0.2, 0));
+    lig->set_linear_stiffness(1000.0);
+    lig->set_slack_length(0.3);
+    lig->set_use_path_surrogate(true);
+    lig->set_path_surrogate_order(5);
+    model.addForce(lig);
+}
+
+// The surrogate is fit when the system is initialized, spans both
+// coordinates even though one is locked, and matches the length and
+// dL/dq (the negative moment arm) of the exact GeometryPath over the fitted
+// coordinate ranges.
+void testSurrogateAgainstGeometryPath()
+{
+    Model model;
+    createDoublePendulumModel(model);
+    SimTK::State& state = model.initSystem();
+
+    const Blankevoort1991Ligament& lig =
+        model.getComponent<Blankevoort1991Ligament>("/forceset/lig");
+    const PolynomialPathSurrogate& surrogate = lig.getPathSurrogate();
+
+    SimTK_TEST(surrogate.isFitted());
+    SimTK_TEST(surrogate.getNumCoordinates() == 2);
+
+    Coordinate& q1 = model.updCoordinateSet().get("q1");
+    Coordinate& q2 = model.updCoordinateSet().get("q2");
+    q1.setLocked(state, false);
+
+    const GeometryPath& path = lig.get_GeometryPath();
+    SimTK::Vector dldq(surrogate.getNumCoordinates());
+
+    int n = 9;
+    for (int i = 0; i < n; ++i) {
+        for (int j = 0; j < n; ++j) {
+            q1.setValue(state, -range + 2 * range * i / (n - 1), false);
+            q2.setValue(state, -range + 2 * range * j / (n - 1), false);
+            model.realizePosition(state);
+
+            double length = surrogate.calcLength(state, dldq);
+            SimTK_TEST_EQ_TOL(length, path.getLength(state), 1e-4);
+
+            for (Coordinate* coord : { &q1, &q2 }) {
+                int index = surrogate.findCoordinateIndex(*coord);
+                SimTK_TEST(index != -1);
+                SimTK_TEST_EQ_TOL(dldq(index),
+                    -path.computeMomentArm(state, *coord), 1e-3);
+            }
+        }
+    }
+}
+
+int main()
+{
+    SimTK_START_TEST("testPolynomialPathSurrogate");
+        RegisterTypes_osimPlugin();
+        SimTK_SUBTEST(testSurrogateAgainstGeometryPath);
+    SimTK_END_TEST();
+}
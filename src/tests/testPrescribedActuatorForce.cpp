@@ -0,0 +1,124 @@
+/* -------------------------------------------------------------------------- *
+ *                      testPrescribedActuatorForce.cpp                       *
+ * -------------------------------------------------------------------------- *
+ * Author(s): Colin Smith                                                     *
+ *                                                                            *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may    *
+ * not use this file except in compliance with the License. You may obtain a  *
+ * copy of the License at http://www.apache.org/licenses/LICENSE-2.0.         *
+ *                                                                            *
+ * Unless required by applicable law or agreed to in writing, software        *
+ * distributed under the License is distributed on an "AS IS" BASIS,          *
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.   *
+ * See the License for the specific language governing permissions and        *
+ * limitations under the License.                                             *
+ * -------------------------------------------------------------------------- */
+
+#include <OpenSim/OpenSim.h>
+#include "SimTKcommon/Testing.h"
+#include "PrescribedActuatorForce.h"
+#include "RegisterTypes_osimPlugin.h"
+
+using namespace OpenSim;
+
+static const double mass = 2.0;
+
+// A block on a slider along the ground x axis without gravity, so the 
+// acceleration of the block is the applied force divided by the mass.
+static void createSliderModel(Model& model)
+{
+    model.setName("slider");
+    model.setGravity(SimTK::Vec3(0));
+
+    Body* block = new Body("block", mass, SimTK::Vec3(0), 
+        SimTK::Inertia(0.01));
+    model.addBody(block);
+
+    SliderJoint* slider = new SliderJoint("slider", 
+        model.getGround(), *block);
+    slider->updCoordinate().setName("x");
+    model.addJoint(slider);
+}
+
+static PiecewiseLinearFunction createForceFunction()
+{
+    double time[3] = { 0.0, 0.5, 1.0 };
+    double force[3] = { 10.0, -20.0, 40.0 };
+    return PiecewiseLinearFunction(3, time, force);
+}
+
+// The actuator does not apply its own (overridden) force, the prescribed 
+// force is applied through its coordinate or path and reported by the 
+// force output.
+static void checkPrescribedForce(Model& model, const ScalarActuator& actuator,
+    const PrescribedActuatorForce& prescribed, double direction)
+{
+    SimTK::State& state = model.initSystem();
+    actuator.overrideActuation(state, true);
+    actuator.setOverrideActuation(state, 1000.0);
+
+    const Coordinate& x = model.getCoordinateSet().get("x");
+    PiecewiseLinearFunction force_function = createForceFunction();
+
+    for (double time : { 0.0, 0.2, 0.5, 0.75, 1.0 }) {
+        state.setTime(time);
+        model.realizeAcceleration(state);
+
+        double force = force_function.calcValue(SimTK::Vector(1, time));
+
+        SimTK_TEST_EQ(prescribed.getForce(state), force);
+        SimTK_TEST_EQ(prescribed.getOutputValue<double>(state, "force"), 
+            force);
+        SimTK_TEST_EQ_TOL(x.getAccelerationValue(state), 
+            direction * force / mass, 1e-10);
+    }
+}
+
+void testCoordinateActuator()
+{
+    Model model;
+    createSliderModel(model);
+
+    CoordinateActuator* actuator = new CoordinateActuator("x");
+    actuator->setName("actuator");
+    actuator->set_appliesForce(false);
+    model.addForce(actuator);
+
+    PrescribedActuatorForce* prescribed = new PrescribedActuatorForce(
+        "actuator_prescribed_force", *actuator, createForceFunction());
+    model.addForce(prescribed);
+
+    checkPrescribedForce(model, *actuator, *prescribed, 1.0);
+}
+
+// The path runs from the ground to the block along -x, so the tension pulls
+// the block in the -x direction.
+void testPathActuator()
+{
+    Model model;
+    createSliderModel(model);
+
+    PathActuator* actuator = new PathActuator();
+    actuator->setName("actuator");
+    actuator->addNewPathPoint("origin", model.updGround(), 
+        SimTK::Vec3(-1.0, 0, 0));
+    actuator->addNewPathPoint("insertion", 
+        model.updBodySet().get("block"), SimTK::Vec3(0));
+    actuator->set_appliesForce(false);
+    model.addForce(actuator);
+
+    PrescribedActuatorForce* prescribed = new PrescribedActuatorForce(
+        "actuator_prescribed_force", *actuator, createForceFunction());
+    model.addForce(prescribed);
+
+    checkPrescribedForce(model, *actuator, *prescribed, -1.0);
+}
+
+int main()
+{
+    SimTK_START_TEST("testPrescribedActuatorForce");
+        RegisterTypes_osimPlugin();
+        SimTK_SUBTEST(testCoordinateActuator);
+        SimTK_SUBTEST(testPathActuator);
+    SimTK_END_TEST();
+}
@@ -0,0 +1,103 @@
+/* -------------------------------------------------------------------------- *
+ *                   testSmith2018ArticularContactForce.cpp                   *
+ * -------------------------------------------------------------------------- *
+ * Author(s): Colin Smith                                                     *
+ *                                                                            *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may    *
+ * not use this file except in compliance with the License. You may obtain a  *
+ * copy of the License at http://www.apache.org/licenses/LICENSE-2.0.         *
+ *                                                                            *
+ * Unless required by applicable law or agreed to in writing, software        *
+ * distributed under the License is distributed on an "AS IS" BASIS,          *
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.   *
+ * See the License for the specific language governing permissions and        *
+ * limitations under the License.                                             *
+ * -------------------------------------------------------------------------- */
+
+#include <OpenSim/OpenSim.h>
+#include "SimTKcommon/Testing.h"
+#include "Smith2018ArticularContactForce.h"
+#include "RegisterTypes_osimPlugin.h"
+#include <ctime>
+
+using namespace OpenSim;
+
+static const std::string model_file =
+    std::string(JAM_MODELS_DIR) + "/lenhart2015/lenhart2015.osim";
+
+// Realize each knee flexion pose twice, as the COMAK muscle perturbations 
+// do, and return the time spent. The contact forces of every realization 
+// are appended to forces.
+static double realizeFlexionPoses(Model& model, SimTK::State& state,
+    std::vector<SimTK::Vec3>& forces)
+{
+    const Coordinate& knee_flex =
+        model.getComponent<Coordinate>("/jointset/knee_r/knee_flex_r");
+    const Smith2018ArticularContactForce& tf_contact =
+        model.getComponent<Smith2018ArticularContactForce>(
+            "/forceset/tf_contact");
+
+    tf_contact.resetProximityCacheCounters();
+
+    std::clock_t start = std::clock();
+
+    int n_poses = 20;
+    for (int i = 0; i < n_poses; ++i) {
+        double q = i * SimTK::convertDegreesToRadians(30.0) / (n_poses - 1);
+        for (int rep = 0; rep < 2; ++rep) {
+            knee_flex.setValue(state, q, false);
+            model.realizeDynamics(state);
+            forces.push_back(tf_contact.getCastingTotalContactForce(state));
+            forces.push_back(tf_contact.getTargetTotalContactForce(state));
+        }
+    }
+    return double(std::clock() - start) / CLOCKS_PER_SEC;
+}
+
+// Every repeated pose must be served from the proximity cache with the same
+// contact forces as repeating the collision detection (proximity cache 
+// disabled).
+void testProximityCache()
+{
+    Model model(model_file);
+    SimTK::State& state = model.initSystem();
+
+    Model model_ref(model_file);
+    model_ref.updComponent<Smith2018ArticularContactForce>(
+        "/forceset/tf_contact").set_proximity_cache_size(0);
+    SimTK::State& state_ref = model_ref.initSystem();
+
+    std::vector<SimTK::Vec3> forces, forces_ref;
+    double time = realizeFlexionPoses(model, state, forces);
+    double time_ref = realizeFlexionPoses(model_ref, state_ref, forces_ref);
+
+    const Smith2018ArticularContactForce& tf_contact =
+        model.getComponent<Smith2018ArticularContactForce>(
+            "/forceset/tf_contact");
+    const Smith2018ArticularContactForce& tf_contact_ref =
+        model_ref.getComponent<Smith2018ArticularContactForce>(
+            "/forceset/tf_contact");
+
+    std::cout << "proximity cache hits: " << 
+        tf_contact.getProximityCacheHits() << " misses: " << 
+        tf_contact.getProximityCacheMisses() << " time: " << time <<
+        "s (disabled: " << time_ref << "s)" << std::endl;
+
+    SimTK_TEST(tf_contact.getProximityCacheMisses() > 0);
+    SimTK_TEST(tf_contact.getProximityCacheHits() ==
+        tf_contact.getProximityCacheMisses());
+    SimTK_TEST(tf_contact_ref.getProximityCacheHits() == 0);
+
+    SimTK_TEST(forces.size() == forces_ref.size());
+    for (int i = 0; i < static_cast<int>(forces.size()); ++i) {
+        SimTK_TEST_EQ_TOL(forces[i], forces_ref[i], 1e-8);
+    }
+}
+
+int main()
+{
+    SimTK_START_TEST("testSmith2018ArticularContactForce");
+        RegisterTypes_osimPlugin();
+        SimTK_SUBTEST(testProximityCache);
+    SimTK_END_TEST();
+}